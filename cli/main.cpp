@@ -1,7 +1,18 @@
 // SPDX-License-Identifier: MIT
 
 #include "quantum/circuit.hpp"
+#include "quantum/compiled.hpp"
+#include "quantum/density_matrix.hpp"
+#include "quantum/fusion.hpp"
 #include "quantum/optimize.hpp"
+#include "quantum/reduce.hpp"
+#include "quantum/sampling.hpp"
+#include "quantum/trajectories.hpp"
+#include "quantum/equiv.hpp"
+#include "quantum/grad.hpp"
+#include "quantum/hamiltonian.hpp"
+#include "quantum/map.hpp"
+#include "quantum/map_topo.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -44,23 +55,9 @@ static uint64_t hash_circuit(const qsx::Circuit& c){
 }
 
 static std::vector<qsx::c64> build_state(const qsx::Circuit& c){
-  qsx::StateVector sv(c.nqubits));
-  using namespace qsx::gates; qsx::c64 u00,u01,u10,u11;
-  for (const auto& g: c.ops){
-    switch(g.type){
-      case OpType::H: H_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::X: X_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::Y: Y_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::Z: Z_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::S: S_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::RX: RX_coeffs(g.angle,u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::RY: RY_coeffs(g.angle,u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::RZ: RZ_coeffs(g.angle,u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::CNOT: sv.apply_cx(g.qubits[0], g.qubits[1])); break;
-      default: break;
-    }
-  }
-  return sv.amplitudes());
+  qsx::StateVector sv(c.nqubits);
+  for (const auto& g: c.ops) qsx::apply_unitary(sv, g);
+  return sv.amplitudes();
 }
 
 
@@ -119,8 +116,22 @@ static std::vector<std::string> split_str(const std::string& s, char sep){
   return out;
 }
 
+// "name=value,name=value" for the named parameters of c
+static bool parse_bindings(const std::string& spec, const qsx::Circuit& c, std::map<std::string,double>& vals, std::string& err){
+  const auto names = qsx::circuit_parameters(c);
+  for (const auto& item : split_str(spec, ',')){
+    if (item.empty()) continue;
+    const auto eq = item.find('=');
+    if (eq == std::string::npos){ err = "Binding must be name=value: " + item; return false; }
+    const std::string name = item.substr(0, eq);
+    if (std::find(names.begin(), names.end(), name) == names.end()){ err = "Unknown parameter: " + name; return false; }
+    try { vals[name] = std::stod(item.substr(eq + 1)); } catch (...) { err = "Bad value for " + name; return false; }
+  }
+  return true;
+}
+
 static void usage() {
-  std::cout << "quantum-simx [--version|--build-info] run --circuit <file.qsx>|--qasm <file.qasm> [--qubits N] [--seed S] [--shots K] [--out file.json] [--backend state|density] [--optimize] [--observables all|z] [--force]\n";
+  std::cout << "quantum-simx [--version|--build-info] run --circuit <file.qsx>|--qasm <file.qasm> [--qubits N] [--seed S] [--shots K] [--out file.json] [--backend state|density|trajectories] [--density-mode matrix|packed|vectorized] [--trajectories N] [--target-stderr E] [--branch-cache MB] [--optimize] [--bind name=v,...] [--fuse K] [--block-qubits B] [--no-cache-blocking] [--no-reorder] [--no-channel-fusion] [--profile] [--observables all|z] [--force]\n";
 }
 static std::string bits_to_string(const std::vector<int>& v){ std::string s; s.reserve(v.size())); for(int i=int(v.size())-1;i>=0;--i) s.push_back(v[i]?'1':'0')); return s; }
   std::cout << "quantum-simx [--version|--build-info] run --circuit <file.qsx> [--qubits N] [--seed S] [--shots K] [--out file.json] [--backend state|density]\\n";
@@ -136,14 +147,17 @@ int main(int argc, char** argv) {
   if (first == "--build-info") { std::cout << "version=" << QSX_VERSION << "\n"; return 0; }
   std::string cmd = first;
   if (cmd == "grad") {
-    std::string circuit_path2, qasm_path2; uint64_t seed2=12345; std::string wrt="";
+    std::string circuit_path2, qasm_path2; uint64_t seed2=12345; std::string wrt=""; std::string method=""; std::string gqubits=""; std::string gham="";
     for (int i=2;i<argc;i++){
       std::string a=argv[i]; auto nx=[&](const char* n){ if(i+1>=argc){std::cerr<<"Missing "<<n<<"\n"; return std::string()); } return std::string(argv[++i])); };
       if(a=="--circuit") circuit_path2=nx("--circuit"));
       else if(a=="--qasm") qasm_path2=nx("--qasm"));
       else if(a=="--seed") seed2=std::stoull(nx("--seed")));
       else if(a=="--wrt") wrt=nx("--wrt"));
-      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx grad --circuit <file>|--qasm <file> [--wrt idx1,idx2,...] [--seed S]\n"; return 0; }
+      else if(a=="--method") method=nx("--method");
+      else if(a=="--qubits") gqubits=nx("--qubits");
+      else if(a=="--hamiltonian") gham=nx("--hamiltonian");
+      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx grad --circuit <file>|--qasm <file> [--wrt idx1,idx2,...] [--method adjoint|shift] [--qubits q1,q2,...|--hamiltonian <file>] [--seed S]\n"; return 0; }
       else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
       if ((int)mask.size()!=n){ std::cerr<<"--mask must be length N of 0/1\n"; return 4; }
       // n data qubits + ancilla q[n] (initialized |1> via X then H on all data, then CNOTs where mask=1)
@@ -154,22 +168,36 @@ int main(int argc, char** argv) {
     } else { std::cerr<<"Unknown arg: "<<a<<"\n"; return 2; }
     }
     if (circuit_path2.empty() && qasm_path2.empty()) { std::cerr<<"Missing --circuit or --qasm\n"; return 2; }
+    if (!gqubits.empty() && !gham.empty()) { std::cerr<<"--qubits cannot be combined with --hamiltonian\n"; return 2; }
     std::string err2; std::optional<qsx::Circuit> circ_opt2; if(!qasm_path2.empty()) circ_opt2=parse_qasm_file(qasm_path2,err2)); else circ_opt2=parse_circuit_file(circuit_path2,err2));
     if(!circ_opt2){ std::cerr<<err2<<"\n"; return 3; }
     auto circ2=*circ_opt2; std::vector<std::size_t> indices; if(!wrt.empty()){ size_t pos=0; while(pos<wrt.size()){ auto comma=wrt.find(',',pos)); auto tok=wrt.substr(pos, comma==std::string::npos? std::string::npos: comma-pos)); if(!tok.empty()) indices.push_back(std::stoull(tok))); if(comma==std::string::npos) break; pos=comma+1; } }
-    auto gr = grad_expZ_parameter_shift(circ2, indices, seed2)); if(!gr){ std::cerr<<"Grad failed\n"; return 10; }
+    // Adjoint differentiation by default; noisy circuits (sampled trajectories) use parameter-shift
+    if (method.empty()) method = qsx::is_sampling_deterministic(circ2) ? "adjoint" : "shift";
+    if (method!="adjoint" && method!="shift") { std::cerr<<"--method must be adjoint or shift\n"; return 2; }
+    // --qubits limits the adjoint sweeps to those <Z_q> (parameter-shift gets every qubit anyway)
+    std::vector<std::size_t> obs; for (size_t pos=0; pos<gqubits.size(); ){ auto comma=gqubits.find(',', pos); auto tok=gqubits.substr(pos, comma==std::string::npos? std::string::npos: comma-pos); if(!tok.empty()) obs.push_back(std::stoull(tok)); if(comma==std::string::npos) break; pos=comma+1; }
+    // --hamiltonian: one column, d<H>/d theta, plus <H> itself
+    std::optional<qsx::Hamiltonian> ham;
+    if (!gham.empty()) { ham = qsx::parse_hamiltonian_file(gham, circ2.nqubits, err2); if (!ham) { std::cerr<<err2<<"\n"; return 14; } }
+    std::optional<qsx::GradResult> gr;
+    if (ham) gr = method=="adjoint" ? qsx::grad_expectation_adjoint(circ2, *ham, indices) : qsx::grad_expectation_parameter_shift(circ2, *ham, indices, seed2);
+    else gr = method=="adjoint" ? qsx::grad_expZ_adjoint(circ2, indices, {}, obs) : grad_expZ_parameter_shift(circ2, indices, seed2);
+    if(!gr){ std::cerr<<"Grad failed"<<(method=="adjoint"?" (adjoint needs a noise-free circuit, RX/RY/RZ --wrt ops and valid --qubits)":"")<<"\n"; return 10; }
     // Print JSON to stdout
-    std::cout << "{\n  \"nqubits\": " << circ2.nqubits << ",\n  \"params\": ["; for(size_t i=0;i<gr->param_op_indices.size());++i){ std::cout<<gr->param_op_indices[i]; if(i+1<gr->param_op_indices.size()) std::cout<<", "; } std::cout<<"],\n  \"grads\": [\n";
+    std::cout << "{\n  \"nqubits\": " << circ2.nqubits << ",\n  \"method\": \"" << method << "\",\n"; if (ham) std::cout << "  \"expectation\": " << gr->expectation << ",\n"; std::cout << "  \"params\": ["; for(size_t i=0;i<gr->param_op_indices.size());++i){ std::cout<<gr->param_op_indices[i]; if(i+1<gr->param_op_indices.size()) std::cout<<", "; } std::cout<<"],\n  \"grads\": [\n";
     for(size_t i=0;i<gr->grads.size());++i){ std::cout<<"    ["; for(size_t q=0;q<gr->grads[i].size());++q){ std::cout<<gr->grads[i][q]; if(q+1<gr->grads[i].size()) std::cout<<", "; } std::cout<<"]"<<(i+1<gr->grads.size()?",":"")<<"\n"; }
     std::cout<<"  ]\n}\n"; return 0; }
   if (cmd == "unitary") {
-    std::string circuit_path2, qasm_path2, outp="unitary.csv";
+    std::string circuit_path2, qasm_path2, outp="unitary.csv", ufmt; bool usingle=false;
     for (int i=2;i<argc;i++){
       std::string a=argv[i]; auto nx=[&](const char* n){ if(i+1>=argc){std::cerr<<"Missing "<<n<<"\n"; return std::string()); } return std::string(argv[++i])); };
       if(a=="--circuit") circuit_path2=nx("--circuit"));
       else if(a=="--qasm") qasm_path2=nx("--qasm"));
       else if(a=="--out") outp=nx("--out"));
-      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx unitary --circuit <file>|--qasm <file> [--out unitary.csv]\n"; return 0; }
+      else if(a=="--format") ufmt=nx("--format"));
+      else if(a=="--single") usingle=true;
+      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx unitary --circuit <file>|--qasm <file> [--out unitary.csv|FILE.bin] [--format csv|bin] [--single]\n"; return 0; }
       else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
       if ((int)mask.size()!=n){ std::cerr<<"--mask must be length N of 0/1\n"; return 4; }
       // n data qubits + ancilla q[n] (initialized |1> via X then H on all data, then CNOTs where mask=1)
@@ -182,17 +210,24 @@ int main(int argc, char** argv) {
     if (circuit_path2.empty() && qasm_path2.empty()) { std::cerr<<"Missing --circuit or --qasm\n"; return 2; }
     std::string err2; std::optional<qsx::Circuit> circ_opt2; if(!qasm_path2.empty()) circ_opt2=parse_qasm_file(qasm_path2,err2)); else circ_opt2=parse_circuit_file(circuit_path2,err2));
     if(!circ_opt2){ std::cerr<<err2<<"\n"; return 3; }
-    if (!export_unitary_csv(*circ_opt2, outp)) { std::cerr<<"Failed to export unitary (too large or I/O error)\n"; return 12; }
+    // CSV materialises U; anything not named .csv streams the binary format column by column
+    if (ufmt.empty()) ufmt = (outp.size()>=4 && outp.compare(outp.size()-4, 4, ".csv")==0) ? "csv" : "bin";
+    if (ufmt!="csv" && ufmt!="bin") { std::cerr<<"--format must be csv or bin\n"; return 2; }
+    try {
+      const bool ok = ufmt=="csv" ? export_unitary_csv(*circ_opt2, outp) : export_unitary_binary(*circ_opt2, outp, usingle);
+      if (!ok) { std::cerr<<"Failed to export unitary ("<<(ufmt=="csv"?"too large for CSV, use --format bin, or ":"")<<"I/O error)\n"; return 12; }
+    } catch (const std::exception& e) { std::cerr<<e.what()<<"\n"; return 12; }
     std::cout<<"Wrote "<<outp<<"\n"; return 0; }
 
   if (cmd == "pauli") {
-    std::string circuit_path2, qasm_path2, pstr="Z0";
+    std::string circuit_path2, qasm_path2, pstr="Z0", ham_path;
     for (int i=2;i<argc;i++){
       std::string a=argv[i]; auto nx=[&](const char* n){ if(i+1>=argc){std::cerr<<"Missing "<<n<<"\n"; return std::string()); } return std::string(argv[++i])); };
       if(a=="--circuit") circuit_path2=nx("--circuit"));
       else if(a=="--qasm") qasm_path2=nx("--qasm"));
       else if(a=="--string") pstr=nx("--string"));
-      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx pauli --circuit <file>|--qasm <file> --string "X0Z1Y3"\n"; return 0; }
+      else if(a=="--hamiltonian") ham_path=nx("--hamiltonian");
+      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx pauli --circuit <file>|--qasm <file> --string "X0Z1Y3"|--hamiltonian <file>\n"; return 0; }
       else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
       if ((int)mask.size()!=n){ std::cerr<<"--mask must be length N of 0/1\n"; return 4; }
       // n data qubits + ancilla q[n] (initialized |1> via X then H on all data, then CNOTs where mask=1)
@@ -206,80 +241,18 @@ int main(int argc, char** argv) {
     std::string err2; std::optional<qsx::Circuit> circ_opt2; if(!qasm_path2.empty()) circ_opt2=parse_qasm_file(qasm_path2,err2)); else circ_opt2=parse_circuit_file(circuit_path2,err2));
     if(!circ_opt2){ std::cerr<<err2<<"\n"; return 3; }
     auto c2 = *circ_opt2;
-    // Build state-vector
-    auto r0 = run(c2, 123, false));
-    // Parse pauli string into masks
-    std::vector<char> op(c2.nqubits, 'I'));
-    for (size_t i=0;i<pstr.size());){
-      char t = pstr[i++]; if (i>=pstr.size()){ std::cerr<<"Bad pauli format\n"; return 14; }
-      std::string num; while(i<pstr.size() && std::isdigit((unsigned char)pstr[i])) num.push_back(pstr[i++]));
-      size_t q = std::stoull(num)); if (q>=c2.nqubits){ std::cerr<<"Qubit index out of range\n"; return 14; }
-      op[q]=std::toupper(t));
-    }
-    // Compute <P> from probabilities if only Z/I; otherwise from amplitudes (we don't have amplitudes exposed here, so recompute)
-    double val = 0.0;
-    bool onlyZI = true; for (auto ch: op) if (ch!='Z' && ch!='I') { onlyZI=false; break; }
-    if (onlyZI){
-      const auto& probs = r0.probabilities; size_t dim = probs.size());
-      for (size_t x=0;x<dim;++x){
-        int s=1;
-        for (size_t q=0;q<c2.nqubits;++q){ if (op[q]=='Z'){ s *= (((x>>q)&1)? -1: +1)); } }
-        val += s * probs[x];
-      }
-    } else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
-      if ((int)mask.size()!=n){ std::cerr<<"--mask must be length N of 0/1\n"; return 4; }
-      // n data qubits + ancilla q[n] (initialized |1> via X then H on all data, then CNOTs where mask=1)
-      for(int q=0;q<n;q++) out<<"H "<<q<<"\n";
-      out<<"X "<<n<<"\nH "<<n<<"\n";
-      for(int q=0;q<n;q++){ if (mask[q]=='1') out<<"CNOT "<<q<<" "<<n<<"\n"; }
-      out<<"H "<<n<<"\nMEASURE ALL\n";
+    // One Pauli string, or a weighted sum of them from --hamiltonian
+    qsx::Hamiltonian h; h.nqubits = c2.nqubits;
+    if (!ham_path.empty()) {
+      auto ho = qsx::parse_hamiltonian_file(ham_path, c2.nqubits, err2);
+      if (!ho) { std::cerr<<err2<<"\n"; return 14; }
+      h = *ho;
     } else {
-      // Re-run to extract amplitudes through StateVector path: replicate run() without measure
-      qsx::StateVector sv(c2.nqubits));
-      using namespace qsx::gates; qsx::c64 u00,u01,u10,u11;
-      for (const auto& g: c2.ops){
-        switch(g.type){
-          case OpType::H: H_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-          case OpType::X: X_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-          case OpType::Y: Y_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-          case OpType::Z: Z_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-          case OpType::S: S_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-          case OpType::RX: RX_coeffs(g.angle,u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-          case OpType::RY: RY_coeffs(g.angle,u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-          case OpType::RZ: RZ_coeffs(g.angle,u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-          case OpType::CNOT: sv.apply_cx(g.qubits[0], g.qubits[1])); break;
-          default: break;
-        }
-      }
-      const auto& a = sv.amplitudes());
-      // For a Pauli product P, <P> = sum_x conj(a_x) * (phase(x) * a_{x^flip}) + c.c. contributions combined below.
-      size_t flip=0; int y_phase_parity=0;
-      for (size_t q=0;q<c2.nqubits;++q){ if (op[q]=='X'||op[q]=='Y') flip |= (size_t(1)<<q)); if (op[q]=='Y') y_phase_parity ^= 1; }
-      val = 0.0;
-      for (size_t x=0;x<a.size());++x){
-        size_t y = x ^ flip;
-        qsx::c64 term = std::conj(a[x]) * a[y];
-        double phase = 1.0;
-        // Z contributes sign by bit parity
-        for (size_t q=0;q<c2.nqubits;++q){ if (op[q]=='Z'){ phase *= (((x>>q)&1)? -1.0 : +1.0)); } }
-        // Y contributes +/- i depending on bit at q; effectively multiply by (i * (-1)^{bit}) for each Y
-        double ph_re = 1.0, ph_im = 0.0;
-        for (size_t q=0;q<c2.nqubits;++q){
-          if (op[q]=='Y'){
-            int b = (x>>q)&1;
-            // multiply current phase by (b? -1 : +1) * i
-            double nr = -ph_im * (b? -1.0: +1.0));
-            double ni =  ph_re * (b? -1.0: +1.0));
-            ph_re = nr; ph_im = ni;
-          }
-        }
-        qsx::c64 ph = {ph_re*phase, ph_im*phase};
-        term *= ph;
-        val += term.real());
-      }
-      // Note: we intentionally take real part since <P> is real for Hermitian P.
+      auto t = qsx::parse_pauli_string(pstr, c2.nqubits, err2);
+      if (!t) { std::cerr<<err2<<"\n"; return 14; }
+      h.terms.push_back(*t);
     }
-    std::cout << val << "\n"; return 0;
+    std::cout << qsx::expectation(build_state(c2), h) << "\n"; return 0;
   }
 
 
@@ -349,7 +322,7 @@ int main(int argc, char** argv) {
 
 
   if (cmd == "sweep") {
-    std::string circuit_path2, qasm_path2, which="RZ"; std::size_t index=0; double start= -3.14159, stop=3.14159; int steps=41; std::string outp="sweep.csv";
+    std::string circuit_path2, qasm_path2, which="RZ"; std::size_t index=0; double start= -3.14159, stop=3.14159; int steps=41; std::string outp="sweep.csv"; std::string sparam=""; std::string sbind="";
     for (int i=2;i<argc;i++){
       std::string a=argv[i]; auto nx=[&](const char* n){ if(i+1>=argc){std::cerr<<"Missing "<<n<<"\n"; return std::string()); } return std::string(argv[++i])); };
       if(a=="--circuit") circuit_path2=nx("--circuit"));
@@ -360,7 +333,9 @@ int main(int argc, char** argv) {
       else if(a=="--stop") stop=std::stod(nx("--stop")));
       else if(a=="--steps") steps=std::stoi(nx("--steps")));
       else if(a=="--out") outp=nx("--out"));
-      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx sweep --circuit|--qasm <file> --gate RZ|RX|RY --index k [--start a --stop b --steps N] [--out sweep.csv]\n"; return 0; }
+      else if(a=="--param") sparam=nx("--param");
+      else if(a=="--bind") sbind=nx("--bind");
+      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx sweep --circuit|--qasm <file> (--gate RZ|RX|RY --index k | --param NAME) [--bind name=v,...] [--start a --stop b --steps N] [--out sweep.csv]\n"; return 0; }
       else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
       if ((int)mask.size()!=n){ std::cerr<<"--mask must be length N of 0/1\n"; return 4; }
       // n data qubits + ancilla q[n] (initialized |1> via X then H on all data, then CNOTs where mask=1)
@@ -373,22 +348,117 @@ int main(int argc, char** argv) {
     if (circuit_path2.empty() && qasm_path2.empty()) { std::cerr<<"Missing --circuit or --qasm\n"; return 2; }
     std::string err2; std::optional<qsx::Circuit> circ_opt2; if(!qasm_path2.empty()) circ_opt2=parse_qasm_file(qasm_path2,err2)); else circ_opt2=parse_circuit_file(circuit_path2,err2));
     if(!circ_opt2){ std::cerr<<err2<<"\n"; return 3; }
-    auto c2=*circ_opt2; std::ofstream out(outp)); if(!out){ std::cerr<<"Cannot write output\n"; return 4; }
+    auto c2=*circ_opt2;
+    std::map<std::string,double> fixed;
+    if (!sbind.empty() && !parse_bindings(sbind, c2, fixed, err2)) { std::cerr<<err2<<"\n"; return 2; }
+    if (fixed.count(sparam)) { std::cerr<<"--bind sets the swept parameter\n"; return 2; }
+    c2 = qsx::bind_parameters(c2, fixed);
+    // --gate/--index: the chosen op becomes a parameter of its own
+    if (sparam.empty()) {
+      sparam = "sweep.theta";
+      size_t seen=0; bool found=false;
+      for (auto& op : c2.ops){ if ((which=="RZ"&&op.type==OpType::RZ)||(which=="RX"&&op.type==OpType::RX)||(which=="RY"&&op.type==OpType::RY)){ if(seen==index){ op.angle=0.0; op.param=sparam; op.param_scale=1.0; found=true; break; } ++seen; } }
+      if (!found) { std::cerr<<"No "<<which<<" op with --index "<<index<<"\n"; return 2; }
+    }
+    // Planned once; steps differ only in the swept angle (parameters not in --bind stay 0)
+    auto cc = qsx::compile_circuit(c2);
+    const auto slot = std::find(cc.parameters.begin(), cc.parameters.end(), sparam);
+    if (slot == cc.parameters.end()) { std::cerr<<"Unknown parameter: "<<sparam<<"\n"; return 2; }
+    std::vector<double> vals(cc.parameters.size(), 0.0);
+    std::ofstream out(outp); if(!out){ std::cerr<<"Cannot write output\n"; return 4; }
     out << "theta,expZ0"; for(size_t q=1;q<c2.nqubits;++q) out << ",expZ" << q; out << "\n";
-    for (int i=0;i<steps;i++){
-      double t = start + (stop-start) * (double(i)/(steps-1)));
-      // set angle on matching op index and type
-      size_t seen=0; for (auto& op : c2.ops){ if ((which=="RZ"&&op.type==OpType::RZ)||(which=="RX"&&op.type==OpType::RX)||(which=="RY"&&op.type==OpType::RY)){ if(seen==index){ op.angle=t; break; } ++seen; } }
-      auto rr = run(c2, 123, false));
-      // compute expZ
-      std::vector<double> ez(c2.nqubits,0.0));
-      for (std::size_t q=0;q<c2.nqubits;++q){ double z=0.0; for (std::size_t x=0;x<rr.probabilities.size());++x){ int b=(x>>q)&1; z += (b? -rr.probabilities[x] : rr.probabilities[x])); } ez[q]=z; }
-      out << t; for (double v: ez) out << "," << v; out << "\n";
+    // The windows before the swept parameter's first gate run once; every batch resumes from there
+    qsx::bind_parameters(cc, vals);
+    const std::size_t from = qsx::parameter_window(cc, std::size_t(slot - cc.parameters.begin()));
+    qsx::StateVector prefix(c2.nqubits), sv(c2.nqubits);
+    qsx::Rng prefix_rng(123);
+    qsx::execute(prefix, cc, prefix_rng, 0, from);
+    // Steps run batch_width() at a time as one batched state
+    const int width = int(qsx::batch_width(c2.nqubits, std::size_t(steps)));
+    qsx::BatchedStateVector batch(c2.nqubits, std::size_t(width));
+    std::vector<std::vector<double>> lanes;
+    std::vector<double> thetas;
+    for (int i0=0;i0<steps;i0+=width){
+      lanes.clear(); thetas.clear();
+      for (int i=i0;i<std::min(steps, i0+width);i++){
+        double t = start + (stop-start) * (double(i)/(steps-1));
+        vals[slot - cc.parameters.begin()] = t;
+        lanes.push_back(vals); thetas.push_back(t);
+      }
+      batch.assign(prefix); qsx::Rng rng = prefix_rng;
+      qsx::execute(batch, cc, lanes, rng, from);
+      for (size_t j=0;j<thetas.size();++j){
+        batch.extract(j, sv);
+        auto ez = expect_z_all(sv.amplitudes(), c2.nqubits);
+        out << thetas[j]; for (double v: ez) out << "," << v; out << "\n";
+      }
     }
     std::cout << "Wrote " << outp << "\n"; return 0;
   }
 
 
+  if (cmd == "param-batch") {
+    std::string circuit_path2, qasm_path2, bindings_path, bham, outp="param_batch.csv"; uint64_t seed2=123; qsx::RunOptions bopts;
+    for (int i=2;i<argc;i++){
+      std::string a=argv[i]; auto nx=[&](const char* n){ if(i+1>=argc){std::cerr<<"Missing "<<n<<"\n"; return std::string(); } return std::string(argv[++i]); };
+      if(a=="--circuit") circuit_path2=nx("--circuit");
+      else if(a=="--qasm") qasm_path2=nx("--qasm");
+      else if(a=="--bindings") bindings_path=nx("--bindings");
+      else if(a=="--hamiltonian") bham=nx("--hamiltonian");
+      else if(a=="--seed") seed2=std::stoull(nx("--seed"));
+      else if(a=="--fuse") bopts.fuse_qubits=std::stoull(nx("--fuse"));
+      else if(a=="--out") outp=nx("--out");
+      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx param-batch --circuit|--qasm <file> --bindings <values.csv> [--hamiltonian <file>] [--fuse K] [--seed S] [--out param_batch.csv]\n"; return 0; }
+      else { std::cerr<<"Unknown arg: "<<a<<"\n"; return 2; }
+    }
+    if (circuit_path2.empty() && qasm_path2.empty()) { std::cerr<<"Missing --circuit or --qasm\n"; return 2; }
+    if (bindings_path.empty()) { std::cerr<<"Missing --bindings\n"; return 2; }
+    std::string err2; std::optional<qsx::Circuit> circ_opt2; if(!qasm_path2.empty()) circ_opt2=parse_qasm_file(qasm_path2,err2); else circ_opt2=parse_circuit_file(circuit_path2,err2);
+    if(!circ_opt2){ std::cerr<<err2<<"\n"; return 3; }
+    const auto cc = qsx::compile_circuit(*circ_opt2, bopts);
+    const std::size_t n = cc.nqubits;
+    // Header row: parameter names in any order (all of them); then one row of values per binding
+    std::ifstream in(bindings_path); if(!in){ std::cerr<<"Cannot open "<<bindings_path<<"\n"; return 3; }
+    std::vector<std::string> header; std::vector<std::size_t> column; std::vector<std::vector<double>> bindings;
+    for (std::string line; std::getline(in, line); ){
+      if (!line.empty() && line.back()=='\r') line.pop_back();
+      if (line.empty() || line[0]=='#') continue;
+      auto cells = split_str(line, ',');
+      if (header.empty()){
+        header = cells;
+        for (const auto& name : cc.parameters){
+          auto it = std::find(header.begin(), header.end(), name);
+          if (it == header.end()) { std::cerr<<"Missing column for parameter "<<name<<"\n"; return 2; }
+          column.push_back(std::size_t(it - header.begin()));
+        }
+        continue;
+      }
+      if (cells.size() != header.size()) { std::cerr<<"Expected "<<header.size()<<" values: "<<line<<"\n"; return 2; }
+      std::vector<double> v;
+      try { for (auto k : column) v.push_back(std::stod(cells[k])); } catch (...) { std::cerr<<"Bad value: "<<line<<"\n"; return 2; }
+      bindings.push_back(std::move(v));
+    }
+    std::optional<qsx::Hamiltonian> ham;
+    if (!bham.empty()) { ham = qsx::parse_hamiltonian_file(bham, n, err2); if (!ham) { std::cerr<<err2<<"\n"; return 14; } }
+    // One row of results per binding: <H>, or <Z_q> for every qubit
+    std::vector<std::vector<double>> results(bindings.size());
+    qsx::evaluate_batch(cc, bindings, seed2, [&](std::size_t b, const qsx::StateVector& sv){
+      results[b] = ham ? std::vector<double>{qsx::expectation(sv.amplitudes(), *ham)} : expect_z_all(sv.amplitudes(), n);
+    });
+    std::ofstream out(outp); if(!out){ std::cerr<<"Cannot write output\n"; return 4; }
+    out.precision(12);
+    for (const auto& name : cc.parameters) out << name << ",";
+    if (ham) out << "energy"; else for (std::size_t q=0;q<n;++q) out << "expZ" << q << (q+1<n ? "," : "");
+    out << "\n";
+    for (std::size_t b=0;b<bindings.size();++b){
+      for (double v : bindings[b]) out << v << ",";
+      for (std::size_t k=0;k<results[b].size();++k) out << results[b][k] << (k+1<results[b].size() ? "," : "");
+      out << "\n";
+    }
+    std::cout << "Wrote " << outp << " (" << bindings.size() << " bindings)\n"; return 0;
+  }
+
+
   if (cmd == "bench") {
     int n=5; int shots=1000; std::string backend="state"; std::string outp="bench.json";
     for (int i=2;i<argc;i++){
@@ -413,31 +483,8 @@ int main(int argc, char** argv) {
     for(int i=1;i<n;i++) c.ops.push_back({OpType::CNOT,{0,(std::size_t)i},0.0}));
     c.ops.push_back({OpType::MEASURE,{},0.0}));
     auto t0 = std::chrono::steady_clock::now());
-    // emulate run loop
-    std::vector<std::vector<int>> outcomes; outcomes.reserve(shots));
-    std::map<std::string,int> counts;
-    std::vector<double> probs;
-    uint64_t seed=123;
-    for (int s=0;s<shots;++s){
-      if (backend=="density"){
-        auto r = run(c, seed + s, true));
-        if (s==0) probs = r.probabilities;
-        outcomes.push_back(r.outcome));
-        counts[bits_to_string(r.outcome)] += 1;
-      } else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
-      if ((int)mask.size()!=n){ std::cerr<<"--mask must be length N of 0/1\n"; return 4; }
-      // n data qubits + ancilla q[n] (initialized |1> via X then H on all data, then CNOTs where mask=1)
-      for(int q=0;q<n;q++) out<<"H "<<q<<"\n";
-      out<<"X "<<n<<"\nH "<<n<<"\n";
-      for(int q=0;q<n;q++){ if (mask[q]=='1') out<<"CNOT "<<q<<" "<<n<<"\n"; }
-      out<<"H "<<n<<"\nMEASURE ALL\n";
-    } else {
-        auto r = run(c, seed + s, false));
-        if (s==0) probs = r.probabilities;
-        outcomes.push_back(r.outcome));
-        counts[bits_to_string(r.outcome)] += 1;
-      }
-    }
+    // One simulation per benchmark; shots are sampled from the final distribution
+    auto sr = qsx::run_shots(c, shots, 123, true); (void)sr;
     auto t1 = std::chrono::steady_clock::now());
     std::chrono::duration<double> dt = t1 - t0;
     std::ofstream out(outp));
@@ -544,9 +591,9 @@ int main(int argc, char** argv) {
     auto circ = *circ_opt;
     if (do_opt) circ = optimize(circ, {}));
     if (map_line) circ = map_to_line(circ));
-    // Memory estimate guard (same as run)
+    // Memory estimate guard (same as run); the density backend uses packed storage
     auto estimate_bytes = [&](const std::string& be)->unsigned long long{
-      if (be=="density") { long double sz = powl(2.0L, circ.nqubits*2) * (long double)sizeof(qsx::c64)); return (unsigned long long)sz; }
+      if (be=="density") { long double d = powl(2.0L, circ.nqubits); return (unsigned long long)(d * (d + 1.0L) / 2.0L * (long double)sizeof(qsx::c64)); }
       long double sz = powl(2.0L, circ.nqubits) * (long double)sizeof(qsx::c64)); return (unsigned long long)sz;
     };
     unsigned long long need = estimate_bytes(backend));
@@ -564,7 +611,7 @@ int main(int argc, char** argv) {
       int end   = (shots * (t+1)) / threads;
       for (int s=start; s<end; ++s){
         if (backend=="density"){
-          auto r = run(circ, seed + s, true));
+          auto r = qsx::run_density(circ, seed + s, false, qsx::DensityMode::Packed);
           if (s==0){
             std::lock_guard<std::mutex> lk(mtx));
             if (probs.empty()) probs = r.probabilities;
@@ -593,10 +640,18 @@ int main(int argc, char** argv) {
     };
 
     if (threads < 1) threads = 1;
-    std::vector<std::thread> pool; pool.reserve(threads));
-    auto t0 = std::chrono::steady_clock::now());
-    for (int t=0; t<threads; ++t) pool.emplace_back(worker, t));
-    for (auto& th: pool) th.join());
+    std::vector<std::thread> pool; pool.reserve(threads);
+    auto t0 = std::chrono::steady_clock::now();
+    if (qsx::is_sampling_deterministic(circ)){
+      // Terminal measurement only: simulate once and draw every shot from the final distribution
+      auto sr = qsx::run_shots(circ, shots, seed, true);
+      probs = std::move(sr.probabilities);
+      for (int s=0; s<shots; ++s) outcomes[s] = qsx::basis_to_bits(sr.outcomes[s], circ.nqubits);
+      for (const auto& [idx, cnt] : sr.histogram) counts[bits_to_string(qsx::basis_to_bits(idx, circ.nqubits))] += (int)cnt;
+    } else {
+      for (int t=0; t<threads; ++t) pool.emplace_back(worker, t);
+      for (auto& th: pool) th.join();
+    }
     auto t1 = std::chrono::steady_clock::now());
     std::chrono::duration<double> dt = t1 - t0;
 
@@ -616,13 +671,14 @@ int main(int argc, char** argv) {
 
 
   if (cmd == "stats") {
-    std::string circuit_path, qasm_path; bool map_line=false;
+    std::string circuit_path, qasm_path; bool map_line=false; std::size_t fuse_k=3;
     for (int i=2;i<argc;i++){
       std::string a=argv[i]; auto nx=[&](const char* n){ if(i+1>=argc){std::cerr<<"Missing "<<n<<"\\n"; return std::string()); } return std::string(argv[++i])); };
       if (a=="--circuit") circuit_path=nx("--circuit"));
       else if (a=="--qasm") qasm_path=nx("--qasm"));
       else if (a=="--map-line") map_line=true;
-      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx stats --circuit <file>|--qasm <file> [--map-line]\\n"; return 0; }
+      else if (a=="--fuse") fuse_k=std::stoull(nx("--fuse"));
+      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx stats --circuit <file>|--qasm <file> [--map-line] [--fuse K]\\n"; return 0; }
       else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
       if ((int)mask.size()!=n){ std::cerr<<"--mask must be length N of 0/1\n"; return 4; }
       // n data qubits + ancilla q[n] (initialized |1> via X then H on all data, then CNOTs where mask=1)
@@ -641,7 +697,7 @@ int main(int argc, char** argv) {
     size_t oneq=0, twoq=0, meas=0, noise=0;
     for (auto& op: c.ops){
       if (op.type==OpType::MEASURE) ++meas;
-      else if (op.type==OpType::CNOT) ++twoq;
+      else if (op.qubits.size() >= 2) ++twoq;
       else if (op.type==OpType::DEPHASE || op.type==OpType::DEPOL || op.type==OpType::AMPDAMP) ++noise;
       else ++oneq;
     }
@@ -661,7 +717,11 @@ int main(int argc, char** argv) {
     }
     auto sv_mem = (1ULL<<c.nqubits) * sizeof(qsx::c64));
     auto dm_mem = (1ULL<<(2*c.nqubits)) * sizeof(qsx::c64));
-    std::cout << "{\\n  \\\"nqubits\\\": " << c.nqubits << ",\\n  \\\"oneq\\\": " << oneq << ",\\n  \\\"twoq\\\": " << twoq << ",\\n  \\\"measure\\\": " << meas << ",\\n  \\\"noise\\\": " << noise << ",\\n  \\\"approx_depth\\\": " << depth << ",\\n  \\\"mem_bytes_state\\\": " << sv_mem << ",\\n  \\\"mem_bytes_density\\\": " << dm_mem << "\\n}\\n";
+    // State sweeps after execution-time gate fusion (run --fuse K)
+    auto fused = qsx::fuse_gates(c, fuse_k);
+    // Density-matrix passes after channel fusion (run --backend density)
+    auto dprog = qsx::compile_density(c, true);
+    std::cout << "{\\n  \\\"nqubits\\\": " << c.nqubits << ",\\n  \\\"oneq\\\": " << oneq << ",\\n  \\\"twoq\\\": " << twoq << ",\\n  \\\"measure\\\": " << meas << ",\\n  \\\"noise\\\": " << noise << ",\\n  \\\"approx_depth\\\": " << depth << ",\\n  \\\"fuse_qubits\\\": " << fused.max_qubits << ",\\n  \\\"fused_ops\\\": " << fused.fused_gates << ",\\n  \\\"density_passes\\\": " << dprog.steps.size() << ",\\n  \\\"mem_bytes_state\\\": " << sv_mem << ",\\n  \\\"mem_bytes_density\\\": " << dm_mem << "\\n}\\n";
     return 0;
   }
 
@@ -695,10 +755,14 @@ int main(int argc, char** argv) {
       else if (op.type==OpType::Y) out << "y q["<<op.qubits[0]<<"];\\n";
       else if (op.type==OpType::Z) out << "z q["<<op.qubits[0]<<"];\\n";
       else if (op.type==OpType::S) out << "s q["<<op.qubits[0]<<"];\\n";
-      else if (op.type==OpType::RX) out << "rx("<<op.angle<<") q["<<op.qubits[0]<<"];\\n";
-      else if (op.type==OpType::RY) out << "ry("<<op.angle<<") q["<<op.qubits[0]<<"];\\n";
-      else if (op.type==OpType::RZ) out << "rz("<<op.angle<<") q["<<op.qubits[0]<<"];\\n";
+      else if (op.type==OpType::RX) out << "rx("<<qsx::format_angle(op)<<") q["<<op.qubits[0]<<"];\\n";
+      else if (op.type==OpType::RY) out << "ry("<<qsx::format_angle(op)<<") q["<<op.qubits[0]<<"];\\n";
+      else if (op.type==OpType::RZ) out << "rz("<<qsx::format_angle(op)<<") q["<<op.qubits[0]<<"];\\n";
       else if (op.type==OpType::CNOT) out << "cx q["<<op.qubits[0]<<"], q["<<op.qubits[1]<<"];\\n";
+      else if (op.type==OpType::CCX) out << "ccx q["<<op.qubits[0]<<"], q["<<op.qubits[1]<<"], q["<<op.qubits[2]<<"];\\n";
+      else if (op.type==OpType::CZ) out << "cz q["<<op.qubits[0]<<"], q["<<op.qubits[1]<<"];\\n";
+      else if (op.type==OpType::SWAP) out << "swap q["<<op.qubits[0]<<"], q["<<op.qubits[1]<<"];\\n";
+      else if (op.type==OpType::U3) out << "u3("<<op.params[0]<<","<<op.params[1]<<","<<op.params[2]<<") q["<<op.qubits[0]<<"];\\n";
       else if (op.type==OpType::MEASURE) { for (std::size_t i=0;i<c.nqubits;++i) out << "measure q["<<i<<"] -> c["<<i<<"];\\n"; }
       else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
       if ((int)mask.size()!=n){ std::cerr<<"--mask must be length N of 0/1\n"; return 4; }
@@ -812,6 +876,48 @@ int main(int argc, char** argv) {
     return (errsum < 1e-9) ? 0 : 20;
   }
 
+  if (cmd == "equiv") {
+    std::string circuit_path, qasm_path, with_path, topo_path; bool eq_opt=false, eq_line=false; uint64_t eseed=123;
+    qsx::EquivOptions eo;
+    for (int i=2;i<argc;i++){
+      std::string a=argv[i]; auto nx=[&](const char* n){ if(i+1>=argc){std::cerr<<"Missing "<<n<<"\n"; return std::string(); } return std::string(argv[++i]); };
+      if (a=="--circuit") circuit_path=nx("--circuit");
+      else if (a=="--qasm") qasm_path=nx("--qasm");
+      else if (a=="--with") with_path=nx("--with");
+      else if (a=="--optimize") eq_opt=true;
+      else if (a=="--map-line") eq_line=true;
+      else if (a=="--map-topology") topo_path=nx("--map-topology");
+      else if (a=="--trials") eo.trials=std::stoull(nx("--trials"));
+      else if (a=="--confidence") eo.confidence=std::stod(nx("--confidence"));
+      else if (a=="--tol") eo.tolerance=std::stod(nx("--tol"));
+      else if (a=="--seed") eseed=std::stoull(nx("--seed"));
+      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx equiv --circuit <file>|--qasm <file> (--with <file>|--optimize|--map-line|--map-topology <file>) [--trials K] [--confidence C] [--tol E] [--seed S]\n"; return 0; }
+      else { std::cerr<<"Unknown arg: "<<a<<"\n"; return 2; }
+    }
+    if (circuit_path.empty() && qasm_path.empty()) { std::cerr<<"Missing --circuit or --qasm\n"; return 2; }
+    if (int(!with_path.empty()) + int(eq_opt) + int(eq_line) + int(!topo_path.empty()) != 1) { std::cerr<<"Give exactly one of --with, --optimize, --map-line, --map-topology\n"; return 2; }
+    std::string err; std::optional<qsx::Circuit> copt; if(!qasm_path.empty()) copt=parse_qasm_file(qasm_path, err); else copt=parse_circuit_file(circuit_path, err);
+    if (!copt) { std::cerr<<err<<"\n"; return 3; }
+    qsx::Circuit other;
+    if (!with_path.empty()) {
+      // --with is read as QASM when it ends in .qasm
+      std::optional<qsx::Circuit> wopt;
+      if (with_path.size()>=5 && with_path.compare(with_path.size()-5, 5, ".qasm")==0) wopt=parse_qasm_file(with_path, err); else wopt=parse_circuit_file(with_path, err);
+      if (!wopt) { std::cerr<<err<<"\n"; return 3; }
+      other = *wopt;
+    } else if (eq_opt) other = qsx::optimize(*copt);
+    else if (eq_line) other = qsx::map_to_line(*copt, &eo.output_layout);
+    else other = qsx::map_to_topology(*copt, qsx::read_topology(topo_path, copt->nqubits), &eo.output_layout);
+    qsx::EquivResult er;
+    try { er = qsx::check_equivalence(*copt, other, eseed, eo); }
+    catch (const std::exception& e) { std::cerr<<e.what()<<"\n"; return 4; }
+    std::cout << "{\n  \"equivalent\": " << (er.equivalent?"true":"false") << ",\n  \"trials\": " << er.trials
+              << ",\n  \"max_deviation\": " << er.max_deviation << ",\n  \"phase\": [" << er.phase.real() << ", " << er.phase.imag() << "]";
+    if (!er.equivalent) std::cout << ",\n  \"first_mismatch\": " << er.first_mismatch;
+    std::cout << "\n}\n";
+    return er.equivalent ? 0 : 20;
+  }
+
 
   if (cmd == "zne") {
     std::string circuit_path, qasm_path; std::vector<double> scales; int target_q=0;
@@ -836,6 +942,7 @@ int main(int argc, char** argv) {
     std::string err; std::optional<qsx::Circuit> copt; if(!qasm_path.empty()) copt=parse_qasm_file(qasm_path, err)); else copt=parse_circuit_file(circuit_path, err));
     if (!copt) { std::cerr<<err<<"\\n"; return 3; }
     auto c = *copt;
+    if (target_q < 0 || std::size_t(target_q) >= c.nqubits){ std::cerr<<"--q out of range\\n"; return 2; }
     // For each scale, multiply noise probabilities
     auto apply_scale = [&](qsx::Circuit ci, double s)->qsx::Circuit{
       for (auto& op: ci.ops){
@@ -848,7 +955,7 @@ int main(int argc, char** argv) {
       auto cs = apply_scale(c, s));
       auto r = run(cs, 777, true)); // density to honor noise
       // compute <Z_q>
-      double z=0.0; for (size_t i=0;i<r.probabilities.size());++i){ int bit=(i>>target_q)&1; z += (bit? -r.probabilities[i] : r.probabilities[i])); }
+      double z = expect_z_all(r.probabilities, cs.nqubits)[target_q];
       pts.push_back({s, z}));
     }
     // Linear extrapolation to s=0
@@ -937,23 +1044,7 @@ int main(int argc, char** argv) {
     std::size_t d = std::size_t(1) << c2.nqubits;
     if (d > (1u<<16)) { std::cerr<<"State export limited to n<=16\\n"; return 12; }
     // Recompute amplitudes via StateVector path
-    qsx::StateVector sv(c2.nqubits));
-    using namespace qsx::gates; qsx::c64 u00,u01,u10,u11;
-    for (const auto& g: c2.ops){
-      switch(g.type){
-        case OpType::H: H_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-        case OpType::X: X_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-        case OpType::Y: Y_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-        case OpType::Z: Z_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-        case OpType::S: S_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-        case OpType::RX: RX_coeffs(g.angle,u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-        case OpType::RY: RY_coeffs(g.angle,u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-        case OpType::RZ: RZ_coeffs(g.angle,u00,u01,u10,u11)); sv.apply_gate_1q(g.qubits[0],u00,u01,u10,u11)); break;
-        case OpType::CNOT: sv.apply_cx(g.qubits[0], g.qubits[1])); break;
-        default: break;
-      }
-    }
-    auto& a = sv.amplitudes());
+    auto a = build_state(c2);
     std::ofstream out(outp)); if(!out){ std::cerr<<"Cannot write output\\n"; return 4; }
     for (std::size_t i=0;i<a.size());++i){
       out << std::real(a[i]) << "," << std::imag(a[i]) << "\\n";
@@ -973,7 +1064,7 @@ int main(int argc, char** argv) {
       else if (a=="--seed") seed=std::stoull(nx("--seed")));
       else if (a=="--optimize") do_opt=true;
       else if (a=="--map-line") map_line=true;
-      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx stream --circuit <file>|--qasm <file> [--backend state|density] [--shots K] [--seed S] [--optimize] [--map-line]\\n"; return 0; }
+      else if(a=="--help"||a=="-h"){ std::cout<<"quantum-simx stream --circuit <file>|--qasm <file> [--backend state|density] [--shots K] [--seed S] [--optimize] [--map-line]\n"; return 0; }
       else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
       if ((int)mask.size()!=n){ std::cerr<<"--mask must be length N of 0/1\n"; return 4; }
       // n data qubits + ancilla q[n] (initialized |1> via X then H on all data, then CNOTs where mask=1)
@@ -990,8 +1081,8 @@ int main(int argc, char** argv) {
     if (do_opt) circ = optimize(circ, {}));
     if (map_line) circ = map_to_line(circ));
 
-    // header line: probabilities (first shot) and provenance
-    auto r0 = run(circ, seed, backend=="density"));
+    // header line: probabilities and provenance (one multi-shot execution feeds every shot)
+    auto sr = qsx::run_shots(circ, shots, seed, true);
     uint64_t hcirc = hash_circuit(circ));
     #ifdef QSX_VERSION
     const char* ver = QSX_VERSION;
@@ -1000,23 +1091,19 @@ int main(int argc, char** argv) {
   uint64_t topoHash = 0ULL; if (!map_topology_file.empty()){ std::ifstream tin(map_topology_file, std::ios::binary); std::string tb((std::istreambuf_iterator<char>(tin)), std::istreambuf_iterator<char>()); topoHash = hash_bytes(tb); }
     #endif
     std::cout << "{\"type\":\"header\",\"nqubits\":" << circ.nqubits << ",\"version\":\"" << ver << "\",\"inputHashFNV1a\":" << hcirc << ",\"probabilities\":[";
-    for (size_t i=0;i<r0.probabilities.size());++i){ std::cout<<r0.probabilities[i]; if (i+1<r0.probabilities.size()) std::cout<<","; }
-    std::cout << "]}\\n";
+    for (size_t i=0;i<sr.probabilities.size();++i){ std::cout<<sr.probabilities[i]; if (i+1<sr.probabilities.size()) std::cout<<","; }
+    std::cout << "]}\n";
 
     std::map<std::string,int> counts;
-    // emit first shot
-    std::cout << "{\"type\":\"shot\",\"i\":0,\"outcome\":\"" << bits_to_string(r0.outcome) << "\"}\\n";
-    counts[bits_to_string(r0.outcome)] += 1;
-    for (int s=1; s<shots; ++s){
-      auto r = run(circ, seed + s, backend=="density"));
-      std::string key = bits_to_string(r.outcome));
+    for (int s=0; s<shots; ++s){
+      std::string key = bits_to_string(qsx::basis_to_bits(sr.outcomes[s], circ.nqubits));
       counts[key] += 1;
-      std::cout << "{\"type\":\"shot\",\"i\":"<<s<<",\"outcome\":\""<<key<<"\"}\\n";
+      std::cout << "{\"type\":\"shot\",\"i\":"<<s<<",\"outcome\":\""<<key<<"\"}\n";
     }
     // footer
     std::cout << "{\"type\":\"footer\",\"counts\":{";
-    size_t k=0; for (auto it=counts.begin()); it!=counts.end()); ++it,++k){ std::cout << "\"" << it->first << "\":" << it->second << (std::next(it)!=counts.end()? ",":"")); }
-    std::cout << "}}\\n";
+    size_t k=0; for (auto it=counts.begin(); it!=counts.end(); ++it,++k){ std::cout << "\"" << it->first << "\":" << it->second << (std::next(it)!=counts.end()? ",":""); }
+    std::cout << "}}\n";
     return 0;
   }
 
@@ -1164,21 +1251,15 @@ int main(int argc, char** argv) {
       }
     }
     c.ops.push_back({OpType::MEASURE,{},0.0}));
-    // Ideal distribution (state backend)
-    auto r0 = run(c, seed, false));
-    std::vector<double> p = r0.probabilities;
+    // Ideal distribution and sampled shots from a single state-backend simulation
+    auto sr = qsx::run_shots(c, shots, seed + 123);
+    const std::vector<double>& p = sr.probabilities;
     // heavy set = {x | p(x) > median(p)}
     std::vector<double> sorted=p; std::sort(sorted.begin(), sorted.end()));
     double med = sorted[sorted.size()/2];
     // sample shots
     int heavy=0;
-    for (int s=0;s<shots;++s){
-      auto r = run(c, seed + 123 + s, false));
-      std::string key = bits_to_string(r.outcome));
-      // index outcome to integer
-      size_t idx=0; for (size_t i=0;i<r.outcome.size());++i){ if (r.outcome[i]) idx |= (1ull<<i)); }
-      if (p[idx] > med) heavy++;
-    }
+    for (const auto& [idx, cnt] : sr.histogram){ if (p[idx] > med) heavy += (int)cnt; }
     double hogp = (double)heavy / (double)shots;
     std::cout << "{\\n  \\\"n\\\": " << n << ",\\n  \\\"depth\\\": " << depth << ",\\n  \\\"shots\\\": " << shots << ",\\n  \\\"heavy_output_fraction\\\": " << hogp << "\\n}\\n";
     return 0;
@@ -1331,14 +1412,19 @@ int main(int argc, char** argv) {
         case OpType::Y: out << "Y " << op.qubits[0]; break;
         case OpType::Z: out << "Z " << op.qubits[0]; break;
         case OpType::S: out << "S " << op.qubits[0]; break;
-        case OpType::RX: out << "RX " << op.qubits[0] << " " << op.angle; break;
-        case OpType::RY: out << "RY " << op.qubits[0] << " " << op.angle; break;
-        case OpType::RZ: out << "RZ " << op.qubits[0] << " " << op.angle; break;
+        case OpType::RX: out << "RX " << op.qubits[0] << " " << qsx::format_angle(op); break;
+        case OpType::RY: out << "RY " << op.qubits[0] << " " << qsx::format_angle(op); break;
+        case OpType::RZ: out << "RZ " << op.qubits[0] << " " << qsx::format_angle(op); break;
         case OpType::CNOT: out << "CNOT " << op.qubits[0] << " " << op.qubits[1]; break;
         case OpType::MEASURE: out << "MEASURE ALL"; break;
         case OpType::DEPHASE: out << "DEPHASE " << (op.qubits.empty()?0:op.qubits[0]) << " " << op.angle; break;
         case OpType::DEPOL: out << "DEPOL " << (op.qubits.empty()?0:op.qubits[0]) << " " << op.angle; break;
         case OpType::AMPDAMP: out << "AMPDAMP " << (op.qubits.empty()?0:op.qubits[0]) << " " << op.angle; break;
+        case OpType::CCX: out << "CCX " << op.qubits[0] << " " << op.qubits[1] << " " << op.qubits[2]; break;
+        case OpType::CZ: out << "CZ " << op.qubits[0] << " " << op.qubits[1]; break;
+        case OpType::SWAP: out << "SWAP " << op.qubits[0] << " " << op.qubits[1]; break;
+        case OpType::U3: out << "U3 " << op.qubits[0]; for (double p : op.params) out << " " << p; break;
+        case OpType::U2Q: out << "U2Q " << op.qubits[0] << " " << op.qubits[1]; for (double p : op.params) out << " " << p; break;
       }
       out << "\\n";
     }
@@ -1350,8 +1436,10 @@ int main(int argc, char** argv) {
   std::string circuit_path; std::string qasm_path;
   std::size_t qubits = 0;
   uint64_t seed = 12345;
+  qsx::RunOptions run_opts; bool show_profile = false; qsx::ExecProfile exec_profile; qsx::DensityMode density_mode = qsx::DensityMode::Matrix; std::size_t density_passes = 0;
+  qsx::TrajectoryOptions traj_opts; qsx::TrajectoryResult traj;
   int shots = 1; std::string backend = "state"; std::string snap_in=""; std::string snap_out=""; bool do_opt=false; bool force=false; std::string observables="z"; std::string cfg=""; double p01=0.0, p10=0.0; bool map_line=false; std::string map_topology_file=""; int threads=1; bool mitigate=false; bool pretty=false;
-  std::string out = "";
+  std::string out = ""; std::string bind_spec = "";
   for (int i=2;i<argc;i++) {
     std::string a = argv[i];
     auto nxt = [&](const char* name)->std::string{ if(i+1>=argc){std::cerr<<"Missing "<<name<<"\n"; exit(2));} return argv[++i]; };
@@ -1363,6 +1451,17 @@ int main(int argc, char** argv) {
     else if (a == "--out") out = nxt("--out"));
     else if (a == "--backend") backend = nxt("--backend"));
     else if (a == "--optimize") do_opt = true;
+    else if (a == "--bind") bind_spec = nxt("--bind");
+    else if (a == "--fuse") run_opts.fuse_qubits = std::stoull(nxt("--fuse"));
+    else if (a == "--block-qubits") run_opts.block_qubits = std::stoull(nxt("--block-qubits"));
+    else if (a == "--no-cache-blocking") run_opts.cache_blocking = false;
+    else if (a == "--no-reorder") run_opts.reorder_qubits = false;
+    else if (a == "--no-channel-fusion") run_opts.fuse_channels = false;
+    else if (a == "--profile") show_profile = true;
+    else if (a == "--density-mode") { std::string m = nxt("--density-mode"); if (m == "matrix") density_mode = qsx::DensityMode::Matrix; else if (m == "packed") density_mode = qsx::DensityMode::Packed; else if (m == "vectorized") density_mode = qsx::DensityMode::Vectorized; else { std::cerr << "--density-mode must be matrix, packed or vectorized\n"; return 2; } }
+    else if (a == "--branch-cache") run_opts.branch_cache_bytes = std::stoull(nxt("--branch-cache")) << 20;
+    else if (a == "--trajectories") { traj_opts.max_trajectories = std::stoull(nxt("--trajectories")); if (traj_opts.max_trajectories == 0) { std::cerr << "--trajectories must be at least 1\n"; return 2; } }
+    else if (a == "--target-stderr") traj_opts.target_stderr = std::stod(nxt("--target-stderr"));
     else if (a == "--observables") observables = nxt("--observables"));
     else if (a == "--force") force = true;
     else if (a == "--config") cfg = nxt("--config"));
@@ -1399,7 +1498,11 @@ if (do_opt) {
 }
 // Memory estimate & guard unless --force
 auto estimate_bytes = [&](const std::string& be)->unsigned long long{
-  if (be=="density") { long double sz = powl(2.0L, circ.nqubits*2) * (long double)sizeof(qsx::c64)); return (unsigned long long)sz; }
+  if (be=="density") {
+    // Packed storage keeps the upper triangle only: d (d + 1) / 2 entries
+    long double d = powl(2.0L, circ.nqubits), cells = density_mode == qsx::DensityMode::Packed ? d * (d + 1.0L) / 2.0L : d * d;
+    return (unsigned long long)(cells * (long double)sizeof(qsx::c64));
+  }
   long double sz = powl(2.0L, circ.nqubits) * (long double)sizeof(qsx::c64)); return (unsigned long long)sz;
 };
 unsigned long long need = estimate_bytes(backend));
@@ -1407,6 +1510,12 @@ const unsigned long long HARD_WARN = 4ULL<<30; // 4 GiB
 if (!force && need > HARD_WARN) { std::cerr << "Estimated memory " << need << " bytes exceeds safe threshold. Use --force if intentional.\\n"; return 9; }
 
   auto circ = *circ_opt;
+  // Named parameters: values from --bind, the others run as 0
+  if (!bind_spec.empty()) {
+    std::map<std::string,double> vals;
+    if (!parse_bindings(bind_spec, circ, vals, err)) { std::cerr << err << "\n"; return 2; }
+    circ = qsx::bind_parameters(circ, vals);
+  }
 
   // Apply config file overrides
   if (!cfg.empty()){
@@ -1424,7 +1533,8 @@ if (!force && need > HARD_WARN) { std::cerr << "Estimated memory " << need << "
 
   if (qubits) { if (qubits < circ.nqubits) { std::cerr << "Provided --qubits < required by circuit\n"; return 4; } else circ.nqubits = qubits; }
   // Guard density-matrix memory if chosen
-  if (backend == "density" && circ.nqubits > 10) { std::cerr << "Density backend limited to <=10 qubits (memory).\n"; return 5; }
+  if (backend == "density" && circ.nqubits > 10 && density_mode != qsx::DensityMode::Packed) { std::cerr << "Density backend limited to <=10 qubits (memory); use --density-mode packed for 11.\n"; return 5; }
+  if (backend == "density" && circ.nqubits > 11) { std::cerr << "Density backend limited to <=11 qubits (memory).\n"; return 5; }
   // Validate ops vs backend
   if (backend == "state"){
     for (auto &op : circ.ops){ if (op.type == OpType::AMPDAMP){ std::cerr << "AMPDAMP requires density backend. Use --backend density.\n"; return 7; } }
@@ -1435,33 +1545,42 @@ if (!force && need > HARD_WARN) { std::cerr << "Estimated memory " << need << "
 // State-vector snapshot-out (pre-measurement)
 auto maybe_save_snapshot = [&](const Circuit& c)->bool{
   if (backend != "state" || snap_out.empty()) return true;
-  using namespace qsx::gates;
-  qsx::StateVector sv(c.nqubits));
-  qsx::c64 u00,u01,u10,u11;
-  for (const auto& op : c.ops){
-    switch(op.type){
-      case OpType::H: H_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::X: X_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::Y: Y_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::Z: Z_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::S: S_coeffs(u00,u01,u10,u11)); sv.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::RX: RX_coeffs(op.angle,u00,u01,u10,u11)); sv.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::RY: RY_coeffs(op.angle,u00,u01,u10,u11)); sv.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::RZ: RZ_coeffs(op.angle,u00,u01,u10,u11)); sv.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::CNOT: sv.apply_cx(op.qubits[0], op.qubits[1])); break;
-      case OpType::DEPHASE: case OpType::DEPOL: case OpType::AMPDAMP: case OpType::MEASURE: break;
-    }
-  }
-  return sv.save(snap_out));
+  qsx::StateVector sv(c.nqubits);
+  for (const auto& op : c.ops) qsx::apply_unitary(sv, op);
+  return sv.save(snap_out);
 };
 if (!maybe_save_snapshot(circ)) { std::cerr << "Failed to write snapshot.\n"; return 8; }
 
   std::vector<std::vector<int>> outcomes;
   std::vector<double> probs; std::vector<double> expZ; std::vector<double> expX; std::vector<double> expY;
   std::map<std::string,int> counts;  auto t0 = std::chrono::steady_clock::now());
+  // Shots computed up front: the trajectory backend draws every shot from the averaged
+  // distribution; noisy state-vector shots share their noiseless prefix and branches (run_shots,
+  // same outcomes as one run() per shot)
+  std::vector<std::uint64_t> batch_shots;
+  const bool batched = backend == "trajectories" || (backend == "state" && snap_in.empty() && !qsx::is_sampling_deterministic(circ));
+  if (backend == "trajectories") {
+    traj_opts.run = run_opts;
+    traj = qsx::run_trajectories(circ, seed, traj_opts);
+    probs = traj.probabilities; expZ = traj.expect_z;
+    qsx::Rng srng(seed);
+    batch_shots = qsx::sample_indices(probs, shots, srng);
+  } else if (batched && shots > 0) {
+    auto sr = qsx::run_shots(circ, shots, seed, true, run_opts);
+    exec_profile = sr.profile;
+    probs = sr.probabilities; expZ = qsx::expect_z_all(probs, circ.nqubits);
+    batch_shots = std::move(sr.outcomes);
+  }
   for (int s=0;s<shots;++s) {
+    if (batched) {
+      auto bits = qsx::basis_to_bits(batch_shots[s], circ.nqubits);
+      outcomes.push_back(bits);
+      counts[bits_to_string(bits)] += 1;
+      continue;
+    }
     if (backend == "density") {
-      auto r = run_density(circ, seed + s, false));
+      auto r = run_density(circ, seed + s, false, density_mode, run_opts);
+      if (s==0) density_passes = r.passes;
       if (s==0) { probs = r.probabilities; expZ.resize(circ.nqubits, 0.0)); for (std::size_t q=0;q<circ.nqubits;++q){ double z=0.0; for (std::size_t i=0;i<probs.size());++i){ int bit = (i>>q)&1; z += (bit? -probs[i] : probs[i])); } expZ[q]=z; } }
             // Apply readout error flips per qubit
       for (std::size_t qb=0; qb<r.outcome.size()); ++qb){ double rr = (double)std::rand() / (double)RAND_MAX; if (r.outcome[qb]==0){ if (rr < p01) r.outcome[qb]=1; } else if (kind=="teleport"){ out<<"# Quantum teleportation (3 qubits: 0=sender,1=receiver,2=msg)\n"; out<<"H 1\nCNOT 1 0\nCNOT 2 1\nH 2\nMEASURE ALL\n"; } else if (kind=="bv"){ out<<"# Bernstein-Vazirani; requires --n and --mask\n"; } else if (kind=="bv"){
@@ -1509,13 +1628,30 @@ if (!maybe_save_snapshot(circ)) { std::cerr << "Failed to write snapshot.\n"; re
       for(int q=0;q<n;q++){ if (mask[q]=='1') out<<"CNOT "<<q<<" "<<n<<"\n"; }
       out<<"H "<<n<<"\nMEASURE ALL\n";
     } else {
-        auto r = run(circ, seed + s, false));
+        auto r = run(circ, seed + s, false, run_opts);
+        if (s==0) exec_profile = r.profile;
         if (s==0) { probs = r.probabilities; expZ.resize(circ.nqubits, 0.0)); for (std::size_t q=0;q<circ.nqubits;++q){ double z=0.0; for (std::size_t i=0;i<probs.size());++i){ int bit = (i>>q)&1; z += (bit? -probs[i] : probs[i])); } expZ[q]=z; } }
         outcomes.push_back(r.outcome));
         counts[bits_to_string(r.outcome)] += 1;
       }
     }
   }
+  if (show_profile && backend=="state") {
+    std::cerr << "profile: steps=" << exec_profile.steps << " passes=" << exec_profile.passes
+              << " passes_saved=" << exec_profile.passes_saved << " blocked_windows=" << exec_profile.blocked_windows
+              << " block_qubits=" << exec_profile.block_qubits << " layout_swaps=" << exec_profile.layout_swaps << "\n";
+  }
+  if (show_profile && backend=="density") {
+    std::size_t ops = 0;
+    for (const auto& op : circ.ops) if (op.type != OpType::MEASURE) ++ops;
+    std::cerr << "profile: density ops=" << ops << " passes=" << density_passes << "\n";
+  }
+  if (show_profile && backend=="trajectories") {
+    double worst = 0.0;
+    for (double e : traj.stderr_z) worst = std::max(worst, e);
+    std::cerr << "profile: trajectories=" << traj.trajectories << " max_stderr_z=" << worst
+              << " converged=" << (traj.converged ? 1 : 0) << " passes=" << traj.profile.passes << "\n";
+  }
   if (!snap_out.empty() && backend=="state" && shots>0) {
     // Save state after last run by re-running once deterministically
     auto r = run(circ, seed, false));
@@ -1576,6 +1712,8 @@ if (!maybe_save_snapshot(circ)) { std::cerr << "Failed to write snapshot.\n"; re
       case OpType::RY: name="RY"; break; case OpType::RZ: name="RZ"; break; case OpType::CNOT: name="CNOT"; break;
       case OpType::MEASURE: name="MEASURE"; break; case OpType::DEPHASE: name="DEPHASE"; break;
       case OpType::DEPOL: name="DEPOL"; break; case OpType::AMPDAMP: name="AMPDAMP"; break;
+      case OpType::CCX: name="CCX"; break; case OpType::CZ: name="CZ"; break; case OpType::SWAP: name="SWAP"; break;
+      case OpType::U3: name="U3"; break; case OpType::U2Q: name="U2Q"; break;
     }
     gateHist[name]++;
   }
@@ -1611,23 +1749,7 @@ if (observables=="all" && backend=="state"){
   expX.resize(circ.nqubits, 0.0));
   expY.resize(circ.nqubits, 0.0));
   // Recompute one state vector at s=0
-  qsx::StateVector sv2(circ.nqubits));
-  using namespace qsx::gates; qsx::c64 u00,u01,u10,u11;
-  for (const auto& op : circ.ops){
-    switch(op.type){
-      case OpType::H: H_coeffs(u00,u01,u10,u11)); sv2.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::X: X_coeffs(u00,u01,u10,u11)); sv2.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::Y: Y_coeffs(u00,u01,u10,u11)); sv2.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::Z: Z_coeffs(u00,u01,u10,u11)); sv2.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::S: S_coeffs(u00,u01,u10,u11)); sv2.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::RX: RX_coeffs(op.angle,u00,u01,u10,u11)); sv2.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::RY: RY_coeffs(op.angle,u00,u01,u10,u11)); sv2.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::RZ: RZ_coeffs(op.angle,u00,u01,u10,u11)); sv2.apply_gate_1q(op.qubits[0],u00,u01,u10,u11)); break;
-      case OpType::CNOT: sv2.apply_cx(op.qubits[0], op.qubits[1])); break;
-      default: break;
-    }
-  }
-  const auto& a = sv2.amplitudes());
+  const auto a = build_state(circ);
   for (std::size_t q=0;q<circ.nqubits;++q){
     double x=0.0, y=0.0;
     std::size_t mask = std::size_t(1) << q;
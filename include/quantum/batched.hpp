@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "state_vector.hpp"
+
+namespace qsx {
+
+// B = 2^lane_bits states of n qubits stored amplitude by amplitude (structure of arrays over the
+// batch): amplitude i of state b is at index i * B + b. A gate applied to every state is the same
+// gate on qubit q + lane_bits of one (n + lane_bits)-qubit state, so it runs through the ordinary
+// kernels in a single sweep with whole SIMD registers of states; gates that differ per state use
+// kernels::apply_kq_lanes. Built for parameter scans on small states (compiled.hpp).
+class BatchedStateVector {
+  std::size_t n_, lane_bits_;
+  vec_c64 amp_;
+  std::size_t applied_ = 0;
+
+public:
+  // batch is rounded up to a power of two; every state starts as |0...0>
+  BatchedStateVector(std::size_t n, std::size_t batch);
+  std::size_t num_qubits() const { return n_; }
+  std::size_t lane_bits() const { return lane_bits_; }
+  std::size_t batch() const { return std::size_t(1) << lane_bits_; }
+  const vec_c64& amplitudes() const { return amp_; }
+  vec_c64& amplitudes_mut() { return amp_; }
+
+  // Every state set to sv (same number of qubits)
+  void assign(const StateVector& sv);
+  // State b copied into sv (same number of qubits)
+  void extract(std::size_t b, StateVector& sv) const;
+  // Rescale each state to unit norm
+  void normalize();
+  // Count gates applied through the kernels; like StateVector, every 256 gates renormalise
+  void count_gates(std::size_t gates);
+};
+
+} // namespace qsx
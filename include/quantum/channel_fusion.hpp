@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "circuit.hpp"
+#include "channels.hpp"
+#include <vector>
+#include <cstddef>
+
+namespace qsx {
+
+// Compilation of a noisy circuit for the density-matrix backend, where every gate and channel
+// costs a full pass over the 4^n entries of rho. Ops are grouped into steps of at most two
+// qubits, each applied in one pass:
+//  - consecutive gates and channels on the same one or two qubits compose into one step (a
+//    unitary until a channel is absorbed, a superoperator from then on);
+//  - Pauli channels (DEPHASE, DEPOL) are deferred and pushed through later gates whenever the
+//    gate maps them to a Pauli channel on a single qubit (Pauli gates, H and S by permuting
+//    X/Y/Z, dephasing through RZ, CZ and CNOT/CCX controls, bit flips through CNOT/CCX
+//    targets, depolarizing through any 1q gate, anything through SWAP), so noise collects
+//    into one channel instead of a pass per op;
+//  - gates on three qubits (CCX) are kept verbatim.
+struct DensityStep {
+  Op op;                             // original op when kept verbatim
+  std::vector<std::size_t> qubits{}; // fused step qubits, ascending; empty when `op` is used
+  std::vector<c64> unitary{};        // 2^k x 2^k (local bit j = qubits[j]) while the step is unitary
+  Channel channel{};                 // superoperator otherwise (unitary is then empty)
+  std::size_t sources = 1;           // circuit ops folded into this step
+  bool is_fused() const { return !qubits.empty(); }
+};
+
+struct DensityProgram {
+  std::size_t nqubits{};
+  std::vector<DensityStep> steps; // one pass over rho each
+  std::size_t source_ops = 0;     // gates and channels in the input (MEASURE excluded)
+  std::size_t commuted = 0;       // moves of a deferred Pauli channel through a gate
+  std::size_t dropped = 0;        // noise ops removed before the readout (diagonal_only)
+};
+
+// diagonal_only: only the diagonal of the final rho is read (run_density), so trailing noise
+// that leaves the populations unchanged (Z-type Pauli channels) is dropped.
+DensityProgram compile_density(const Circuit& c, bool diagonal_only=false);
+
+} // namespace qsx
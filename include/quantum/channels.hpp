@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "types.hpp"
+#include <vector>
+#include <cstddef>
+
+namespace qsx {
+
+// Completely positive trace-preserving map on k = 1 or 2 qubits, stored as its superoperator.
+// Matrices use the kernel convention: local bit j of an index is the j-th qubit the channel is
+// applied to. The superoperator acts on the 4^k block entries rho[r][c] (r, c local indices)
+// ordered as l = c + 2^k r:
+//   S[l][l'] = sum_k K[r][r'] conj(K[c][c'])
+// so it can be applied to a DensityMatrix in one in-place pass, or to the vectorised density as
+// a dense gate on the column qubits q and row qubits q + n.
+struct Channel {
+  std::size_t nqubits = 1;
+  std::vector<c64> superop;             // 4^k x 4^k, row-major
+  std::vector<std::vector<c64>> kraus;  // Kraus operators when known (empty for superop/PTM input)
+};
+
+// From Kraus operators (each 2^k x 2^k, row-major); the superoperator is built once here and
+// the operators are kept for the trajectory backend. Every factory below builds from Kraus.
+Channel channel_from_kraus(const std::vector<std::vector<c64>>& kraus, std::size_t k);
+// From a superoperator in the layout above.
+Channel channel_from_superop(std::vector<c64> superop, std::size_t k);
+// From a Pauli transfer matrix R[i][j] = Tr(P_i E(P_j)) / 2^k, Paulis indexed I, X, Y, Z with the
+// first qubit as the low base-4 digit (R is 4^k x 4^k, row-major, real).
+Channel channel_from_ptm(const std::vector<double>& ptm, std::size_t k);
+// Pauli transfer matrix of a channel (inverse of channel_from_ptm).
+std::vector<double> channel_ptm(const Channel& ch);
+
+// Standard single-qubit channels
+Channel amplitude_damping(double gamma);
+// Relaxation towards a thermal state: p is the ground-state population of the bath (p = 1 is
+// plain amplitude damping).
+Channel generalized_amplitude_damping(double gamma, double p);
+// T1/T2 relaxation for a duration t (same units), equilibrium excited population pe;
+// requires t2 <= 2 t1.
+Channel thermal_relaxation(double t1, double t2, double t, double pe=0.0);
+// X, Y, Z applied with probabilities px, py, pz
+Channel pauli_channel(double px, double py, double pz);
+Channel dephasing(double p);     // Z with probability p
+Channel depolarizing(double p);  // X, Y, Z each with probability p/3
+
+// Two-qubit depolarizing channel: each of the 15 non-identity Pauli pairs with probability p/15
+Channel depolarizing_2q(double p);
+
+} // namespace qsx
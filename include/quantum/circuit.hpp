@@ -7,15 +7,24 @@
 #include <string_view>
 #include <vector>
 #include <optional>
+#include <map>
+#include <cstdint>
 
 namespace qsx {
 
-enum class OpType { H, X, Y, Z, S, RX, RY, RZ, CNOT, MEASURE, DEPHASE, DEPOL, AMPDAMP };
+enum class OpType { H, X, Y, Z, S, RX, RY, RZ, CNOT, MEASURE, DEPHASE, DEPOL, AMPDAMP,
+                    CCX, CZ, SWAP, U3, U2Q };
 
 struct Op {
   OpType type;
-  std::vector<std::size_t> qubits;
+  std::vector<std::size_t> qubits; // CCX: control, control, target
   double angle = 0.0; // for rotations
+  std::vector<double> params{}; // U3: theta, phi, lambda; U2Q: 4x4 row-major (re, im) pairs, local bit 0 = qubits[0]
+  // RX/RY/RZ with a named parameter: the angle is angle + param_scale * value(param). Executed
+  // directly (run(), unitary, density, ...) an unbound parameter counts as 0; see bind_parameters
+  // and compiled.hpp.
+  std::string param{};
+  double param_scale = 1.0;
 };
 
 struct Circuit {
@@ -28,16 +37,91 @@ struct Circuit {
 //   H 0
 //   X 1
 //   RZ 0 1.57079632679
+//   RZ 0 theta        (named parameter; also -theta, 2*theta, 0.5*theta+0.1 for RX/RY/RZ)
 //   CNOT 0 1
+//   CCX 0 1 2         (Toffoli, controls first)
+//   CZ 0 1
+//   SWAP 0 1
+//   U3 0 theta phi lambda
+//   U2Q 0 1 <32 numbers: 4x4 row-major matrix as re im pairs, local bit 0 = first qubit>
+//   DEPHASE 0 p / DEPOL 0 p / AMPDAMP 0 gamma   (noise channels)
 //   MEASURE ALL
 std::optional<Circuit> parse_circuit_file(const std::string& path, std::string& err);
+// The same for .qsx text held in memory
+std::optional<Circuit> parse_circuit_string(const std::string& text, std::string& err);
+
+// Rotation angle token: a number, or [-][k*]name[+c|-c] with name = [A-Za-z_][A-Za-z0-9_]* (not
+// "pi"). Sets op.angle, op.param and op.param_scale; false on malformed input.
+bool parse_angle(std::string_view tok, Op& op);
+// Inverse of parse_angle for the op's angle ("0.3", "theta", "-2*theta+0.1"), with default
+// stream precision like the other circuit writers.
+std::string format_angle(const Op& op);
+
+// Parameter names in order of first use.
+std::vector<std::string> circuit_parameters(const Circuit& c);
+// Substitute values for the named parameters found in `values` (other parameters stay symbolic).
+Circuit bind_parameters(const Circuit& c, const std::map<std::string, double>& values);
+
+// Apply one gate op to a state, dispatching diagonal gates (Z, S, RZ) and permutations
+// (X, CNOT) to their specialised kernels. Returns false for noise and measurement ops.
+bool apply_unitary(StateVector& sv, const Op& op);
+
+// Execution options shared by run(), run_shots() and run_density(). None of them changes results
+// beyond rounding.
+struct RunOptions {
+  std::size_t fuse_qubits = 0;  // >= 2: fuse gates into dense blocks of up to this many qubits (max 5)
+  bool cache_blocking = true;   // run windows of low-qubit gates chunk by chunk (see schedule.hpp)
+  std::size_t block_qubits = 0; // chunk size for cache blocking; 0 = derived from the L2 size
+  bool reorder_qubits = true;   // with cache blocking: move busy high qubits to low bit positions
+  bool fuse_channels = true;    // density matrix mode: compose gates and channels into one- and two-qubit steps
+  std::size_t branch_cache_bytes = std::size_t(1) << 30; // run_shots with noise: memory for shared branch states
+};
+
+// Summary of how the gates were executed (filled by run() and run_shots()).
+struct ExecProfile {
+  std::size_t steps = 0;          // unitary steps after fusion and reordering
+  std::size_t passes = 0;         // full-state sweeps for those steps
+  std::size_t passes_saved = 0;   // sweeps avoided by cache blocking (steps - passes)
+  std::size_t blocked_windows = 0;
+  std::size_t block_qubits = 0;   // 0 when blocking is off
+  std::size_t layout_swaps = 0;   // bit-position swaps inserted by qubit reordering (incl. the final restore)
+};
 
 // Execute circuit
 struct RunResult {
   std::vector<int> outcome;
   std::vector<double> probabilities; // size 2^n
+  ExecProfile profile;
+};
+
+RunResult run(const Circuit& c, uint64_t seed, bool collapse=true, const RunOptions& opts={});
+
+// Apply every op of c to an existing state through the same plan as run() (fusion, cache
+// blocking, reordering); noise ops draw from rng. The state may have more qubits than c.
+ExecProfile execute(StateVector& sv, const Circuit& c, Rng& rng, const RunOptions& opts={});
+
+// Multi-shot execution. Circuits whose only non-unitary op is the terminal MEASURE ALL
+// are simulated once and all shots are drawn from the final distribution. Circuits with
+// stochastic noise give every shot its own trajectory (seed + s), with exactly the outcomes of
+// one run() per shot, but shots share work: the state before the first noise op is computed
+// once, and shots are advanced together as a tree, splitting only where their sampled errors
+// differ (shots that draw "no error" at a noise site keep sharing one state). Copies of branch
+// states are bounded by RunOptions::branch_cache_bytes; below three states' worth every shot is
+// simulated on its own.
+struct ShotsResult {
+  std::vector<double> probabilities;             // size 2^n (first simulation)
+  std::map<std::uint64_t, std::size_t> histogram; // basis index (LSB = qubit 0) -> count
+  std::vector<std::uint64_t> outcomes;           // per-shot basis index (only if requested)
+  ExecProfile profile;                           // per simulation (identical for every shot)
+  std::size_t trajectories = 0;                  // distinct final states simulated (1 without noise)
 };
 
-RunResult run(const Circuit& c, uint64_t seed, bool collapse=true);
+// True when repeated shots cannot differ before measurement (no DEPHASE/DEPOL/AMPDAMP).
+bool is_sampling_deterministic(const Circuit& c);
+ShotsResult run_shots(const Circuit& c, std::size_t shots, uint64_t seed, bool keep_outcomes=false,
+                      const RunOptions& opts={});
+
+// Basis index -> per-qubit bits (same layout as RunResult::outcome).
+std::vector<int> basis_to_bits(std::uint64_t idx, std::size_t n);
 
 } // namespace qsx
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "schedule.hpp"
+#include "batched.hpp"
+#include "hamiltonian.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace qsx {
+
+// Circuits with named parameters (Op::param, "RZ 0 theta") lowered once for optimisation loops:
+// the execution plan (fusion, cache blocking, qubit reordering) depends only on the structure, so
+// it is built a single time and binding a parameter vector rebuilds just the plan steps that hold
+// a named parameter: the op of a lone rotation, or the dense matrix of a fused block. Steps whose
+// parameters did not change since the previous binding are left alone, so sweeping one
+// parameter touches one step.
+
+// A plan step that depends on parameters
+struct ParamSlot {
+  std::size_t step = 0;            // index into plan.steps
+  std::vector<Op> ops;             // source gates of the step (physical qubits), angles unbound
+  std::vector<std::size_t> index;  // parameter index per op (SIZE_MAX: no parameter)
+};
+
+struct CompiledCircuit {
+  std::size_t nqubits{};
+  std::vector<std::string> parameters; // binding order: circuit_parameters() of the source
+  ExecPlan plan;
+  std::vector<ParamSlot> slots;
+  std::vector<double> values;          // last bound values (empty before the first binding)
+};
+
+// Unbound parameters count as 0 until the first bind_parameters call.
+CompiledCircuit compile_circuit(const Circuit& c, const RunOptions& opts={});
+
+// Bind values in `parameters` order; throws std::invalid_argument on a size mismatch. Returns the
+// number of plan steps rebuilt.
+std::size_t bind_parameters(CompiledCircuit& cc, const std::vector<double>& values);
+
+// Apply the bound circuit to sv as execute() would (noise ops draw from rng), so starting from
+// |0...0> with Rng(seed) gives the state of run(bind_parameters(c, values), seed) before measurement.
+// [begin, end) restricts it to a range of plan windows.
+ExecProfile execute(StateVector& sv, const CompiledCircuit& cc, Rng& rng, std::size_t begin=0, std::size_t end=SIZE_MAX);
+
+// First plan window that depends on parameter k (plan.windows.size() if none). The state and rng
+// after the windows before it do not change with k, so a copy of them (a prefix checkpoint) can
+// be taken once and every new value of k only replays the windows from here on.
+std::size_t parameter_window(const CompiledCircuit& cc, std::size_t k);
+
+// Windows [begin, end) on every state of a batch, state b bound to values[b] (states past
+// values.size() repeat the last binding; throws std::invalid_argument when values is empty or a
+// binding has the wrong size). Steps without parameters run once for the whole batch and the
+// parameter steps apply one matrix per state; noise ops draw once from rng for the whole batch,
+// which is what every state would draw on its own, so state b matches execute() after
+// bind_parameters(cc, values[b]) up to rounding. The binding held by cc is not used.
+void execute(BatchedStateVector& bsv, const CompiledCircuit& cc, const std::vector<std::vector<double>>& values,
+             Rng& rng, std::size_t begin=0, std::size_t end=SIZE_MAX);
+
+// Batch size for `count` bindings on n qubits: a power of two up to 8, or 1 when batching does
+// not pay (a single binding, or states above 13 qubits, where a batch no longer stays in cache).
+std::size_t batch_width(std::size_t nqubits, std::size_t count);
+
+// Evaluate many bindings: each starts from |0...0> with Rng(seed), and visit(b, state) is called
+// once per binding b. Bindings run batch_width() at a time in a BatchedStateVector; states up to
+// 14 qubits run several batches (or bindings) at once, one per thread, so `visit` may be called
+// concurrently for different b; larger states run one binding at a time on threaded kernels.
+// Results do not depend on the thread count.
+void evaluate_batch(const CompiledCircuit& cc, const std::vector<std::vector<double>>& bindings, uint64_t seed,
+                    const std::function<void(std::size_t, const StateVector&)>& visit);
+
+// <H> for every binding (see evaluate_batch).
+std::vector<double> expectation_batch(const CompiledCircuit& cc, const Hamiltonian& h,
+                                      const std::vector<std::vector<double>>& bindings, uint64_t seed=0);
+
+} // namespace qsx
@@ -3,33 +3,80 @@
 #pragma once
 #include "types.hpp"
 #include "random.hpp"
+#include "circuit.hpp"
+#include "channels.hpp"
+#include "channel_fusion.hpp"
 #include <vector>
 
 namespace qsx {
 
+// Full: row-major 2^n x 2^n. Packed: rho is Hermitian, so only the upper triangle is stored, by
+// rows (row r holds columns r..2^n-1), in 2^n (2^n + 1) / 2 entries; the kernels read and write
+// that layout directly and visit only blocks on or above the diagonal.
+enum class DensityStorage { Full, Packed };
+
 class DensityMatrix {
   std::size_t n_;
-  std::vector<c64> rho_; // row-major 2^n x 2^n
-  void renormalize_();
+  DensityStorage storage_;
+  std::vector<c64> rho_;
+  template <class F> void visit(F&& f); // f(view) for the storage layout (density_matrix.cpp)
+  void apply_dense_packed(const std::vector<std::size_t>& qubits, const c64* u);
 public:
-  explicit DensityMatrix(std::size_t n);
+  explicit DensityMatrix(std::size_t n, DensityStorage storage=DensityStorage::Full);
   std::size_t num_qubits() const { return n_; }
   std::size_t dim() const { return (std::size_t(1) << n_); }
+  DensityStorage storage() const { return storage_; }
+  // Raw storage in the layout above
   const std::vector<c64>& data() const { return rho_; }
+  // rho[r][c] for either layout, and the (real) diagonal
+  c64 at(std::size_t r, std::size_t c) const;
+  std::vector<double> diagonal() const;
+  // Number of stored entries for n qubits
+  static std::size_t storage_size(std::size_t n, DensityStorage storage);
 
+  // All gates and channels work in place on (row pair, column pair) blocks, without temporaries.
   void apply_unitary_1q(std::size_t target, const c64 u00, const c64 u01, const c64 u10, const c64 u11);
   void apply_cx(std::size_t control, std::size_t target);
+  // Specialisations for unitary diag(d0, d1) and Pauli X.
+  void apply_diag_1q(std::size_t target, const c64 d0, const c64 d1);
+  void apply_x(std::size_t target);
+  // Multi-qubit gates through the state-vector kernels (see density_matrix.cpp).
+  void apply_controlled_kq(const std::vector<std::size_t>& qubits, std::size_t control_mask, const c64* m);
+  void apply_mcx(std::size_t control_mask, std::size_t target);
+  void apply_mcphase(std::size_t mask, const c64 phase);
+  void apply_swap(std::size_t q0, std::size_t q1);
 
   // Noise channels via Kraus operators
   void dephase(std::size_t target, double p);
   void depolarize(std::size_t target, double p);
+  void amp_damp(std::size_t target, double gamma);
+  // Any 1q or 2q channel (see channels.hpp) on `qubits` (local bit j = qubits[j]), one in-place pass
+  void apply_channel(const Channel& ch, const std::vector<std::size_t>& qubits);
+
+  // One circuit op (MEASURE is a no-op) or one compiled step (see channel_fusion.hpp)
+  void apply_op(const Op& op);
+  void apply_step(const DensityStep& step);
+
+  // Gates and channels update rho in place without rescaling; call this to reset the trace to 1.
+  void renormalize();
 };
 
 struct DMRunResult {
   std::vector<int> outcome;
   std::vector<double> probabilities;
+  std::size_t passes = 0; // sweeps over rho: compiled steps (matrix), state passes (vectorized)
 };
 
-DMRunResult run_density(const Circuit& c, uint64_t seed, bool collapse);
+// Matrix: DensityMatrix and its dedicated kernels, on the steps of compile_density() unless
+// opts.fuse_channels is off. Packed: the same with Hermitian-packed storage (about half the
+// memory).
+// Vectorized: rho is stored as a 2n-qubit amplitude vector (index r * 2^n + c, row bits high) and
+// run through the state-vector engine: U rho U^dagger becomes U on qubits q + n and conj(U) on
+// qubits q, and each single-qubit channel becomes its 4x4 superoperator on (q, q + n). Fusion,
+// cache blocking, SIMD and threading (RunOptions) all apply.
+enum class DensityMode { Matrix, Vectorized, Packed };
+
+DMRunResult run_density(const Circuit& c, uint64_t seed, bool collapse,
+                        DensityMode mode=DensityMode::Matrix, const RunOptions& opts={});
 
 } // namespace qsx
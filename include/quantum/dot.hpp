@@ -21,6 +21,8 @@ inline bool export_dot(const Circuit& c, const std::string& path){
       case OpType::S: name="S"; break; case OpType::RX: name="RX"; break; case OpType::RY: name="RY"; break; case OpType::RZ: name="RZ"; break;
       case OpType::CNOT: name="CNOT"; break; case OpType::MEASURE: name="MEASURE"; break; case OpType::DEPHASE: name="DEPHASE"; break;
       case OpType::DEPOL: name="DEPOL"; break; case OpType::AMPDAMP: name="AMPDAMP"; break;
+      case OpType::CCX: name="CCX"; break; case OpType::CZ: name="CZ"; break; case OpType::SWAP: name="SWAP"; break;
+      case OpType::U3: name="U3"; break; case OpType::U2Q: name="U2Q"; break;
     }
     out << "  n" << idx << " [shape=box,label="" << name << ""];\n";
     for (auto q : op.qubits){
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "circuit.hpp"
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+namespace qsx {
+
+// Probabilistic equivalence check of two unitary circuits up to a global phase, at O(2^n) memory
+// instead of the O(4^n) of build_unitary. Both circuits run on the same random input states
+// |psi_t> through the run() plan, and every overlap <A psi_t|B psi_t> must equal one common phase
+// (taken from the first input) within `tolerance`.
+//
+// Inputs alternate between random product states (a Haar-random qubit each) and random
+// stabilizer states (H/S layers around random CNOTs). If A != e^{i phi} B, a random product state
+// exposes the difference with probability 1 in exact arithmetic; stabilizer inputs add the exact
+// Clifford-reachable states that rewrites of Clifford circuits are most likely to get wrong.
+// With a tolerance, a difference is assumed to show on a random input with probability >= 1/2,
+// so `trials` defaults to ceil(log2(1 / (1 - confidence))) inputs.
+struct EquivOptions {
+  double confidence = 0.999999;          // ignored when trials > 0
+  std::size_t trials = 0;                // number of input states (0: from confidence)
+  double tolerance = 0.0;                // on |<A psi|B psi> - phase| (0: 1e-6, 1e-3 with QSX_FP32)
+  // Qubit q of `a` corresponds to qubit output_layout[q] of `b` at the end (the layout returned
+  // by map_to_line / map_to_topology); empty means the identity.
+  std::vector<std::size_t> output_layout;
+  RunOptions run;                        // execution plan of both circuits
+};
+
+struct EquivResult {
+  bool equivalent = true;
+  std::size_t trials = 0;                // inputs checked (stops at the first mismatch)
+  std::size_t first_mismatch = 0;        // input index of the mismatch (when !equivalent)
+  double max_deviation = 0.0;            // largest |<A psi|B psi> - phase| seen
+  std::complex<double> phase{1.0, 0.0};  // global phase of B relative to A
+};
+
+// Input t is drawn from Pcg32(seed, t), so results do not depend on the thread count. Small
+// states check several inputs at once in parallel; larger ones use threaded kernels per state.
+// MEASURE ops are ignored; noise ops throw std::runtime_error, and a qubit count or layout
+// mismatch throws std::invalid_argument.
+EquivResult check_equivalence(const Circuit& a, const Circuit& b, uint64_t seed, const EquivOptions& opts={});
+
+} // namespace qsx
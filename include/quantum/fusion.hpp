@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "circuit.hpp"
+#include <vector>
+#include <cstddef>
+
+namespace qsx {
+
+// Execution-time gate fusion: gates are grouped into blocks acting on at most k qubits and
+// each block is applied as one dense 2^k x 2^k matrix (one sweep of the state instead of one
+// per gate). Gates may be pulled forward past gates on disjoint qubits; noise and measurement
+// ops are barriers and are kept verbatim.
+struct FusedOp {
+  Op op;                           // original op when not fused (noise, measurement, lone gates)
+  std::vector<std::size_t> qubits; // block qubits, ascending; empty when `op` is used
+  std::vector<c64> matrix;         // row-major 2^k x 2^k, local bit j = qubits[j]
+  std::size_t gates = 1;           // number of source gates in this step
+  bool layout_swap = false;        // bit-position exchange of qubits[0], qubits[1] (see schedule.hpp)
+  std::vector<Op> members;         // source gates of a block holding named parameters, so the matrix can be rebuilt (compiled.hpp)
+  bool is_block() const { return !qubits.empty() && !layout_swap; }
+};
+
+struct FusedCircuit {
+  std::size_t nqubits{};
+  std::size_t max_qubits{};     // block size limit actually used
+  std::vector<FusedOp> ops;
+  std::size_t source_gates = 0; // unitary gates in the input circuit
+  std::size_t fused_gates = 0;  // unitary steps after fusion (blocks + lone gates)
+};
+
+// max_qubits is clamped to [2, kernels::kMaxDenseQubits].
+FusedCircuit fuse_gates(const Circuit& c, std::size_t max_qubits);
+
+// Dense 2^k x 2^k matrix of a gate sequence on ascending `qubits` (ops use global indices).
+std::vector<c64> block_matrix(const std::vector<Op>& ops, const std::vector<std::size_t>& qubits);
+
+} // namespace qsx
@@ -10,7 +10,7 @@ namespace qsx::gates {
   }
   inline void H_coeffs(qsx::c64& u00, qsx::c64& u01, qsx::c64& u10, qsx::c64& u11) {
     double s = 1.0/std::sqrt(2.0);
-    u00 = {s,0}; u01 = {s,0}; u10 = {s,0}; u11 = {-s,0};
+    u00 = qsx::c64(s,0); u01 = qsx::c64(s,0); u10 = qsx::c64(s,0); u11 = qsx::c64(-s,0);
   }
   inline void Z_coeffs(qsx::c64& u00, qsx::c64& u01, qsx::c64& u10, qsx::c64& u11) {
     u00 = {1,0}; u01 = {0,0}; u10 = {0,0}; u11 = {-1,0};
@@ -18,8 +18,8 @@ namespace qsx::gates {
   inline void RZ_coeffs(double theta, qsx::c64& u00, qsx::c64& u01, qsx::c64& u10, qsx::c64& u11) {
     // diag(e^{-iθ/2}, e^{iθ/2})
     double half = theta/2.0;
-    u00 = { std::cos(-half), std::sin(-half) };
-    u11 = { std::cos( half), std::sin( half) };
+    u00 = qsx::c64( std::cos(-half), std::sin(-half) );
+    u11 = qsx::c64( std::cos( half), std::sin( half) );
     u01 = {0,0}; u10 = {0,0};
   }
 }
@@ -34,12 +34,22 @@ inline void Y_coeffs(qsx::c64& u00, qsx::c64& u01, qsx::c64& u10, qsx::c64& u11)
 inline void RX_coeffs(double theta, qsx::c64& u00, qsx::c64& u01, qsx::c64& u10, qsx::c64& u11){
   double c = std::cos(theta/2.0);
   double s = std::sin(theta/2.0);
-  u00 = {c,0}; u01 = {0,-s}; u10 = {0,-s}; u11 = {c,0};
+  u00 = qsx::c64(c,0); u01 = qsx::c64(0,-s); u10 = qsx::c64(0,-s); u11 = qsx::c64(c,0);
 }
 inline void RY_coeffs(double theta, qsx::c64& u00, qsx::c64& u01, qsx::c64& u10, qsx::c64& u11){
   double c = std::cos(theta/2.0);
   double s = std::sin(theta/2.0);
-  u00 = {c,0}; u01 = {s,0}; u10 = {-s,0}; u11 = {c,0};
+  u00 = qsx::c64(c,0); u01 = qsx::c64(s,0); u10 = qsx::c64(-s,0); u11 = qsx::c64(c,0);
+}
+// U3(θ, φ, λ) = [[cos(θ/2), -e^{iλ} sin(θ/2)], [e^{iφ} sin(θ/2), e^{i(φ+λ)} cos(θ/2)]]
+inline void U3_coeffs(double theta, double phi, double lambda, qsx::c64& u00, qsx::c64& u01, qsx::c64& u10, qsx::c64& u11){
+  double c = std::cos(theta/2.0);
+  double s = std::sin(theta/2.0);
+  // Parenthesised: c64 may be complex<float> (QSX_FP32), where braces would narrow
+  u00 = qsx::c64(c, 0);
+  u01 = qsx::c64(-s*std::cos(lambda), -s*std::sin(lambda));
+  u10 = qsx::c64(s*std::cos(phi), s*std::sin(phi));
+  u11 = qsx::c64(c*std::cos(phi+lambda), c*std::sin(phi+lambda));
 }
 inline void S_coeffs(qsx::c64& u00, qsx::c64& u01, qsx::c64& u10, qsx::c64& u11){
   u00 = {1,0}; u01 = {0,0}; u10 = {0,0}; u11 = {0,1}; // diag(1, i)
@@ -2,6 +2,7 @@
 
 #pragma once
 #include "circuit.hpp"
+#include "hamiltonian.hpp"
 #include <vector>
 #include <optional>
 
@@ -9,12 +10,37 @@ namespace qsx {
 
 struct GradResult {
   // grads[param_index][qubit] = d <Z_q> / d theta_param
+  // (Hamiltonian variants: grads[param_index] = { d <H> / d theta_param })
   std::vector<std::vector<double>> grads;
   std::vector<std::size_t> param_op_indices;
+  double expectation = 0.0; // <H> at the given angles (Hamiltonian variants)
 };
 
 // Compute gradients via parameter-shift (state backend), considering RX/RY/RZ only.
-// If wrt_indices is empty, all parameterized ops are used.
+// If wrt_indices is empty, all parameterized ops are used. Each shifted run equals
+// run(shifted circuit, seed), noise included, but resumes from a checkpoint of the state (and rng)
+// just before the shifted gate; the checkpoint advances through the circuit once, so the cost is
+// about the gates after each parameter rather than two full simulations per parameter.
 std::optional<GradResult> grad_expZ_parameter_shift(const Circuit& c, const std::vector<std::size_t>& wrt_indices, uint64_t seed);
 
+// Same gradients by adjoint differentiation: one forward run (through the run() plan), then per
+// qubit q one backward sweep that un-applies the gates from the final state |phi> together with
+// |lambda> = Z_q |phi>, reading d<Z_q>/d theta_k = Im <lambda|P_k|phi> at each rotation (P_k its
+// generator). About n (2G + 3P) gate-sized passes for G gates and P parameters instead of 2P
+// full simulations, with four state vectors. `qubits` restricts the sweeps to those <Z_q> (the
+// other columns of grads stay 0; empty = all), so one observable costs about three simulations.
+// MEASURE ops are ignored; returns nullopt for circuits with noise ops, wrt indices that are not
+// RX/RY/RZ ops or out-of-range qubits.
+std::optional<GradResult> grad_expZ_adjoint(const Circuit& c, const std::vector<std::size_t>& wrt_indices,
+                                            const RunOptions& opts={}, const std::vector<std::size_t>& qubits={});
+
+// Gradients of <H> for a Pauli-sum H (hamiltonian.hpp). Parameter-shift: two runs per parameter,
+// each read out with expectation(). Adjoint: one forward run, |lambda> = H|phi> in one pass over
+// the state, and a single backward sweep, so the cost does not grow with the number of terms
+// beyond that pass. Both return nullopt when H and c differ in qubit count; the adjoint variant
+// under the same conditions as grad_expZ_adjoint.
+std::optional<GradResult> grad_expectation_parameter_shift(const Circuit& c, const Hamiltonian& h, const std::vector<std::size_t>& wrt_indices, uint64_t seed);
+std::optional<GradResult> grad_expectation_adjoint(const Circuit& c, const Hamiltonian& h, const std::vector<std::size_t>& wrt_indices,
+                                                   const RunOptions& opts={});
+
 } // namespace qsx
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "types.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qsx {
+
+// Pauli string as bit masks: qubit q carries X if only bit q of x_mask is set, Z if only bit q of
+// z_mask is set and Y if both are. P|x> = i^{#Y} (-1)^{popcount(x & z_mask)} |x ^ x_mask>.
+struct PauliTerm {
+  double coeff = 1.0;
+  std::uint64_t x_mask = 0;
+  std::uint64_t z_mask = 0;
+};
+
+// H = sum of coeff * P over the terms (Hermitian: real coefficients).
+struct Hamiltonian {
+  std::size_t nqubits{};
+  std::vector<PauliTerm> terms;
+};
+
+// "X0Z1Y3" (letter + qubit index, repeated; lowercase accepted; "I" alone is the identity) on
+// n qubits, coefficient 1. Repeated or out-of-range qubits are errors.
+std::optional<PauliTerm> parse_pauli_string(std::string_view s, std::size_t n, std::string& err);
+
+// Hamiltonian file, one term per line:
+//   # comment
+//   0.5 Z0Z1
+//   -1.2 X0 Y3       (spaces inside the string are ignored)
+//   0.25 I           (constant)
+// Terms with the same Pauli string are merged.
+std::optional<Hamiltonian> parse_hamiltonian_file(const std::string& path, std::size_t n, std::string& err);
+
+// <a|H|a> for a 2^n state. Terms are grouped by x_mask, and each group is evaluated in one pass
+// over the amplitude pairs (a[x ^ x_mask], a[x]), in fixed chunks combined in order (bitwise
+// identical for any thread count). Small groups take a sign parity per term; groups of more than
+// 16 terms get their weights for a whole chunk from one Walsh-Hadamard transform, so the cost
+// per distinct x_mask stays ~log2(chunk) operations per amplitude however many terms share it.
+double expectation(const vec_c64& a, const Hamiltonian& h);
+
+// out = H a (out is resized; it must not alias a). Same grouping: one pass over out.
+void apply_hamiltonian(const vec_c64& a, const Hamiltonian& h, vec_c64& out);
+
+} // namespace qsx
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "types.hpp"
+#include <cstddef>
+
+namespace qsx::kernels {
+
+// Instruction sets with explicit gate kernels. The active one is picked at runtime from CPUID
+// (override with QSX_SIMD=scalar|avx2|avx512 or set_isa); Scalar is the portable fallback.
+enum class Isa { Scalar, AVX2, AVX512 };
+
+Isa detect_isa();            // best ISA supported by this CPU and build
+Isa active_isa();            // ISA used by StateVector
+void set_isa(Isa isa);       // clamped to detect_isa()
+const char* isa_name(Isa isa);
+
+// k-th index (in increasing order) whose bit `bit` is zero: insert a 0 at that position.
+inline std::size_t insert_zero_bit(std::size_t k, std::size_t bit) {
+  const std::size_t low = k & ((std::size_t(1) << bit) - 1);
+  return ((k >> bit) << (bit + 1)) | low;
+}
+
+// In-place kernels over a state of 2^n amplitudes. u is the row-major 2x2 matrix {u00,u01,u10,u11}.
+void apply_1q(Isa isa, c64* a, std::size_t n, std::size_t target, const c64 u[4]);
+void apply_controlled_1q(Isa isa, c64* a, std::size_t n, std::size_t control, std::size_t target, const c64 u[4]);
+// diag(d0, d1) on target
+void apply_diag_1q(Isa isa, c64* a, std::size_t n, std::size_t target, c64 d0, c64 d1);
+// Dense gate on k <= kMaxDenseQubits qubits (ascending) with row-major 2^k x 2^k matrix m;
+// local bit j of the matrix index is qubit qubits[j]. One sweep over the state.
+constexpr std::size_t kMaxDenseQubits = 5;
+void apply_kq(Isa isa, c64* a, std::size_t n, const std::size_t* qubits, std::size_t k, const c64* m);
+// Same with any number of controls: only groups whose bits in control_mask are all 1 are
+// transformed (control_mask must not contain target bits). Visits N / 2^(k + controls) groups.
+void apply_controlled_kq(Isa isa, c64* a, std::size_t n, const std::size_t* qubits, std::size_t k,
+                         std::size_t control_mask, const c64* m);
+
+// Batched states (batched.hpp): B = 2^lane_bits states of n qubits interleaved amplitude by
+// amplitude, amplitude i of state b at a[i * B + b]. A gate shared by all states is the same gate
+// on qubits + lane_bits of one (n + lane_bits)-qubit state; this applies a different dense matrix
+// to each state instead (m + b * 4^k for state b), vectorised across the batch.
+void apply_kq_lanes(Isa isa, c64* a, std::size_t n, std::size_t lane_bits, const std::size_t* qubits, std::size_t k,
+                    const c64* m);
+
+// Permutations are pure swaps (memory bound, no ISA variants): X on target, CNOT on control = 1 pairs
+void apply_x(c64* a, std::size_t n, std::size_t target);
+void apply_cx(c64* a, std::size_t n, std::size_t control, std::size_t target);
+// Exchange of bit positions q0 and q1 (SWAP gate / relabelling of the amplitude index)
+void apply_swap(c64* a, std::size_t n, std::size_t q0, std::size_t q1);
+// Multi-controlled X (Toffoli for two controls) on target
+void apply_mcx(c64* a, std::size_t n, std::size_t control_mask, std::size_t target);
+// Multiply every amplitude whose bits in mask are all 1 by phase (CZ: mask of both qubits, -1)
+void apply_mcphase(c64* a, std::size_t n, std::size_t mask, c64 phase);
+
+inline void apply_1q(c64* a, std::size_t n, std::size_t target, const c64 u[4]) {
+  apply_1q(active_isa(), a, n, target, u);
+}
+inline void apply_controlled_1q(c64* a, std::size_t n, std::size_t control, std::size_t target, const c64 u[4]) {
+  apply_controlled_1q(active_isa(), a, n, control, target, u);
+}
+inline void apply_diag_1q(c64* a, std::size_t n, std::size_t target, c64 d0, c64 d1) {
+  apply_diag_1q(active_isa(), a, n, target, d0, d1);
+}
+inline void apply_kq(c64* a, std::size_t n, const std::size_t* qubits, std::size_t k, const c64* m) {
+  apply_kq(active_isa(), a, n, qubits, k, m);
+}
+inline void apply_controlled_kq(c64* a, std::size_t n, const std::size_t* qubits, std::size_t k,
+                                std::size_t control_mask, const c64* m) {
+  apply_controlled_kq(active_isa(), a, n, qubits, k, control_mask, m);
+}
+inline void apply_kq_lanes(c64* a, std::size_t n, std::size_t lane_bits, const std::size_t* qubits, std::size_t k,
+                           const c64* m) {
+  apply_kq_lanes(active_isa(), a, n, lane_bits, qubits, k, m);
+}
+
+} // namespace qsx::kernels
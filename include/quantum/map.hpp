@@ -8,8 +8,9 @@
 namespace qsx {
 
 // Naive linear topology mapper: ensures all CNOTs act on adjacent qubits (|i-j|=1)
-// by inserting SWAPs and maintaining a logical->physical map. Returns mapped circuit.
-inline Circuit map_to_line(const Circuit& in){
+// by inserting SWAPs and maintaining a logical->physical map. Returns mapped circuit; the SWAPs
+// are not undone, so logical qubit q ends on physical qubit (*layout)[q] when layout is given.
+inline Circuit map_to_line(const Circuit& in, std::vector<std::size_t>* layout = nullptr){
   Circuit out; out.nqubits = in.nqubits;
   std::vector<std::size_t> phys(in.nqubits); // logical -> physical
   for (std::size_t i=0;i<in.nqubits;++i) phys[i]=i;
@@ -43,13 +44,18 @@ inline Circuit map_to_line(const Circuit& in){
       // Now adjacent
       out.ops.push_back({OpType::CNOT,{pc,pt},0.0});
     } else if (op.qubits.size()==1){
-      out.ops.push_back({op.type, { phys[op.qubits[0]] }, op.angle});
+      Op m = op; m.qubits[0] = phys[op.qubits[0]];
+      out.ops.push_back(std::move(m));
     } else if (op.type==OpType::MEASURE || op.type==OpType::DEPHASE || op.type==OpType::DEPOL || op.type==OpType::AMPDAMP){
       out.ops.push_back(op); // noise/measure unaffected (acts on logical indices equivalently here)
     } else {
-      out.ops.push_back(op);
+      // Other multi-qubit gates (CCX, CZ, SWAP, U2Q) follow the layout but are not routed
+      Op m = op;
+      for (auto& q : m.qubits) q = phys[q];
+      out.ops.push_back(std::move(m));
     }
   }
+  if (layout) *layout = phys;
   return out;
 }
 
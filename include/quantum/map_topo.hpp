@@ -44,8 +44,10 @@ inline std::vector<std::size_t> shortest_path(const std::vector<std::vector<std:
   return path;
 }
 
-// Map circuit to arbitrary topology by inserting SWAPs along shortest paths for CNOT
-inline Circuit map_to_topology(const Circuit& in, const std::vector<std::vector<std::size_t>>& adj){
+// Map circuit to arbitrary topology by inserting SWAPs along shortest paths for CNOT. As for
+// map_to_line, layout (if given) receives the final logical -> physical map.
+inline Circuit map_to_topology(const Circuit& in, const std::vector<std::vector<std::size_t>>& adj,
+                               std::vector<std::size_t>* layout = nullptr){
   Circuit out; out.nqubits = in.nqubits;
   std::vector<std::size_t> phys(in.nqubits); for (std::size_t i=0;i<in.nqubits;++i) phys[i]=i;
   auto emit_swap = [&](std::size_t a, std::size_t b){
@@ -75,11 +77,16 @@ inline Circuit map_to_topology(const Circuit& in, const std::vector<std::vector<
       pc = phys[lc]; pt = phys[lt];
       out.ops.push_back({OpType::CNOT,{pc,pt},0.0});
     } else if (op.qubits.size()==1){
-      out.ops.push_back({op.type, { phys[op.qubits[0]] }, op.angle});
+      Op m = op; m.qubits[0] = phys[op.qubits[0]];
+      out.ops.push_back(std::move(m));
     } else {
-      out.ops.push_back(op);
+      // Other multi-qubit gates (CCX, CZ, SWAP, U2Q) follow the layout but are not routed
+      Op m = op;
+      for (auto& q : m.qubits) q = phys[q];
+      out.ops.push_back(std::move(m));
     }
   }
+  if (layout) *layout = phys;
   return out;
 }
 
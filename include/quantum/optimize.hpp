@@ -9,7 +9,7 @@ namespace qsx {
 struct OptimizeOptions {
   bool fuse_single_qubit = true;
   bool cancel_involutory = true; // X^2=I, H^2=I, Z^2=I, S^4=I (also S^2=Z)
-  bool merge_rotations = true;   // RX/RY/RZ on same target sum angles
+  bool merge_rotations = true;   // RX/RY/RZ on same target sum angles (named parameters: with literals or the same name)
   bool cancel_cnot_pairs = true; // consecutive identical CNOT pairs
 };
 
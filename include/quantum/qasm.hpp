@@ -7,5 +7,9 @@
 
 namespace qsx {
 // Minimal OpenQASM 2.0 subset: qreg, h, x, y, z, s, rx, ry, rz, cx, measure (ignored except MEASURE ALL)
+// plus the non-standard noise statements dephase(p), depol(p) and ampdamp(gamma). rx/ry/rz accept
+// named parameters as in the .qsx format: rz(theta) q[0]; rx(-2*beta) q[1];
 std::optional<Circuit> parse_qasm_file(const std::string& path, std::string& err);
+// The same for QASM source held in memory
+std::optional<Circuit> parse_qasm_string(const std::string& text, std::string& err);
 }
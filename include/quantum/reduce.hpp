@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "types.hpp"
+#include <vector>
+#include <cstddef>
+
+namespace qsx {
+
+// Parallel reductions over amplitude and probability vectors. The input is split into chunks of
+// kReduceChunk entries (independent of the thread count) whose partial sums are combined in chunk
+// order, so every result is bitwise identical for any number of OpenMP threads.
+constexpr std::size_t kReduceChunkBits = 14;
+constexpr std::size_t kReduceChunk = std::size_t(1) << kReduceChunkBits;
+
+// sum |a[i]|^2
+double norm_squared(const c64* a, std::size_t N);
+// a[i] *= s
+void scale_amplitudes(c64* a, std::size_t N, double s);
+// <a|b> = sum conj(a[i]) b[i], accumulated in double
+std::complex<double> inner_product(const c64* a, const c64* b, std::size_t N);
+
+// p[i] = |a[i]|^2 for the whole state (one streaming pass)
+std::vector<double> probabilities(const vec_c64& a);
+
+// Every single-qubit marginal in one pass over a 2^n vector: p1[q] = sum of p[i] over indices with
+// bit q set (LSB = qubit 0). Returns the total sum. p1 must hold n entries.
+double marginals_one(const double* p, std::size_t n, double* p1);
+// Same, reading |a[i]|^2 straight from the amplitudes (no probability vector is materialised).
+double marginals_one(const c64* a, std::size_t n, double* p1);
+
+// <Z_q> for every qubit: total - 2 * p1[q]
+std::vector<double> expect_z_all(const std::vector<double>& p, std::size_t n);
+std::vector<double> expect_z_all(const vec_c64& a, std::size_t n);
+
+// Reduced density matrix of k = 1 or 2 qubits of a 2^n state (local bit j = qubits[j]):
+// rho[r * 2^k + c] = sum of a[i_r] conj(a[i_c]) over the other qubits. rho must hold 4^k entries.
+void reduced_density(const c64* a, std::size_t n, const std::size_t* qubits, std::size_t k, c64* rho);
+
+} // namespace qsx
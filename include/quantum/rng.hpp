@@ -4,7 +4,8 @@
 #include <cstdint>
 
 namespace qsx {
-// Minimal PCG32 RNG (portable, reproducible across compilers/OS)
+// Minimal PCG32 RNG (portable, reproducible across compilers/OS). Generators with the same seed
+// and different `seq` values are independent streams (one per trajectory, worker, ...).
 struct Pcg32 {
   uint64_t state;
   uint64_t inc;
@@ -21,7 +22,10 @@ struct Pcg32 {
     return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
   }
   uint32_t operator()(){ return next(); }
-  double uniform01(){ return (next() >> 8) * (1.0/9007199254740992.0); } // 53-bit fraction
+  double uniform01(){ // 53-bit fraction from two draws
+    const uint64_t hi = next(), lo = next();
+    return double(((hi << 32) | lo) >> 11) * (1.0/9007199254740992.0);
+  }
   uint32_t randint(uint32_t n){ return n? (next() % n) : 0; }
 };
 } // namespace qsx
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "random.hpp"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace qsx {
+
+// Samplers over a final probability vector (size 2^n, need not be exactly normalized).
+// All of them map the same uniform stream to basis indices (LSB = qubit 0).
+
+// Walker/Vose alias table: O(N) build, O(1) per draw.
+class AliasSampler {
+  std::vector<double> prob_;
+  std::vector<std::uint64_t> alias_;
+public:
+  explicit AliasSampler(const std::vector<double>& p);
+  std::size_t size() const { return prob_.size(); }
+  std::uint64_t sample(Rng& rng) const;
+};
+
+// Inclusive prefix sums of p. Chunked so that the result is identical for any thread count.
+std::vector<double> build_cdf(const std::vector<double>& p);
+
+// Draw `shots` indices by binary search on the CDF: O(N + K log N).
+std::vector<std::uint64_t> sample_cdf(const std::vector<double>& p, std::size_t shots, Rng& rng);
+
+// Sort K uniforms and sweep the distribution once: O(N + K log K), streaming access.
+// Produces exactly the same outcomes as sample_cdf for the same uniforms, in shot order.
+std::vector<std::uint64_t> sample_sorted(const std::vector<double>& p, std::size_t shots, Rng& rng);
+
+// Draw `shots` indices with an alias table.
+std::vector<std::uint64_t> sample_alias(const std::vector<double>& p, std::size_t shots, Rng& rng);
+
+enum class SamplerKind { Auto, Cdf, Sorted, Alias };
+
+// Pick a sampler from the number of outcomes N = 2^n and the number of shots K.
+SamplerKind choose_sampler(std::size_t n_outcomes, std::size_t shots);
+
+std::vector<std::uint64_t> sample_indices(const std::vector<double>& p, std::size_t shots, Rng& rng,
+                                          SamplerKind kind = SamplerKind::Auto);
+
+} // namespace qsx
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "circuit.hpp"
+#include "fusion.hpp"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace qsx {
+
+// Execution plan for the state-vector backend: optional gate fusion, then cache blocking.
+// A maximal run of unitary steps whose qubits all lie below `block_qubits` forms a window that
+// is executed chunk by chunk (2^block_qubits amplitudes, sized to stay in L2): every step of the
+// window is applied to one chunk before moving on, so the window costs one pass over the state.
+//
+// Qubit reordering (RunOptions::reorder_qubits): the plan tracks a logical -> physical bit
+// permutation (like phys[] in map.hpp, but for the amplitude layout). Before a high qubit gets
+// a run of gates it is swapped in place with a low bit position that is idle for longest, so
+// those gates join blocked windows; steps are rewritten to physical bits and the identity
+// layout is restored before the state is read.
+struct ExecWindow {
+  std::size_t begin = 0, end = 0; // step range [begin, end)
+  bool blocked = false;           // run chunk by chunk
+};
+
+struct ExecPlan {
+  std::vector<FusedOp> steps;
+  std::vector<ExecWindow> windows; // partition of steps, in order
+  ExecProfile profile;
+};
+
+// Chunk size in qubits derived from the L2 cache size (half of L2 per chunk).
+std::size_t cache_block_qubits();
+
+// Independent runs of one plan (trajectories, equivalence inputs, parameter bindings) on states
+// up to this size are spread across threads, one state each, instead of threading each kernel.
+constexpr std::size_t kParallelStatesQubits = 14;
+
+ExecPlan plan_execution(const Circuit& c, const RunOptions& opts);
+
+// Run windows [begin, end) of a plan on sv (the whole plan by default). Noise ops are never
+// fused or blocked; each one is a window of its own and is handed to `noise` in circuit order
+// (qubits already rewritten to physical bit positions).
+void apply_plan(StateVector& sv, const ExecPlan& plan, const std::function<void(const Op&)>& noise,
+                std::size_t begin=0, std::size_t end=SIZE_MAX);
+
+// Windows [begin, end) with noise ops applied as in run(): a sampled Pauli per DEPHASE/DEPOL drawn
+// from rng. A copy of (sv, rng) between windows is a checkpoint that later windows can resume from.
+void apply_plan(StateVector& sv, const ExecPlan& plan, Rng& rng, std::size_t begin=0, std::size_t end=SIZE_MAX);
+
+// One plan step on the raw amplitudes of an n-qubit state (a cache-block chunk, or a batch of
+// states with shifted qubits, see batched.hpp); noise ops apply the Pauli drawn from rng as above.
+void apply_step(c64* a, std::size_t n, const FusedOp& f, Rng& rng);
+
+// First window at or after `from` that holds a noise op (DEPHASE, DEPOL, AMPDAMP), or
+// windows.size(). Everything before it is deterministic and can be computed once and shared.
+std::size_t next_noise_window(const ExecPlan& plan, std::size_t from=0);
+
+} // namespace qsx
@@ -5,6 +5,7 @@
 #include "random.hpp"
 #include <span>
 #include <optional>
+#include <functional>
 
 namespace qsx {
 
@@ -26,6 +27,27 @@ public:
   // Single-qubit 2x2 gate on target qubit (0-indexed, LSB = qubit 0)
   void apply_gate_1q(std::size_t target, const c64 u00, const c64 u01, const c64 u10, const c64 u11);
 
+  // Diagonal gate diag(d0, d1): one multiply per touched amplitude, |0> half skipped when d0 == 1.
+  void apply_diag_1q(std::size_t target, const c64 d0, const c64 d1);
+  // Pauli X as a swap of amplitude pairs.
+  void apply_x(std::size_t target);
+  // Exchange qubits q0 and q1 (SWAP gate; also used to move qubits between bit positions).
+  void apply_swap(std::size_t q0, std::size_t q1);
+
+  // Dense k-qubit gate (k <= 5) on ascending qubits; m is row-major 2^k x 2^k with local
+  // bit j = qubits[j]. Used to apply fused gate blocks in one sweep.
+  void apply_gate_kq(const std::vector<std::size_t>& qubits, const c64* m);
+  // Same with controls (bit mask, disjoint from qubits): one sweep over the controlled subspace.
+  void apply_controlled_kq(const std::vector<std::size_t>& qubits, std::size_t control_mask, const c64* m);
+  // Multi-controlled X and phase: pure permutation / rescaling of the selected amplitudes.
+  void apply_mcx(std::size_t control_mask, std::size_t target);
+  void apply_mcphase(std::size_t mask, const c64 phase);
+
+  // Cache blocking: calls f(chunk, block_qubits) on every aligned run of 2^block_qubits
+  // amplitudes (in parallel under OpenMP); f must only touch qubits below block_qubits.
+  // `gates` is the number of gates f applies, for the periodic renormalisation.
+  void apply_blocked(std::size_t block_qubits, std::size_t gates, const std::function<void(c64*, std::size_t)>& f);
+
   // Controlled single-qubit gate with one control (control must be 1).
   void apply_cx(std::size_t control, std::size_t target); // CNOT
   void apply_controlled_1q(std::size_t control, std::size_t target, const c64 u00, const c64 u01, const c64 u10, const c64 u11);
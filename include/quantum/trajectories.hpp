@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "circuit.hpp"
+#include "channels.hpp"
+#include "rng.hpp"
+#include <vector>
+#include <cstddef>
+
+namespace qsx {
+
+// Monte Carlo wavefunction (quantum trajectory) backend: every trajectory is a 2^n state vector
+// run through the usual execution plan (fusion, cache blocking), with each noise op replaced by
+// one randomly chosen Kraus operator. Averages over trajectories converge to the density-matrix
+// result at O(2^n) memory per trajectory instead of O(4^n).
+
+// Samples one Kraus branch of a 1q or 2q channel per call. Mixed-unitary channels (every
+// K_i^dagger K_i a multiple of I, e.g. Pauli noise) have state-independent probabilities and
+// identity branches cost nothing; for the others (amplitude damping, thermal relaxation) the
+// branch probabilities p_i = <psi|K_i^dagger K_i|psi> come from one pass for the reduced density
+// of the channel qubits, and the chosen K_i / sqrt(p_i) is applied as a gate.
+class KrausSampler {
+  std::size_t k_ = 1;
+  std::vector<std::vector<c64>> ops_;          // applied matrices (K_i / sqrt(p_i) when mixed unitary)
+  std::vector<std::vector<std::complex<double>>> effects_; // K_i^dagger K_i, general case only
+  std::vector<double> fixed_;                  // branch probabilities, mixed-unitary case only
+  std::vector<bool> identity_;                 // branch is a multiple of I
+public:
+  explicit KrausSampler(const Channel& ch);    // throws std::invalid_argument without Kraus operators
+  bool mixed_unitary() const { return !fixed_.empty(); }
+  // Apply one branch on `qubits` (local bit j = qubits[j]) and renormalise; returns its index.
+  std::size_t apply(StateVector& sv, const std::vector<std::size_t>& qubits, Pcg32& rng) const;
+};
+
+struct TrajectoryOptions {
+  std::size_t max_trajectories = 1000;
+  std::size_t min_trajectories = 64;  // run at least this many before checking target_stderr
+  double target_stderr = 0.0;         // stop once every <Z_q> has a standard error <= this (0: off)
+  bool probabilities = true;          // also average the 2^n output distribution
+  RunOptions run;                     // execution plan of every trajectory
+};
+
+// Trajectory t draws from Pcg32(seed, t), and per-trajectory results are summed in trajectory
+// order, so results are identical for any number of OpenMP threads. Small states run whole
+// trajectories in parallel; larger ones run trajectories one after another on threaded kernels.
+struct TrajectoryResult {
+  std::vector<double> probabilities; // mean over trajectories, size 2^n (if requested)
+  std::vector<double> expect_z;      // mean <Z_q> per qubit
+  std::vector<double> stderr_z;      // standard error of each expect_z entry
+  std::size_t trajectories = 0;
+  bool converged = false;            // stopped early on target_stderr
+  ExecProfile profile;               // per trajectory
+};
+
+// Throws std::invalid_argument when opts.max_trajectories is 0.
+TrajectoryResult run_trajectories(const Circuit& c, uint64_t seed, const TrajectoryOptions& opts={});
+
+} // namespace qsx
@@ -3,15 +3,30 @@
 #pragma once
 #include "circuit.hpp"
 #include <vector>
+#include <optional>
+#include <string>
 
 namespace qsx {
 
 // Build full unitary matrix (2^n x 2^n) for a circuit composed of unitary ops.
-// Supports H, X, Y, Z, S, RX, RY, RZ, CNOT. Fails if noise or MEASURE present.
-// Returns row-major vector of complex numbers (size d*d).
-std::vector<c64> build_unitary(const Circuit& c);
+// Supports every gate op (LSB = qubit 0). Fails if noise or MEASURE present.
+// Returns row-major vector of complex numbers (size d*d). Every gate is applied to all columns
+// at once with the state-vector kernels (O(d^2) per gate, threaded; opts as for run()).
+std::vector<c64> build_unitary(const Circuit& c, const RunOptions& opts={});
 
-// Export unitary to CSV (real,imag pairs per cell)
+// Export unitary to CSV (real,imag pairs per cell); materialises U, so meant for small n (<= 14)
 bool export_unitary_csv(const Circuit& c, const std::string& path);
 
+// Binary unitary file: a 32-byte header (magic "QSXUNI1", version 1, flags (bit 0: column-major,
+// always set), n, bytes per real scalar: 4 = complex64, 8 = complex128), then U column by
+// column, column j being the 2^n amplitudes of U|j> as interleaved (re, im) in host byte order.
+// The data is a column-major d x d array at byte 32, so the file can be memory-mapped directly.
+//
+// U is computed one column at a time through the run() plan (columns in parallel under OpenMP)
+// and each column is written as soon as it is done: peak memory is O(d) per thread, with no
+// qubit limit. single: store complex64 instead of the build's native precision.
+bool export_unitary_binary(const Circuit& c, const std::string& path, bool single=false, const RunOptions& opts={});
+// Read a binary unitary file back as a row-major matrix; nqubits receives n.
+std::optional<std::vector<c64>> load_unitary_binary(const std::string& path, std::size_t& nqubits);
+
 } // namespace qsx
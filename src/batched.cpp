@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/batched.hpp"
+#include "quantum/reduce.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+namespace qsx {
+
+BatchedStateVector::BatchedStateVector(std::size_t n, std::size_t batch)
+  : n_(n), lane_bits_(std::size_t(std::countr_zero(std::bit_ceil(std::max<std::size_t>(batch, 1))))),
+    amp_(std::size_t(1) << (n + lane_bits_), c64{0.0, 0.0}) {
+  std::fill(amp_.begin(), amp_.begin() + std::ptrdiff_t(this->batch()), c64{1.0, 0.0});
+}
+
+void BatchedStateVector::assign(const StateVector& sv) {
+  assert(sv.num_qubits() == n_);
+  const std::size_t B = batch();
+  const auto& a = sv.amplitudes();
+  const std::ptrdiff_t N = std::ptrdiff_t(a.size());
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t i = 0; i < N; ++i)
+    std::fill_n(amp_.begin() + i * std::ptrdiff_t(B), B, a[std::size_t(i)]);
+  applied_ = 0;
+}
+
+void BatchedStateVector::extract(std::size_t b, StateVector& sv) const {
+  assert(sv.num_qubits() == n_ && b < batch());
+  auto& a = sv.amplitudes_mut();
+  const std::ptrdiff_t N = std::ptrdiff_t(a.size());
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t i = 0; i < N; ++i) a[std::size_t(i)] = amp_[(std::size_t(i) << lane_bits_) + b];
+}
+
+void BatchedStateVector::normalize() {
+  // Per-state sums chunk by chunk, combined in chunk order (as in reduce.hpp)
+  const std::size_t B = batch(), N = std::size_t(1) << n_;
+  const std::size_t chunk = std::min(N, kReduceChunk), nchunks = N / chunk;
+  std::vector<double> part(nchunks * B, 0.0);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t k = 0; k < (std::ptrdiff_t)nchunks; ++k) {
+    double* s = part.data() + std::size_t(k) * B;
+    for (std::size_t i = std::size_t(k) * chunk * B, e = i + chunk * B; i < e; i += B)
+      for (std::size_t b = 0; b < B; ++b) s[b] += std::norm(amp_[i + b]);
+  }
+  std::vector<c64::value_type> scale(B);
+  for (std::size_t b = 0; b < B; ++b) {
+    double total = 0.0;
+    for (std::size_t k = 0; k < nchunks; ++k) total += part[k * B + b];
+    scale[b] = c64::value_type(1.0 / std::sqrt(total));
+  }
+  const std::ptrdiff_t M = std::ptrdiff_t(amp_.size());
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t i = 0; i < M; ++i) amp_[std::size_t(i)] *= scale[std::size_t(i) & (B - 1)];
+}
+
+void BatchedStateVector::count_gates(std::size_t gates) {
+  const std::size_t before = applied_;
+  applied_ += gates;
+  if ((before >> 8) != (applied_ >> 8)) normalize();
+}
+
+} // namespace qsx
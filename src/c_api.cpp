@@ -2,11 +2,16 @@
 
 #include "quantum/c_api.h"
 #include "quantum/circuit.hpp"
+#include "quantum/density_matrix.hpp"
 #include "quantum/optimize.hpp"
+#include "quantum/qasm.hpp"
+#include "quantum/sampling.hpp"
 #include <string>
 #include <sstream>
 #include <optional>
 #include <cstring>
+#include <fstream>
+#include <map>
 
 extern "C" {
 
@@ -30,31 +35,41 @@ int qsx_run_string(const char* circuit_text, const char* options_json, char** ou
   // crude autodetect
   std::string trimmed = txt; trimmed.erase(0, trimmed.find_first_not_of(" \t\r\n"));
   if (trimmed.rfind("OPENQASM", 0) == 0){
-    circ_opt = parse_qasm_string(txt, err);
+    circ_opt = qsx::parse_qasm_string(txt, err);
   } else {
-    circ_opt = parse_circuit_string(txt, err);
+    circ_opt = qsx::parse_circuit_string(txt, err);
   }
   if (!circ_opt) return 3;
   auto circ = *circ_opt;
   std::string opts = options_json? options_json : "";
-  std::string be = get_kv(opts, ""backend"");
+  std::string be = get_kv(opts, "\"backend\"");
   int shots = 1;
   uint64_t seed = 12345;
-  if (auto s = get_kv(opts, ""shots""); !s.empty()) shots = std::max(1, std::stoi(s));
-  if (auto s = get_kv(opts, ""seed""); !s.empty()) seed = std::stoull(s);
+  if (auto s = get_kv(opts, "\"shots\""); !s.empty()) shots = std::max(1, std::stoi(s));
+  if (auto s = get_kv(opts, "\"seed\""); !s.empty()) seed = std::stoull(s);
   bool use_density = (be=="density");
+  qsx::ShotsResult sr;
+  if (use_density){
+    // The density matrix holds the exact noise-averaged distribution: one run, every shot sampled from it
+    sr.probabilities = qsx::run_density(circ, seed, false).probabilities;
+    qsx::Rng rng(seed);
+    sr.outcomes = qsx::sample_indices(sr.probabilities, (std::size_t)shots, rng);
+    for (auto idx : sr.outcomes) ++sr.histogram[idx];
+  } else {
+    // Simulate once (or per shot for noisy circuits) and sample all shots
+    sr = qsx::run_shots(circ, (std::size_t)shots, seed, true);
+  }
   std::vector<std::vector<int>> outcomes; outcomes.reserve(shots);
   std::map<std::string,int> counts;
-  std::vector<double> probs;
-  for (int s=0;s<shots;++s){
-    auto r = qsx::run(circ, seed + s, use_density);
-    if (s==0) probs = r.probabilities;
-    outcomes.push_back(r.outcome);
-    // helper: bitstring msb..lsb
-    std::string key; key.reserve(r.outcome.size());
-    for (int i=int(r.outcome.size())-1;i>=0;--i) key.push_back(r.outcome[i]?'1':'0');
-    counts[key] += 1;
-  }
+  const std::vector<double>& probs = sr.probabilities;
+  // helper: bitstring msb..lsb
+  auto key_of = [&](const std::vector<int>& bits){
+    std::string key; key.reserve(bits.size());
+    for (int i=int(bits.size())-1;i>=0;--i) key.push_back(bits[i]?'1':'0');
+    return key;
+  };
+  for (auto idx : sr.outcomes) outcomes.push_back(qsx::basis_to_bits(idx, circ.nqubits));
+  for (const auto& [idx, cnt] : sr.histogram) counts[key_of(qsx::basis_to_bits(idx, circ.nqubits))] += (int)cnt;
   std::ostringstream os;
   os << "{\n  \"nqubits\": " << circ.nqubits << ",\n  \"probabilities\": [";
   for (size_t i=0;i<probs.size();++i){ os<<probs[i]; if (i+1<probs.size()) os<<", "; }
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/channel_fusion.hpp"
+#include "quantum/fusion.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace qsx {
+
+namespace {
+
+// Pauli channel deferred on one qubit, as its PTM diagonal (1, lx, ly, lz)
+struct Frame {
+  double lx = 1.0, ly = 1.0, lz = 1.0;
+  std::size_t sources = 0;
+  Op op{};               // the source op while the frame is a single, unmoved one
+  bool verbatim = false;
+};
+
+// Pending step on one or two qubits (ascending). Ops on disjoint groups commute, so groups are
+// only emitted when a later op needs their qubits together with others.
+struct Group {
+  std::vector<std::size_t> qubits;
+  std::vector<Op> gates;    // while the group is unitary
+  std::vector<c64> superop; // once a channel has been absorbed
+  std::size_t sources = 0;
+  Op first{};               // the source op while it is the only one (verbatim)
+  bool verbatim = false;
+  bool unitary() const { return superop.empty(); }
+};
+
+std::vector<c64> identity_superop(std::size_t k){
+  const std::size_t D = std::size_t(1) << (2*k);
+  std::vector<c64> s(D*D, c64{0, 0});
+  for (std::size_t i=0;i<D;++i) s[i*D + i] = c64{1, 0};
+  return s;
+}
+
+std::vector<c64> matmul(const std::vector<c64>& a, const std::vector<c64>& b){
+  const std::size_t D = a.size() == 16 ? 4 : 16;
+  std::vector<c64> c(D*D, c64{0, 0});
+  for (std::size_t i=0;i<D;++i)
+    for (std::size_t k=0;k<D;++k){
+      const c64 x = a[i*D + k];
+      if (x == c64{0, 0}) continue;
+      for (std::size_t j=0;j<D;++j) c[i*D + j] += x * b[k*D + j];
+    }
+  return c;
+}
+
+// Superoperator on `src` (a subset of `dst`, both ascending) extended by the identity to `dst`
+std::vector<c64> embed(const std::vector<c64>& s, const std::vector<std::size_t>& src, const std::vector<std::size_t>& dst){
+  if (src == dst) return s;
+  const std::size_t j = dst[0] == src[0] ? 0 : 1, o = 1 - j;
+  std::vector<c64> e(256, c64{0, 0});
+  for (std::size_t l=0;l<16;++l)
+    for (std::size_t lp=0;lp<16;++lp){
+      const std::size_t r = l >> 2, c = l & 3, rp = lp >> 2, cp = lp & 3;
+      if ((((r ^ rp) >> o) & 1) || (((c ^ cp) >> o) & 1)) continue;
+      const std::size_t a = ((c >> j) & 1) + 2*((r >> j) & 1), b = ((cp >> j) & 1) + 2*((rp >> j) & 1);
+      e[l*16 + lp] = s[a*4 + b];
+    }
+  return e;
+}
+
+std::vector<c64> superop_of(const Group& g){
+  if (!g.unitary()) return g.superop;
+  return channel_from_kraus({block_matrix(g.gates, g.qubits)}, g.qubits.size()).superop;
+}
+
+std::vector<c64> superop_of(const Frame& f){
+  std::vector<double> R(16, 0.0);
+  R[0] = 1.0; R[5] = f.lx; R[10] = f.ly; R[15] = f.lz;
+  return channel_from_ptm(R, 1).superop;
+}
+
+// Rewrite the Pauli channel f on qubit q, applied before `op`, as f' applied after it
+// (op f = f' op). False when f' would not be a Pauli channel on q alone.
+bool push_through(Frame& f, const Op& op, std::size_t q){
+  const bool z_only = f.lz == 1.0; // no X or Y errors
+  const bool x_only = f.lx == 1.0; // no Y or Z errors
+  switch (op.type){
+    case OpType::X: case OpType::Y: case OpType::Z: case OpType::SWAP: return true;
+    case OpType::H: std::swap(f.lx, f.lz); return true;
+    case OpType::S: std::swap(f.lx, f.ly); return true;
+    // Rotations commute with channels symmetric about their axis
+    case OpType::RZ: return f.lx == f.ly;
+    case OpType::RX: return f.ly == f.lz;
+    case OpType::RY: return f.lx == f.lz;
+    case OpType::U3: return f.lx == f.ly && f.ly == f.lz;
+    case OpType::CZ: return z_only;
+    case OpType::CNOT: return q == op.qubits[0] ? z_only : x_only;
+    case OpType::CCX: return q == op.qubits[2] ? x_only : z_only;
+    default: return false;
+  }
+}
+
+class Compiler {
+  DensityProgram& prog_;
+  std::vector<Group> groups_;
+  std::vector<long> owner_; // index into groups_ per qubit, -1 when nothing is pending
+  std::vector<Frame> frames_;
+
+  void emit(long gi){
+    Group& g = groups_[gi];
+    DensityStep st;
+    st.sources = g.sources;
+    if (g.verbatim) st.op = g.first;
+    else {
+      st.qubits = g.qubits;
+      if (g.unitary()) st.unitary = block_matrix(g.gates, g.qubits);
+      else st.channel = Channel{g.qubits.size(), std::move(g.superop), {}};
+    }
+    prog_.steps.push_back(std::move(st));
+    for (auto q : g.qubits) owner_[q] = -1;
+    g = Group{};
+  }
+
+  // Pending group that covers the ascending qubits `qs` on at most two qubits. Groups that
+  // would grow it beyond that are emitted; the others are merged.
+  Group& group_for(const std::vector<std::size_t>& qs){
+    std::vector<long> touching;
+    std::vector<std::size_t> u = qs;
+    for (auto q : qs){
+      const long gi = owner_[q];
+      if (gi < 0 || std::find(touching.begin(), touching.end(), gi) != touching.end()) continue;
+      touching.push_back(gi);
+      for (auto p : groups_[gi].qubits) if (std::find(u.begin(), u.end(), p) == u.end()) u.push_back(p);
+    }
+    if (u.size() > 2){
+      u = qs;
+      std::vector<long> kept;
+      for (auto gi : touching){
+        bool inside = true;
+        for (auto p : groups_[gi].qubits) inside &= std::find(qs.begin(), qs.end(), p) != qs.end();
+        if (inside) kept.push_back(gi); else emit(gi);
+      }
+      touching = std::move(kept);
+    }
+    std::sort(u.begin(), u.end());
+    if (touching.size() == 1 && groups_[touching[0]].qubits == u) return groups_[touching[0]];
+
+    Group merged;
+    merged.qubits = u;
+    bool unitary = true;
+    for (auto gi : touching) unitary &= groups_[gi].unitary();
+    if (!unitary) merged.superop = identity_superop(u.size());
+    for (auto gi : touching){
+      Group& g = groups_[gi];
+      if (unitary) merged.gates.insert(merged.gates.end(), g.gates.begin(), g.gates.end());
+      else merged.superop = matmul(embed(superop_of(g), g.qubits, u), merged.superop);
+      merged.sources += g.sources;
+      g = Group{};
+    }
+    const long gi = (long)groups_.size();
+    for (auto q : u) owner_[q] = gi;
+    groups_.push_back(std::move(merged));
+    return groups_.back();
+  }
+
+  void absorb_gate(const Op& op){
+    std::vector<std::size_t> qs = op.qubits;
+    std::sort(qs.begin(), qs.end());
+    Group& g = group_for(qs);
+    g.verbatim = g.sources++ == 0;
+    if (g.verbatim) g.first = op;
+    if (g.unitary()) g.gates.push_back(op);
+    else {
+      const auto s = channel_from_kraus({block_matrix({op}, qs)}, qs.size()).superop;
+      g.superop = matmul(embed(s, qs, g.qubits), g.superop);
+    }
+  }
+
+  void absorb_channel(std::size_t q, const std::vector<c64>& s, std::size_t sources, const Op* op){
+    Group& g = group_for({q});
+    if (g.sources == 0){
+      g.superop = embed(s, {q}, g.qubits);
+      g.sources = sources;
+      g.verbatim = op != nullptr;
+      if (op) g.first = *op;
+      return;
+    }
+    g.verbatim = false;
+    if (g.unitary()){ g.superop = superop_of(g); g.gates.clear(); }
+    g.superop = matmul(embed(s, {q}, g.qubits), g.superop);
+    g.sources += sources;
+  }
+
+  void materialize(std::size_t q){
+    Frame& f = frames_[q];
+    if (f.sources == 0) return;
+    absorb_channel(q, superop_of(f), f.sources, f.verbatim ? &f.op : nullptr);
+    f = Frame{};
+  }
+
+public:
+  explicit Compiler(DensityProgram& prog) : prog_(prog), owner_(prog.nqubits, -1), frames_(prog.nqubits) {}
+
+  void add(const Op& op){
+    if (op.type == OpType::MEASURE) return;
+    ++prog_.source_ops;
+    switch (op.type){
+      case OpType::DEPHASE: case OpType::DEPOL: {
+        Frame& f = frames_[op.qubits[0]];
+        const double a = op.type == OpType::DEPHASE ? 1.0 - 2.0*op.angle : 1.0 - 4.0*op.angle/3.0;
+        f.lx *= a; f.ly *= a;
+        if (op.type == OpType::DEPOL) f.lz *= a;
+        f.verbatim = f.sources++ == 0;
+        f.op = op;
+        return;
+      }
+      case OpType::AMPDAMP:
+        materialize(op.qubits[0]);
+        absorb_channel(op.qubits[0], amplitude_damping(op.angle).superop, 1, &op);
+        return;
+      default: break;
+    }
+    for (auto q : op.qubits){
+      Frame& f = frames_[q];
+      if (f.sources == 0) continue;
+      if (!push_through(f, op, q)){ materialize(q); continue; }
+      ++prog_.commuted;
+      if (op.type == OpType::H || op.type == OpType::S || op.type == OpType::SWAP) f.verbatim = false;
+    }
+    if (op.type == OpType::SWAP) std::swap(frames_[op.qubits[0]], frames_[op.qubits[1]]);
+    if (op.qubits.size() > 2){
+      for (auto q : op.qubits) if (owner_[q] >= 0) emit(owner_[q]);
+      prog_.steps.push_back(DensityStep{op});
+      return;
+    }
+    absorb_gate(op);
+  }
+
+  void finish(bool diagonal_only){
+    for (std::size_t q=0;q<frames_.size();++q){
+      // Z-type noise at the end only touches coherences
+      if (diagonal_only && frames_[q].lz == 1.0){
+        prog_.dropped += frames_[q].sources;
+        frames_[q] = Frame{};
+      }
+      materialize(q);
+    }
+    for (std::size_t gi=0;gi<groups_.size();++gi) if (!groups_[gi].qubits.empty()) emit((long)gi);
+  }
+};
+
+} // namespace
+
+DensityProgram compile_density(const Circuit& c, bool diagonal_only){
+  DensityProgram prog;
+  prog.nqubits = c.nqubits;
+  Compiler comp(prog);
+  for (const auto& op : c.ops) comp.add(op);
+  comp.finish(diagonal_only);
+  return prog;
+}
+
+} // namespace qsx
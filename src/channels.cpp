@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/channels.hpp"
+#include <cmath>
+#include <stdexcept>
+
+namespace qsx {
+
+static void check_arity(std::size_t k){
+  if (k != 1 && k != 2) throw std::invalid_argument("channels act on one or two qubits");
+}
+
+Channel channel_from_kraus(const std::vector<std::vector<c64>>& kraus, std::size_t k){
+  check_arity(k);
+  const std::size_t d = std::size_t(1) << k, D = d*d;
+  Channel ch;
+  ch.nqubits = k;
+  ch.kraus = kraus;
+  ch.superop.assign(D*D, c64{0, 0});
+  for (const auto& K : kraus){
+    if (K.size() != D) throw std::invalid_argument("Kraus operator has the wrong size");
+    for (std::size_t l=0;l<D;++l)
+      for (std::size_t lp=0;lp<D;++lp){
+        const std::size_t r = l / d, c = l % d, rp = lp / d, cp = lp % d;
+        ch.superop[l*D + lp] += K[r*d + rp] * std::conj(K[c*d + cp]);
+      }
+  }
+  return ch;
+}
+
+Channel channel_from_superop(std::vector<c64> superop, std::size_t k){
+  check_arity(k);
+  const std::size_t D = std::size_t(1) << (2*k);
+  if (superop.size() != D*D) throw std::invalid_argument("superoperator has the wrong size");
+  return Channel{k, std::move(superop), {}};
+}
+
+// Entry [r][c] of the k-qubit Pauli string i (base-4 digit j acts on local bit j)
+static c64 pauli_entry(std::size_t i, std::size_t r, std::size_t c, std::size_t k){
+  static const c64 sigma[4][4] = {
+    {{1,0}, {0,0}, {0,0}, {1,0}},   // I
+    {{0,0}, {1,0}, {1,0}, {0,0}},   // X
+    {{0,0}, {0,-1}, {0,1}, {0,0}},  // Y
+    {{1,0}, {0,0}, {0,0}, {-1,0}}}; // Z
+  c64 v{1, 0};
+  for (std::size_t j=0;j<k;++j){
+    const std::size_t p = (i >> (2*j)) & 3, rb = (r >> j) & 1, cb = (c >> j) & 1;
+    v *= sigma[p][rb*2 + cb];
+  }
+  return v;
+}
+
+Channel channel_from_ptm(const std::vector<double>& ptm, std::size_t k){
+  check_arity(k);
+  const std::size_t d = std::size_t(1) << k, D = d*d;
+  if (ptm.size() != D*D) throw std::invalid_argument("PTM has the wrong size");
+  // E(rho) = sum_ij R_ij Tr(P_j rho) / d P_i
+  std::vector<c64> s(D*D, c64{0, 0});
+  for (std::size_t i=0;i<D;++i)
+    for (std::size_t j=0;j<D;++j){
+      const double rij = ptm[i*D + j];
+      if (rij == 0.0) continue;
+      for (std::size_t l=0;l<D;++l){
+        const c64 pi = pauli_entry(i, l / d, l % d, k);
+        if (pi == c64{0, 0}) continue;
+        for (std::size_t lp=0;lp<D;++lp)
+          s[l*D + lp] += c64(rij / double(d)) * pi * pauli_entry(j, lp % d, lp / d, k);
+      }
+    }
+  return Channel{k, std::move(s), {}};
+}
+
+std::vector<double> channel_ptm(const Channel& ch){
+  const std::size_t k = ch.nqubits, d = std::size_t(1) << k, D = d*d;
+  std::vector<double> R(D*D, 0.0);
+  std::vector<c64> out(D);
+  for (std::size_t j=0;j<D;++j){
+    // E(P_j) in block order, then R_ij = Tr(P_i E(P_j)) / d
+    for (std::size_t l=0;l<D;++l){
+      c64 v{0, 0};
+      for (std::size_t lp=0;lp<D;++lp) v += ch.superop[l*D + lp] * pauli_entry(j, lp / d, lp % d, k);
+      out[l] = v;
+    }
+    for (std::size_t i=0;i<D;++i){
+      c64 tr{0, 0};
+      for (std::size_t l=0;l<D;++l) tr += pauli_entry(i, l % d, l / d, k) * out[l];
+      R[i*D + j] = std::real(tr) / double(d);
+    }
+  }
+  return R;
+}
+
+Channel amplitude_damping(double gamma){
+  return generalized_amplitude_damping(gamma, 1.0);
+}
+
+Channel generalized_amplitude_damping(double gamma, double p){
+  const double a = std::sqrt(p), b = std::sqrt(1.0 - p), g = std::sqrt(gamma), h = std::sqrt(1.0 - gamma);
+  const c64 zero{0, 0};
+  std::vector<std::vector<c64>> kraus = {
+    {c64(a), zero, zero, c64(a*h)}, {zero, c64(a*g), zero, zero},  // decay |1> -> |0>
+    {c64(b*h), zero, zero, c64(b)}, {zero, zero, c64(b*g), zero}}; // excitation |0> -> |1>
+  return channel_from_kraus(kraus, 1);
+}
+
+// Kraus operators b * A * a (every product), 2x2 each
+static std::vector<std::vector<c64>> compose(const std::vector<std::vector<c64>>& a, const std::vector<std::vector<c64>>& b){
+  std::vector<std::vector<c64>> out;
+  for (const auto& B : b)
+    for (const auto& A : a){
+      std::vector<c64> m(4, c64{0, 0});
+      for (std::size_t r=0;r<2;++r)
+        for (std::size_t c=0;c<2;++c) m[r*2 + c] = B[r*2]*A[c] + B[r*2 + 1]*A[2 + c];
+      out.push_back(std::move(m));
+    }
+  return out;
+}
+
+// Kraus operators sqrt(p_i) P_i of a k-qubit Pauli channel (probabilities indexed like the PTM)
+static std::vector<std::vector<c64>> pauli_kraus(const std::vector<double>& probs, std::size_t k){
+  const std::size_t d = std::size_t(1) << k;
+  std::vector<std::vector<c64>> kraus;
+  for (std::size_t i=0;i<probs.size();++i){
+    if (probs[i] <= 0.0) continue;
+    std::vector<c64> m(d*d);
+    const c64 w(std::sqrt(probs[i]));
+    for (std::size_t r=0;r<d;++r)
+      for (std::size_t c=0;c<d;++c) m[r*d + c] = w * pauli_entry(i, r, c, k);
+    kraus.push_back(std::move(m));
+  }
+  return kraus;
+}
+
+Channel thermal_relaxation(double t1, double t2, double t, double pe){
+  if (t2 > 2.0*t1) throw std::invalid_argument("thermal relaxation requires T2 <= 2 T1");
+  // Populations relax towards (1 - pe, pe) at rate 1/T1 (generalized amplitude damping, which
+  // leaves coherences at exp(-t/2T1)); the remaining decay to exp(-t/T2) is pure dephasing.
+  const double g = 1.0 - std::exp(-t/t1), f = std::exp(-t/t2 + t/(2.0*t1));
+  const auto relax = generalized_amplitude_damping(g, 1.0 - pe).kraus;
+  return channel_from_kraus(compose(relax, pauli_kraus({0.5 + 0.5*f, 0.0, 0.0, 0.5 - 0.5*f}, 1)), 1);
+}
+
+Channel pauli_channel(double px, double py, double pz){
+  return channel_from_kraus(pauli_kraus({1.0 - px - py - pz, px, py, pz}, 1), 1);
+}
+
+Channel dephasing(double p){ return pauli_channel(0.0, 0.0, p); }
+
+Channel depolarizing(double p){ return pauli_channel(p/3.0, p/3.0, p/3.0); }
+
+Channel depolarizing_2q(double p){
+  std::vector<double> probs(16, p/15.0);
+  probs[0] = 1.0 - p;
+  return channel_from_kraus(pauli_kraus(probs, 2), 2);
+}
+
+} // namespace qsx
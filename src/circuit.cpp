@@ -1,10 +1,15 @@
 // SPDX-License-Identifier: MIT
 
 #include "quantum/circuit.hpp"
+#include "quantum/sampling.hpp"
+#include "quantum/schedule.hpp"
+#include "quantum/kernels.hpp"
+#include "quantum/reduce.hpp"
 #include <fstream>
 #include <sstream>
 #include <charconv>
 #include <cctype>
+#include <algorithm>
 
 namespace qsx {
 
@@ -18,9 +23,7 @@ static bool parse_size_t(const std::string& s, std::size_t& out) {
   } catch(...) { return false; }
 }
 
-std::optional<Circuit> parse_circuit_file(const std::string& path, std::string& err) {
-  std::ifstream in(path);
-  if (!in) { err = "Cannot open circuit file: " + path; return std::nullopt; }
+static std::optional<Circuit> parse_circuit_stream(std::istream& in, std::string& err) {
   Circuit c;
   std::string line;
   std::size_t lineno = 0;
@@ -47,14 +50,16 @@ std::optional<Circuit> parse_circuit_file(const std::string& path, std::string&
 } else if (op == "RX" || op == "RY") {
   std::string tq, ang; ss >> tq >> ang;
   std::size_t t; if (!parse_size_t(tq, t)) { err = "Invalid target at line " + std::to_string(lineno); return std::nullopt; }
-  double a = std::stod(ang);
-  c.ops.push_back({op=="RX"?OpType::RX:OpType::RY, {t}, a});
+  Op r{op=="RX"?OpType::RX:OpType::RY, {t}, 0.0};
+  if (!parse_angle(ang, r)) { err = "Invalid angle at line " + std::to_string(lineno); return std::nullopt; }
+  c.ops.push_back(std::move(r));
   c.nqubits = std::max(c.nqubits, t+1);
     } else if (op == "RZ") {
       std::string tq, ang; ss >> tq >> ang;
       std::size_t t; if (!parse_size_t(tq, t)) { err = "Invalid target at line " + std::to_string(lineno); return std::nullopt; }
-      double a = std::stod(ang);
-      c.ops.push_back({OpType::RZ, {t}, a});
+      Op r{OpType::RZ, {t}, 0.0};
+      if (!parse_angle(ang, r)) { err = "Invalid angle at line " + std::to_string(lineno); return std::nullopt; }
+      c.ops.push_back(std::move(r));
       c.nqubits = std::max(c.nqubits, t+1);
 
 } else if (op == "DEPHASE") {
@@ -70,6 +75,13 @@ std::optional<Circuit> parse_circuit_file(const std::string& path, std::string&
   double p = std::stod(prob);
   if (p < 0.0 || p > 1.0) { err = "Probability out of range at line " + std::to_string(lineno); return std::nullopt; }
   c.ops.push_back({OpType::DEPOL, {t}, p});
+  c.nqubits = std::max(c.nqubits, t+1);
+} else if (op == "AMPDAMP") {
+  std::string tq, prob; ss >> tq >> prob;
+  std::size_t t; if (!parse_size_t(tq, t)) { err = "Invalid target at line " + std::to_string(lineno); return std::nullopt; }
+  double g = std::stod(prob);
+  if (g < 0.0 || g > 1.0) { err = "Damping rate out of range at line " + std::to_string(lineno); return std::nullopt; }
+  c.ops.push_back({OpType::AMPDAMP, {t}, g});
   c.nqubits = std::max(c.nqubits, t+1);
     } else if (op == "CNOT") {
       std::string cq, tq; ss >> cq >> tq;
@@ -77,6 +89,32 @@ std::optional<Circuit> parse_circuit_file(const std::string& path, std::string&
       if (!parse_size_t(cq, cbit) || !parse_size_t(tq, tbit)) { err = "Invalid CNOT at line " + std::to_string(lineno); return std::nullopt; }
       c.ops.push_back({OpType::CNOT, {cbit, tbit}, 0.0});
       c.nqubits = std::max(c.nqubits, std::max(cbit, tbit)+1);
+    } else if (op == "CZ" || op == "SWAP" || op == "CCX") {
+      const std::size_t k = op == "CCX" ? 3 : 2;
+      std::vector<std::size_t> qs(k);
+      for (auto& q : qs) {
+        std::string tok; ss >> tok;
+        if (!parse_size_t(tok, q)) { err = "Invalid " + op + " at line " + std::to_string(lineno); return std::nullopt; }
+        c.nqubits = std::max(c.nqubits, q+1);
+      }
+      for (std::size_t i=0;i<k;++i) for (std::size_t j=i+1;j<k;++j)
+        if (qs[i] == qs[j]) { err = "Repeated qubit in " + op + " at line " + std::to_string(lineno); return std::nullopt; }
+      c.ops.push_back({op=="CZ"?OpType::CZ:op=="SWAP"?OpType::SWAP:OpType::CCX, qs, 0.0});
+    } else if (op == "U3") {
+      std::string tq; ss >> tq;
+      std::size_t t; if (!parse_size_t(tq, t)) { err = "Invalid target at line " + std::to_string(lineno); return std::nullopt; }
+      std::vector<double> p(3);
+      for (auto& x : p) if (!(ss >> x)) { err = "U3 needs theta phi lambda at line " + std::to_string(lineno); return std::nullopt; }
+      c.ops.push_back({OpType::U3, {t}, 0.0, p});
+      c.nqubits = std::max(c.nqubits, t+1);
+    } else if (op == "U2Q") {
+      std::string aq, bq; ss >> aq >> bq;
+      std::size_t qa, qb;
+      if (!parse_size_t(aq, qa) || !parse_size_t(bq, qb) || qa == qb) { err = "Invalid U2Q qubits at line " + std::to_string(lineno); return std::nullopt; }
+      std::vector<double> p(32);
+      for (auto& x : p) if (!(ss >> x)) { err = "U2Q needs 32 matrix values at line " + std::to_string(lineno); return std::nullopt; }
+      c.ops.push_back({OpType::U2Q, {qa, qb}, 0.0, p});
+      c.nqubits = std::max(c.nqubits, std::max(qa, qb)+1);
     } else if (op == "MEASURE") {
       std::string all; ss >> all;
       if (all != "ALL") { err = "Only 'MEASURE ALL' supported at line " + std::to_string(lineno); return std::nullopt; }
@@ -89,127 +127,419 @@ std::optional<Circuit> parse_circuit_file(const std::string& path, std::string&
   return c;
 }
 
+std::optional<Circuit> parse_circuit_file(const std::string& path, std::string& err) {
+  std::ifstream in(path);
+  if (!in) { err = "Cannot open circuit file: " + path; return std::nullopt; }
+  return parse_circuit_stream(in, err);
+}
+
+std::optional<Circuit> parse_circuit_string(const std::string& text, std::string& err) {
+  std::istringstream in(text);
+  return parse_circuit_stream(in, err);
+}
 
-RunResult run(const Circuit& c, uint64_t seed, bool collapse) {
-  StateVector sv(c.nqubits);
-  Rng rng(seed);
-  // Apply ops
-  for (const auto& op : c.ops) {
-    using namespace qsx::gates;
-    c64 u00,u01,u10,u11;
-    switch (op.type) {
-      case OpType::H:
-        H_coeffs(u00,u01,u10,u11);
-        sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        break;
-      case OpType::X:
-        X_coeffs(u00,u01,u10,u11);
-        sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        break;
-      case OpType::Y:
-        Y_coeffs(u00,u01,u10,u11);
-        sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        break;
-      case OpType::Z:
-        Z_coeffs(u00,u01,u10,u11); sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11); break;
-      case OpType::S:
-        S_coeffs(u00,u01,u10,u11); sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11); break;
-      case OpType::RX:
-        RX_coeffs(op.angle, u00,u01,u10,u11); sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11); break;
-      case OpType::RY:
-        RY_coeffs(op.angle, u00,u01,u10,u11); sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11); break;
-      case OpType::Z:
-        Z_coeffs(u00,u01,u10,u11);
-        sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        break;
-      case OpType::RZ:
-        RZ_coeffs(op.angle, u00,u01,u10,u11);
-        sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        break;
-      case OpType::CNOT:
-        sv.apply_cx(op.qubits[0], op.qubits[1]);
-        break;
-      case OpType::DEPHASE: {
-        // Simple dephasing: with prob p apply Z, else I
-        double r = rng.uniform();
-        if (r < op.angle) { // angle stores probability
-          Z_coeffs(u00,u01,u10,u11);
-          sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        }
-        break;
-      }
-      case OpType::DEPOL: {
-        // Depolarizing: with prob p apply uniformly random X/Y/Z
-        double r = rng.uniform();
-        if (r < op.angle) {
-          double k = rng.uniform();
-          if (k < 1.0/3.0) { X_coeffs(u00,u01,u10,u11); }
-          else if (k < 2.0/3.0) { Y_coeffs(u00,u01,u10,u11); }
-          else { Z_coeffs(u00,u01,u10,u11); }
-          sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
+// Whole-string number (std::stod also accepts a valid prefix)
+static bool parse_number(const std::string& s, double& v) {
+  try {
+    std::size_t pos = 0;
+    v = std::stod(s, &pos);
+    return pos == s.size();
+  } catch (...) { return false; }
+}
+
+bool parse_angle(std::string_view tok, Op& op) {
+  const std::string s(tok);
+  double v;
+  if (parse_number(s, v)) { op.angle = v; op.param.clear(); op.param_scale = 1.0; return true; }
+  std::size_t i = 0;
+  double scale = 1.0, offset = 0.0;
+  if (i < s.size() && (s[i] == '-' || s[i] == '+')) { if (s[i] == '-') scale = -1.0; ++i; }
+  const auto star = s.find('*', i);
+  if (star != std::string::npos) {
+    if (!parse_number(s.substr(i, star - i), v)) return false;
+    scale *= v;
+    i = star + 1;
+  }
+  auto word = [](char ch, bool first){ return std::isalpha((unsigned char)ch) || ch == '_' || (!first && std::isdigit((unsigned char)ch)); };
+  std::size_t j = i;
+  while (j < s.size() && word(s[j], j == i)) ++j;
+  if (j == i) return false;
+  const std::string name = s.substr(i, j - i);
+  if (name == "pi") return false;
+  if (j < s.size() && ((s[j] != '+' && s[j] != '-') || !parse_number(s.substr(j), offset))) return false;
+  op.angle = offset;
+  op.param = name;
+  op.param_scale = scale;
+  return true;
+}
+
+std::string format_angle(const Op& op) {
+  std::ostringstream ss;
+  if (op.param.empty()) { ss << op.angle; return ss.str(); }
+  if (op.param_scale == -1.0) ss << '-';
+  else if (op.param_scale != 1.0) ss << op.param_scale << '*';
+  ss << op.param;
+  if (op.angle != 0.0) ss << std::showpos << op.angle;
+  return ss.str();
+}
+
+std::vector<std::string> circuit_parameters(const Circuit& c) {
+  std::vector<std::string> names;
+  for (const auto& op : c.ops)
+    if (!op.param.empty() && std::find(names.begin(), names.end(), op.param) == names.end()) names.push_back(op.param);
+  return names;
+}
+
+Circuit bind_parameters(const Circuit& c, const std::map<std::string, double>& values) {
+  Circuit out = c;
+  for (auto& op : out.ops) {
+    if (op.param.empty()) continue;
+    const auto it = values.find(op.param);
+    if (it == values.end()) continue;
+    op.angle += op.param_scale * it->second;
+    op.param.clear();
+    op.param_scale = 1.0;
+  }
+  return out;
+}
+
+
+// Kernel class of a gate: dense 2x2 or diagonal (u[0], u[3]) on qubits[0], a permutation, a
+// phase on the amplitudes whose `mask` bits are all 1 (u[0]), or a dense 4x4 on two qubits.
+enum class GateShape { Dense, Diag, X, CX, MCX, Swap, Phase, Dense2 };
+
+static std::size_t bit_mask(const std::vector<std::size_t>& qs, std::size_t count) {
+  std::size_t m = 0;
+  for (std::size_t i=0;i<count;++i) m |= std::size_t(1) << qs[i];
+  return m;
+}
+
+// U2Q matrix with local bits in ascending qubit order (u has 16 entries).
+static void u2q_matrix(const Op& op, c64 u[16]) {
+  for (std::size_t i=0;i<16;++i) u[i] = c64(op.params[2*i], op.params[2*i+1]);
+  if (op.qubits[0] < op.qubits[1]) return;
+  // Exchange local bits 0 and 1 of row and column indices
+  auto sw = [](std::size_t x){ return ((x & 1) << 1) | ((x >> 1) & 1); };
+  c64 t[16];
+  for (std::size_t r=0;r<4;++r) for (std::size_t col=0;col<4;++col) t[sw(r)*4 + sw(col)] = u[r*4 + col];
+  std::copy(t, t + 16, u);
+}
+
+static bool gate_shape(const Op& op, GateShape& shape, c64 u[16]) {
+  using namespace qsx::gates;
+  switch (op.type) {
+    case OpType::H: H_coeffs(u[0],u[1],u[2],u[3]); shape = GateShape::Dense; return true;
+    case OpType::X: shape = GateShape::X; return true;
+    case OpType::Y: Y_coeffs(u[0],u[1],u[2],u[3]); shape = GateShape::Dense; return true;
+    // Diagonal gates only rescale amplitudes
+    case OpType::Z: u[0] = c64{1,0}; u[3] = c64{-1,0}; shape = GateShape::Diag; return true;
+    case OpType::S: u[0] = c64{1,0}; u[3] = c64{0,1}; shape = GateShape::Diag; return true;
+    case OpType::RZ: RZ_coeffs(op.angle, u[0],u[1],u[2],u[3]); shape = GateShape::Diag; return true;
+    case OpType::RX: RX_coeffs(op.angle, u[0],u[1],u[2],u[3]); shape = GateShape::Dense; return true;
+    case OpType::RY: RY_coeffs(op.angle, u[0],u[1],u[2],u[3]); shape = GateShape::Dense; return true;
+    case OpType::U3: U3_coeffs(op.params[0], op.params[1], op.params[2], u[0],u[1],u[2],u[3]); shape = GateShape::Dense; return true;
+    case OpType::CNOT: shape = GateShape::CX; return true;
+    case OpType::CCX: shape = GateShape::MCX; return true;
+    case OpType::SWAP: shape = GateShape::Swap; return true;
+    case OpType::CZ: u[0] = c64{-1,0}; shape = GateShape::Phase; return true;
+    case OpType::U2Q: u2q_matrix(op, u); shape = GateShape::Dense2; return true;
+    case OpType::MEASURE:
+    case OpType::DEPHASE:
+    case OpType::DEPOL:
+    case OpType::AMPDAMP:
+      break;
+  }
+  return false;
+}
+
+bool apply_unitary(StateVector& sv, const Op& op) {
+  GateShape shape;
+  c64 u[16];
+  if (!gate_shape(op, shape, u)) return false;
+  const auto& q = op.qubits;
+  switch (shape) {
+    case GateShape::Dense: sv.apply_gate_1q(q[0], u[0],u[1],u[2],u[3]); break;
+    case GateShape::Diag: sv.apply_diag_1q(q[0], u[0], u[3]); break;
+    case GateShape::X: sv.apply_x(q[0]); break;
+    case GateShape::CX: sv.apply_cx(q[0], q[1]); break;
+    case GateShape::MCX: sv.apply_mcx(bit_mask(q, 2), q[2]); break;
+    case GateShape::Swap: sv.apply_swap(q[0], q[1]); break;
+    case GateShape::Phase: sv.apply_mcphase(bit_mask(q, q.size()), u[0]); break;
+    case GateShape::Dense2: sv.apply_gate_kq({std::min(q[0], q[1]), std::max(q[0], q[1])}, u); break;
+  }
+  return true;
+}
+
+// Same dispatch on a raw amplitude range (one cache block of an ExecPlan window)
+static void apply_step_local(c64* a, std::size_t n, const FusedOp& f) {
+  if (f.is_block()) {
+    kernels::apply_kq(a, n, f.qubits.data(), f.qubits.size(), f.matrix.data());
+    return;
+  }
+  if (f.layout_swap) {
+    kernels::apply_swap(a, n, f.qubits[0], f.qubits[1]);
+    return;
+  }
+  const Op& op = f.op;
+  GateShape shape;
+  c64 u[16];
+  if (!gate_shape(op, shape, u)) return;
+  const auto& q = op.qubits;
+  switch (shape) {
+    case GateShape::Dense: kernels::apply_1q(a, n, q[0], u); break;
+    case GateShape::Diag: kernels::apply_diag_1q(a, n, q[0], u[0], u[3]); break;
+    case GateShape::X: kernels::apply_x(a, n, q[0]); break;
+    case GateShape::CX: kernels::apply_cx(a, n, q[0], q[1]); break;
+    case GateShape::MCX: kernels::apply_mcx(a, n, bit_mask(q, 2), q[2]); break;
+    case GateShape::Swap: kernels::apply_swap(a, n, q[0], q[1]); break;
+    case GateShape::Phase: kernels::apply_mcphase(a, n, bit_mask(q, q.size()), u[0]); break;
+    case GateShape::Dense2: {
+      const std::size_t qs[2] = {std::min(q[0], q[1]), std::max(q[0], q[1])};
+      kernels::apply_kq(a, n, qs, 2, u);
+      break;
+    }
+  }
+}
+
+// Pauli drawn by the stochastic (trajectory) form of a noise op: 0 = none, 1 = X, 2 = Y, 3 = Z.
+// Consumes rng in circuit order; other ops (AMPDAMP is density backend only) draw nothing.
+static int sample_noise(const Op& op, Rng& rng) {
+  switch (op.type) {
+    case OpType::DEPHASE:
+      // Simple dephasing: with prob p apply Z, else I (angle stores the probability)
+      return rng.uniform() < op.angle ? 3 : 0;
+    case OpType::DEPOL: {
+      // Depolarizing: with prob p apply uniformly random X/Y/Z
+      if (rng.uniform() >= op.angle) return 0;
+      const double k = rng.uniform();
+      return k < 1.0/3.0 ? 1 : k < 2.0/3.0 ? 2 : 3;
+    }
+    default:
+      return 0;
+  }
+}
+
+static void apply_pauli(StateVector& sv, const Op& op, int pauli) {
+  switch (pauli) {
+    case 1: sv.apply_x(op.qubits[0]); break;
+    case 2: {
+      c64 u00,u01,u10,u11;
+      Y_coeffs(u00,u01,u10,u11);
+      sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
+      break;
+    }
+    case 3: sv.apply_diag_1q(op.qubits[0], c64{1,0}, c64{-1,0}); break;
+    default: break;
+  }
+}
+
+static void apply_noise(StateVector& sv, const Op& op, Rng& rng) {
+  apply_pauli(sv, op, sample_noise(op, rng));
+}
+
+void apply_step(c64* a, std::size_t n, const FusedOp& f, Rng& rng) {
+  GateShape shape;
+  c64 u[16];
+  if (f.is_block() || f.layout_swap || gate_shape(f.op, shape, u)) {
+    apply_step_local(a, n, f);
+    return;
+  }
+  const std::size_t q = f.op.qubits.empty() ? 0 : f.op.qubits[0];
+  switch (sample_noise(f.op, rng)) {
+    case 1: kernels::apply_x(a, n, q); break;
+    case 2: Y_coeffs(u[0],u[1],u[2],u[3]); kernels::apply_1q(a, n, q, u); break;
+    case 3: kernels::apply_diag_1q(a, n, q, c64{1,0}, c64{-1,0}); break;
+    default: break;
+  }
+}
+
+void apply_plan(StateVector& sv, const ExecPlan& plan, const std::function<void(const Op&)>& noise,
+                std::size_t begin, std::size_t end) {
+  end = std::min(end, plan.windows.size());
+  for (std::size_t wi=begin;wi<end;++wi) {
+    const auto& w = plan.windows[wi];
+    if (w.blocked) {
+      std::size_t gates = 0;
+      for (std::size_t i=w.begin;i<w.end;++i) gates += plan.steps[i].gates;
+      sv.apply_blocked(plan.profile.block_qubits, gates, [&](c64* a, std::size_t n){
+        for (std::size_t i=w.begin;i<w.end;++i) apply_step_local(a, n, plan.steps[i]);
+      });
+      continue;
+    }
+    for (std::size_t i=w.begin;i<w.end;++i) {
+      const auto& f = plan.steps[i];
+      if (f.is_block()) sv.apply_gate_kq(f.qubits, f.matrix.data());
+      else if (f.layout_swap) sv.apply_swap(f.qubits[0], f.qubits[1]);
+      else if (!apply_unitary(sv, f.op)) noise(f.op);
+    }
+  }
+}
+
+void apply_plan(StateVector& sv, const ExecPlan& plan, Rng& rng, std::size_t begin, std::size_t end) {
+  apply_plan(sv, plan, [&](const Op& op){ apply_noise(sv, op, rng); }, begin, end);
+}
+
+static std::uint64_t basis_index(const std::vector<int>& bits) {
+  std::uint64_t idx = 0;
+  for (std::size_t q=0;q<bits.size();++q) if (bits[q]) idx |= (std::uint64_t(1) << q);
+  return idx;
+}
+
+// Shots of a noisy circuit advanced together (see run_shots). Every shot keeps its own Rng
+// (seed + s), drawn exactly as in run(), so each outcome matches the per-shot simulation.
+class ShotTree {
+  const ExecPlan& plan_;
+  std::vector<Rng>& rngs_;        // per shot of the batch
+  std::uint64_t* out_;            // per shot basis index
+  std::vector<double>* probs_;    // receives the final distribution of shot 0 (if in the batch)
+  std::size_t copies_;            // branch states that may still be allocated
+  std::size_t leaves_ = 0;
+
+  void measure(StateVector& sv, const std::vector<std::size_t>& shots) {
+    ++leaves_;
+    for (auto s : shots) {
+      if (s == 0 && probs_) *probs_ = probabilities(sv.amplitudes());
+      out_[s] = basis_index(sv.measure_all(rngs_[s], false));
+    }
+  }
+
+  // Out of branch budget: finish one shot on its own from window w (after its Pauli)
+  void solo(const StateVector& sv, std::size_t w, const Op& op, int pauli, std::size_t s) {
+    StateVector one = sv;
+    apply_pauli(one, op, pauli);
+    apply_plan(one, plan_, [&](const Op& o){ apply_noise(one, o, rngs_[s]); }, w);
+    measure(one, {s});
+  }
+
+public:
+  ShotTree(const ExecPlan& plan, std::vector<Rng>& rngs, std::uint64_t* out, std::vector<double>* probs, std::size_t copies)
+    : plan_(plan), rngs_(rngs), out_(out), probs_(probs), copies_(copies) {}
+  std::size_t leaves() const { return leaves_; }
+
+  // sv is the state of every shot in `shots` before window w
+  void run(StateVector& sv, std::size_t w, std::vector<std::size_t> shots) {
+    const auto none = [](const Op&){};
+    for (;;) {
+      const std::size_t site = next_noise_window(plan_, w);
+      apply_plan(sv, plan_, none, w, site);
+      if (site == plan_.windows.size()) { measure(sv, shots); return; }
+      const Op& op = plan_.steps[plan_.windows[site].begin].op;
+      std::vector<std::size_t> by[4];
+      for (auto s : shots) by[sample_noise(op, rngs_[s])].push_back(s);
+      // The largest branch (usually "no error") continues in place; the others need a copy
+      int keep = 0;
+      for (int b=1;b<4;++b) if (by[b].size() > by[keep].size()) keep = b;
+      for (int b=0;b<4;++b) {
+        if (b == keep || by[b].empty()) continue;
+        if (copies_ == 0) {
+          for (auto s : by[b]) solo(sv, site + 1, op, b, s);
+          continue;
         }
-        break;
+        --copies_;
+        StateVector child = sv;
+        apply_pauli(child, op, b);
+        run(child, site + 1, std::move(by[b]));
+        ++copies_;
       }
-      case OpType::MEASURE:
-        // handled after loop
-        break;
+      apply_pauli(sv, op, keep);
+      shots = std::move(by[keep]);
+      w = site + 1;
     }
   }
+};
+
+// Shots per ShotTree: bounds the per-shot generator state (one Rng each)
+constexpr std::size_t kShotBatch = 4096;
+
+static RunResult run_prepared(const Circuit& c, const ExecPlan& plan, uint64_t seed, bool collapse) {
+  StateVector sv(c.nqubits);
+  Rng rng(seed);
+  apply_plan(sv, plan, rng);
   // Output probabilities
   RunResult rr;
-  rr.probabilities.resize(std::size_t(1) << c.nqubits);
-  for (std::size_t i=0;i<rr.probabilities.size();++i) rr.probabilities[i] = sv.probability_of_basis(i);
+  rr.profile = plan.profile;
+  rr.probabilities = probabilities(sv.amplitudes());
   // Measure
   rr.outcome = sv.measure_all(rng, collapse);
   return rr;
 }
 
-  StateVector sv(c.nqubits);
-  // Apply ops
+RunResult run(const Circuit& c, uint64_t seed, bool collapse, const RunOptions& opts) {
+  return run_prepared(c, plan_execution(c, opts), seed, collapse);
+}
+
+ExecProfile execute(StateVector& sv, const Circuit& c, Rng& rng, const RunOptions& opts) {
+  Circuit wide = c;
+  wide.nqubits = sv.num_qubits();
+  const ExecPlan plan = plan_execution(wide, opts);
+  apply_plan(sv, plan, rng);
+  return plan.profile;
+}
+
+bool is_sampling_deterministic(const Circuit& c) {
   for (const auto& op : c.ops) {
-    using namespace qsx::gates;
-    c64 u00,u01,u10,u11;
-    switch (op.type) {
-      case OpType::H:
-        H_coeffs(u00,u01,u10,u11);
-        sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        break;
-      case OpType::X:
-        X_coeffs(u00,u01,u10,u11);
-        sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        break;
-      case OpType::Z:
-        Z_coeffs(u00,u01,u10,u11); sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11); break;
-      case OpType::S:
-        S_coeffs(u00,u01,u10,u11); sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11); break;
-      case OpType::RX:
-        RX_coeffs(op.angle, u00,u01,u10,u11); sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11); break;
-      case OpType::RY:
-        RY_coeffs(op.angle, u00,u01,u10,u11); sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11); break;
-      case OpType::Z:
-        Z_coeffs(u00,u01,u10,u11);
-        sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        break;
-      case OpType::RZ:
-        RZ_coeffs(op.angle, u00,u01,u10,u11);
-        sv.apply_gate_1q(op.qubits[0], u00,u01,u10,u11);
-        break;
-      case OpType::CNOT:
-        sv.apply_cx(op.qubits[0], op.qubits[1]);
-        break;
-      case OpType::MEASURE:
-        // handled after loop
-        break;
+    if (op.type==OpType::DEPHASE || op.type==OpType::DEPOL || op.type==OpType::AMPDAMP) return false;
+  }
+  return true;
+}
+
+std::vector<int> basis_to_bits(std::uint64_t idx, std::size_t n) {
+  std::vector<int> bits(n, 0);
+  for (std::size_t q = 0; q < n; ++q) bits[q] = (idx >> q) & 1;
+  return bits;
+}
+
+ShotsResult run_shots(const Circuit& c, std::size_t shots, uint64_t seed, bool keep_outcomes, const RunOptions& opts) {
+  ShotsResult sr;
+  // Fusion and cache blocking are planned once and shared by every shot
+  const ExecPlan plan = plan_execution(c, opts);
+  sr.profile = plan.profile;
+  if (keep_outcomes) sr.outcomes.reserve(shots);
+  auto record = [&](std::uint64_t idx){
+    sr.histogram[idx] += 1;
+    if (keep_outcomes) sr.outcomes.push_back(idx);
+  };
+  if (!is_sampling_deterministic(c)) {
+    // Stochastic noise: every shot is its own trajectory, identical to calling run() per shot.
+    const std::size_t states = opts.branch_cache_bytes / ((std::size_t(1) << c.nqubits) * sizeof(c64));
+    if (states < 3) {
+      for (std::size_t s=0;s<shots;++s) {
+        auto r = run_prepared(c, plan, seed + s, false);
+        if (s==0) sr.probabilities = std::move(r.probabilities);
+        record(basis_index(r.outcome));
+      }
+      sr.trajectories = shots;
+      return sr;
+    }
+    // The noiseless prefix is simulated once; each batch of shots then branches from it. Three
+    // states are always live (prefix, batch state, one solo shot); the rest of the budget holds
+    // branch copies.
+    const std::size_t first = next_noise_window(plan);
+    StateVector prefix(c.nqubits);
+    apply_plan(prefix, plan, [](const Op&){}, 0, first);
+    std::vector<std::uint64_t> out(shots);
+    for (std::size_t s0=0;s0<shots;s0+=kShotBatch) {
+      const std::size_t nb = std::min(kShotBatch, shots - s0);
+      std::vector<Rng> rngs;
+      rngs.reserve(nb);
+      std::vector<std::size_t> batch(nb);
+      for (std::size_t i=0;i<nb;++i) { rngs.emplace_back(seed + s0 + i); batch[i] = i; }
+      ShotTree tree(plan, rngs, out.data() + s0, s0 == 0 ? &sr.probabilities : nullptr, states - 3);
+      StateVector sv = prefix;
+      tree.run(sv, first, std::move(batch));
+      sr.trajectories += tree.leaves();
     }
+    for (auto idx : out) record(idx);
+    return sr;
   }
-  // Output probabilities
-  RunResult rr;
-  rr.probabilities.resize(std::size_t(1) << c.nqubits);
-  for (std::size_t i=0;i<rr.probabilities.size();++i) rr.probabilities[i] = sv.probability_of_basis(i);
-  // Measure
+  // Terminal measurement only: simulate once, then draw every shot from the final distribution.
+  StateVector sv(c.nqubits);
   Rng rng(seed);
-  rr.outcome = sv.measure_all(rng, collapse);
-  return rr;
+  apply_plan(sv, plan, rng);
+  sr.probabilities = probabilities(sv.amplitudes());
+  sr.trajectories = 1;
+  for (auto idx : sample_indices(sr.probabilities, shots, rng)) record(idx);
+  return sr;
 }
 
 } // namespace qsx
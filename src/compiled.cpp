@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/compiled.hpp"
+#include "quantum/gates.hpp"
+#include "quantum/kernels.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+namespace qsx {
+
+// Batched states: at most this many per batch, and only up to kBatchedQubits qubits, where a full
+// batch still fits in L2 (larger single states are as fast with their own vectorised kernels)
+constexpr std::size_t kBatchLanes = 8;
+constexpr std::size_t kBatchedQubits = 13;
+
+CompiledCircuit compile_circuit(const Circuit& c, const RunOptions& opts){
+  CompiledCircuit cc;
+  cc.nqubits = c.nqubits;
+  cc.parameters = circuit_parameters(c);
+  cc.plan = plan_execution(c, opts);
+  auto index_of = [&](const Op& op){
+    if (op.param.empty()) return SIZE_MAX;
+    return std::size_t(std::find(cc.parameters.begin(), cc.parameters.end(), op.param) - cc.parameters.begin());
+  };
+  for (std::size_t i=0;i<cc.plan.steps.size();++i){
+    const FusedOp& f = cc.plan.steps[i];
+    ParamSlot slot;
+    slot.step = i;
+    if (f.is_block()) slot.ops = f.members;
+    else if (!f.layout_swap && !f.op.param.empty()) slot.ops = {f.op};
+    if (slot.ops.empty()) continue;
+    for (const auto& op : slot.ops) slot.index.push_back(index_of(op));
+    cc.slots.push_back(std::move(slot));
+  }
+  return cc;
+}
+
+std::size_t bind_parameters(CompiledCircuit& cc, const std::vector<double>& values){
+  if (values.size() != cc.parameters.size())
+    throw std::invalid_argument("Expected " + std::to_string(cc.parameters.size()) + " parameter values");
+  const bool first = cc.values.empty() && !values.empty();
+  std::size_t rebuilt = 0;
+  std::vector<Op> bound;
+  for (const auto& slot : cc.slots){
+    bool changed = first;
+    for (auto k : slot.index) changed = changed || (k != SIZE_MAX && values[k] != cc.values[k]);
+    if (!changed) continue;
+    bound = slot.ops;
+    for (std::size_t j=0;j<bound.size();++j){
+      if (slot.index[j] == SIZE_MAX) continue;
+      bound[j].angle += bound[j].param_scale * values[slot.index[j]];
+      bound[j].param.clear();
+    }
+    FusedOp& f = cc.plan.steps[slot.step];
+    if (f.is_block()) f.matrix = block_matrix(bound, f.qubits);
+    else f.op = bound[0];
+    ++rebuilt;
+  }
+  cc.values = values;
+  return rebuilt;
+}
+
+ExecProfile execute(StateVector& sv, const CompiledCircuit& cc, Rng& rng, std::size_t begin, std::size_t end){
+  apply_plan(sv, cc.plan, rng, begin, end);
+  return cc.plan.profile;
+}
+
+std::size_t parameter_window(const CompiledCircuit& cc, std::size_t k){
+  std::size_t step = SIZE_MAX;
+  for (const auto& slot : cc.slots)
+    if (std::find(slot.index.begin(), slot.index.end(), k) != slot.index.end()) step = std::min(step, slot.step);
+  const auto& windows = cc.plan.windows;
+  for (std::size_t w=0;w<windows.size();++w) if (step < windows[w].end) return w;
+  return windows.size();
+}
+
+std::size_t batch_width(std::size_t nqubits, std::size_t count){
+  if (count < 2 || nqubits > kBatchedQubits) return 1;
+  return std::min(kBatchLanes, std::bit_ceil(count));
+}
+
+namespace {
+
+// The plan with every qubit index raised by lane_bits: its steps act on all states of a batch
+ExecPlan shared_plan(const ExecPlan& plan, std::size_t lane_bits){
+  ExecPlan out = plan;
+  for (auto& f : out.steps){
+    for (auto& q : f.qubits) q += lane_bits;
+    for (auto& q : f.op.qubits) q += lane_bits;
+    f.members.clear();
+  }
+  return out;
+}
+
+// 2x2 matrix of a lone rotation (named parameters only appear on RX/RY/RZ)
+void rotation_matrix(OpType type, double angle, c64* u){
+  using namespace qsx::gates;
+  if (type == OpType::RX) RX_coeffs(angle, u[0], u[1], u[2], u[3]);
+  else if (type == OpType::RY) RY_coeffs(angle, u[0], u[1], u[2], u[3]);
+  else RZ_coeffs(angle, u[0], u[1], u[2], u[3]);
+}
+
+// Per-state matrices of the parameter steps (B matrices one after another), indexed by plan step;
+// empty for steps shared by the batch. m keeps its buffers between calls.
+void lane_matrices(const CompiledCircuit& cc, const std::vector<std::vector<double>>& values, std::size_t batch,
+                   std::vector<std::vector<c64>>& m){
+  if (values.empty()) throw std::invalid_argument("Expected at least one binding");
+  for (const auto& v : values)
+    if (v.size() != cc.parameters.size())
+      throw std::invalid_argument("Expected " + std::to_string(cc.parameters.size()) + " parameter values");
+  m.resize(cc.plan.steps.size());
+  std::vector<Op> bound;
+  for (const auto& slot : cc.slots){
+    const FusedOp& f = cc.plan.steps[slot.step];
+    auto& out = m[slot.step];
+    out.clear();
+    for (std::size_t b=0;b<batch;++b){
+      const auto& v = values[std::min(b, values.size() - 1)];
+      if (!f.is_block()){
+        const Op& op = slot.ops[0];
+        c64 u[4];
+        rotation_matrix(op.type, op.angle + op.param_scale * v[slot.index[0]], u);
+        out.insert(out.end(), u, u + 4);
+        continue;
+      }
+      bound = slot.ops;
+      for (std::size_t j=0;j<bound.size();++j){
+        if (slot.index[j] == SIZE_MAX) continue;
+        bound[j].angle += bound[j].param_scale * v[slot.index[j]];
+        bound[j].param.clear();
+      }
+      const auto u = block_matrix(bound, f.qubits);
+      out.insert(out.end(), u.begin(), u.end());
+    }
+  }
+}
+
+void run_batched(BatchedStateVector& bsv, const ExecPlan& plan, const ExecPlan& shared,
+                 const std::vector<std::vector<c64>>& lanes, Rng& rng, std::size_t begin, std::size_t end){
+  const std::size_t s = bsv.lane_bits(), n = bsv.num_qubits();
+  c64* a = bsv.amplitudes_mut().data();
+  // step i on p, a run of 2^nloc amplitudes of every state
+  auto step = [&](c64* p, std::size_t nloc, std::size_t i){
+    if (lanes[i].empty()) { apply_step(p, nloc + s, shared.steps[i], rng); return; }
+    const FusedOp& f = plan.steps[i];
+    const auto& q = f.is_block() ? f.qubits : f.op.qubits;
+    kernels::apply_kq_lanes(p, nloc, s, q.data(), q.size(), lanes[i].data());
+  };
+  end = std::min(end, plan.windows.size());
+  for (std::size_t wi=begin;wi<end;++wi){
+    const auto& w = plan.windows[wi];
+    std::size_t gates = 0;
+    for (std::size_t i=w.begin;i<w.end;++i) gates += plan.steps[i].gates;
+    if (w.blocked){
+      // Noise is never blocked, so rng is not touched here
+      const std::size_t b = std::min(plan.profile.block_qubits, n);
+      const std::ptrdiff_t chunks = std::ptrdiff_t(std::size_t(1) << (n - b));
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+      for (std::ptrdiff_t ch = 0; ch < chunks; ++ch)
+        for (std::size_t i=w.begin;i<w.end;++i) step(a + (std::size_t(ch) << (b + s)), b, i);
+    } else {
+      for (std::size_t i=w.begin;i<w.end;++i) step(a, n, i);
+    }
+    bsv.count_gates(gates);
+  }
+}
+
+} // namespace
+
+void execute(BatchedStateVector& bsv, const CompiledCircuit& cc, const std::vector<std::vector<double>>& values,
+             Rng& rng, std::size_t begin, std::size_t end){
+  std::vector<std::vector<c64>> lanes;
+  lane_matrices(cc, values, bsv.batch(), lanes);
+  run_batched(bsv, cc.plan, shared_plan(cc.plan, bsv.lane_bits()), lanes, rng, begin, end);
+}
+
+void evaluate_batch(const CompiledCircuit& cc, const std::vector<std::vector<double>>& bindings, uint64_t seed,
+                    const std::function<void(std::size_t, const StateVector&)>& visit){
+  const std::size_t nb = bindings.size();
+  // Checked up front: nothing may throw inside the parallel region
+  for (const auto& v : bindings)
+    if (v.size() != cc.parameters.size())
+      throw std::invalid_argument("Expected " + std::to_string(cc.parameters.size()) + " parameter values");
+  const std::size_t width = batch_width(cc.nqubits, nb);
+  if (width > 1){
+    const std::size_t groups = (nb + width - 1) / width;
+    const bool parallel = cc.nqubits <= kParallelStatesQubits && groups > 1;
+    (void)parallel;
+    const BatchedStateVector zero(cc.nqubits, width);
+    const ExecPlan shared = shared_plan(cc.plan, zero.lane_bits());
+#ifdef QSX_OPENMP
+#pragma omp parallel if(parallel)
+#endif
+    {
+      BatchedStateVector bsv(cc.nqubits, width);
+      StateVector sv(cc.nqubits);
+      std::vector<std::vector<c64>> lanes;
+#ifdef QSX_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (std::ptrdiff_t g = 0; g < (std::ptrdiff_t)groups; ++g){
+        const std::size_t first = std::size_t(g) * width, count = std::min(width, nb - first);
+        const std::vector<std::vector<double>> values(bindings.begin() + std::ptrdiff_t(first),
+                                                      bindings.begin() + std::ptrdiff_t(first + count));
+        lane_matrices(cc, values, width, lanes);
+        bsv = zero;
+        Rng rng(seed);
+        run_batched(bsv, cc.plan, shared, lanes, rng, 0, SIZE_MAX);
+        for (std::size_t j=0;j<count;++j){
+          bsv.extract(j, sv);
+          visit(first + j, sv);
+        }
+      }
+    }
+    return;
+  }
+  const bool parallel = cc.nqubits <= kParallelStatesQubits && nb > 1;
+  (void)parallel;
+  const StateVector zero(cc.nqubits);
+#ifdef QSX_OPENMP
+#pragma omp parallel if(parallel)
+#endif
+  {
+    CompiledCircuit local = cc;
+    StateVector sv(cc.nqubits);
+#ifdef QSX_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (std::ptrdiff_t b = 0; b < (std::ptrdiff_t)nb; ++b){
+      bind_parameters(local, bindings[b]);
+      sv = zero; // reuses the buffer and restarts the renormalisation count, as a fresh state would
+      Rng rng(seed);
+      execute(sv, local, rng);
+      visit(std::size_t(b), sv);
+    }
+  }
+}
+
+std::vector<double> expectation_batch(const CompiledCircuit& cc, const Hamiltonian& h,
+                                      const std::vector<std::vector<double>>& bindings, uint64_t seed){
+  std::vector<double> out(bindings.size(), 0.0);
+  evaluate_batch(cc, bindings, seed, [&](std::size_t b, const StateVector& sv){ out[b] = expectation(sv.amplitudes(), h); });
+  return out;
+}
+
+} // namespace qsx
@@ -3,201 +3,467 @@
 #include "quantum/density_matrix.hpp"
 #include "quantum/circuit.hpp"
 #include "quantum/gates.hpp"
+#include "quantum/kernels.hpp"
+#include "quantum/fusion.hpp"
+#include "quantum/reduce.hpp"
 #include <cassert>
 #include <cmath>
 #include <algorithm>
+#include <numbers>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
 
 namespace qsx {
 
 static inline std::size_t idx(std::size_t row, std::size_t col, std::size_t dim){ return row*dim + col; }
 
-DensityMatrix::DensityMatrix(std::size_t n) : n_(n), rho_( (std::size_t(1)<<n)*(std::size_t(1)<<n), {0.0,0.0} ){
-  // |0..0><0..0|
+namespace {
+
+// Element access for the two layouts. Kernels load every element of a block before storing
+// any, so on packed diagonal blocks an entry and its mirror are written with the same value.
+// T = const c64 gives read-only views (get only) over const storage.
+template <class T>
+struct FullView {
+  static constexpr bool packed = false;
+  T* p; std::size_t d;
+  c64 get(std::size_t r, std::size_t c) const { return p[r*d + c]; }
+  void set(std::size_t r, std::size_t c, const c64 v) const { p[r*d + c] = v; }
+};
+
+template <class T>
+struct PackedView {
+  static constexpr bool packed = true;
+  T* p; std::size_t d;
+  // Row r starts after r rows of lengths d, d-1, ...
+  std::size_t pos(std::size_t r, std::size_t c) const { return (r*(2*d - r + 1))/2 + (c - r); }
+  c64 get(std::size_t r, std::size_t c) const { return r <= c ? p[pos(r, c)] : std::conj(p[pos(c, r)]); }
+  void set(std::size_t r, std::size_t c, const c64 v) const { if (r <= c) p[pos(r, c)] = v; else p[pos(c, r)] = std::conj(v); }
+};
+
+} // namespace
+
+std::size_t DensityMatrix::storage_size(std::size_t n, DensityStorage storage){
+  const std::size_t d = std::size_t(1) << n;
+  return storage == DensityStorage::Packed ? d*(d + 1)/2 : d*d;
+}
+
+DensityMatrix::DensityMatrix(std::size_t n, DensityStorage storage)
+  : n_(n), storage_(storage), rho_(storage_size(n, storage), {0.0,0.0}) {
+  // |0..0><0..0| (entry (0,0) comes first in both layouts)
   rho_[0] = {1.0,0.0};
 }
 
-void DensityMatrix::renormalize_(){
+template <class F>
+void DensityMatrix::visit(F&& f){
+  if (storage_ == DensityStorage::Packed) f(PackedView<c64>{rho_.data(), dim()});
+  else f(FullView<c64>{rho_.data(), dim()});
+}
+
+c64 DensityMatrix::at(std::size_t r, std::size_t c) const {
+  const std::size_t d = dim();
+  const c64* p = rho_.data();
+  return storage_ == DensityStorage::Packed ? PackedView<const c64>{p, d}.get(r, c) : FullView<const c64>{p, d}.get(r, c);
+}
+
+std::vector<double> DensityMatrix::diagonal() const {
+  std::vector<double> diag(dim());
+  for (std::size_t i=0;i<diag.size();++i) diag[i] = std::real(at(i, i));
+  return diag;
+}
+
+void DensityMatrix::renormalize(){
   // Ensure trace=1 (robustness)
   std::size_t d = dim();
   double tr=0.0;
-  for (std::size_t i=0;i<d;i++) tr += std::real(rho_[idx(i,i,d)]);
+  for (std::size_t i=0;i<d;i++) tr += std::real(at(i, i));
   if (tr==0.0) return;
-  double inv = 1.0/tr;
-  for (auto& z : rho_) z *= inv;
+  scale_amplitudes(rho_.data(), rho_.size(), 1.0/tr);
 }
 
-void DensityMatrix::apply_unitary_1q(std::size_t target, const c64 u00, const c64 u01, const c64 u10, const c64 u11){
-  const std::size_t d = dim();
+// Visit every (row pair, column pair) quadruple of `target` in place: f(r0, r1, c0, c1) with the
+// target bit clear in r0 and c0. Packed storage only visits column pairs from the row pair on;
+// the blocks below are the conjugate transposes of those. Row pairs are independent, so they
+// are split across threads (round-robin, as packed rows shrink).
+template <bool Packed, class F>
+static inline void for_each_quad(std::size_t n, std::size_t target, F&& f){
+  const std::size_t half = (std::size_t(1) << n) >> 1;
   const std::size_t m = std::size_t(1) << target;
-  // Apply U on rows and U* on cols: rho' = U rho U^\dagger
-  // Row transform
-  std::vector<c64> tmp(rho_.size());
-  for (std::size_t r=0;r<d;++r){
-    std::size_t r0 = (r & ~m);
-    std::size_t r1 = r0 | m;
-    // which pair? compute base rows
-    if ((r & m)==0){
-      for (std::size_t c=0;c<d;++c){
-        tmp[idx(r,c,d)] = u00*rho_[idx(r,c,d)] + u01*rho_[idx(r1,c,d)];
-      }
-    } else {
-      for (std::size_t c=0;c<d;++c){
-        tmp[idx(r,c,d)] = u10*rho_[idx(r0,c,d)] + u11*rho_[idx(r,c,d)];
-      }
-    }
-  }
-  // Column transform by U^\dagger
-  std::vector<c64> out(rho_.size());
-  auto u00c = std::conj(u00), u01c = std::conj(u01), u10c = std::conj(u10), u11c = std::conj(u11);
-  for (std::size_t c=0;c<d;++c){
-    std::size_t c0 = (c & ~m);
-    std::size_t c1 = c0 | m;
-    if ((c & m)==0){
-      for (std::size_t r=0;r<d;++r){
-        out[idx(r,c,d)] = tmp[idx(r,c,d)]*u00c + tmp[idx(r,c1,d)]*u10c;
-      }
-    } else {
-      for (std::size_t r=0;r<d;++r){
-        out[idx(r,c,d)] = tmp[idx(r,c0,d)]*u01c + tmp[idx(r,c,d)]*u11c;
-      }
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+  for (std::ptrdiff_t rp=0; rp<(std::ptrdiff_t)half; ++rp){
+    const std::size_t r0 = kernels::insert_zero_bit(std::size_t(rp), target);
+    for (std::size_t cp = Packed ? std::size_t(rp) : 0; cp<half; ++cp){
+      const std::size_t c0 = kernels::insert_zero_bit(cp, target);
+      f(r0, r0 | m, c0, c0 | m);
     }
   }
-  rho_.swap(out);
-  renormalize_();
+}
+
+void DensityMatrix::apply_unitary_1q(std::size_t target, const c64 u00, const c64 u01, const c64 u10, const c64 u11){
+  // rho' = U rho U^\dagger on each 2x2 block [[a, b], [c, d]] of the target bits: T = U B, B' = T U^\dagger
+  const c64 v00 = std::conj(u00), v01 = std::conj(u01), v10 = std::conj(u10), v11 = std::conj(u11);
+  visit([&](auto L){
+    for_each_quad<decltype(L)::packed>(n_, target, [=](std::size_t r0, std::size_t r1, std::size_t c0, std::size_t c1){
+      const c64 a = L.get(r0,c0), b = L.get(r0,c1), c = L.get(r1,c0), e = L.get(r1,c1);
+      const c64 t00 = u00*a + u01*c, t01 = u00*b + u01*e;
+      const c64 t10 = u10*a + u11*c, t11 = u10*b + u11*e;
+      L.set(r0,c0, t00*v00 + t01*v01);
+      L.set(r0,c1, t00*v10 + t01*v11);
+      L.set(r1,c0, t10*v00 + t11*v01);
+      L.set(r1,c1, t10*v10 + t11*v11);
+    });
+  });
 }
 
 void DensityMatrix::apply_cx(std::size_t control, std::size_t target){
-  // As unitary with permutation effect on basis states
-  const std::size_t d = dim();
-  const std::size_t cm = std::size_t(1) << control;
-  const std::size_t tm = std::size_t(1) << target;
-  std::vector<c64> out(rho_.size(), {0.0,0.0});
-  for (std::size_t r=0;r<d;++r){
-    std::size_t r2 = ( (r & cm) ? (r ^ tm) : r );
-    for (std::size_t c=0;c<d;++c){
-      std::size_t c2 = ( (c & cm) ? (c ^ tm) : c );
-      out[idx(r2,c2,d)] = rho_[idx(r,c,d)];
-    }
+  if (storage_ == DensityStorage::Packed){
+    const c64 x[4] = {{0,0}, {1,0}, {1,0}, {0,0}};
+    apply_controlled_kq({target}, std::size_t(1) << control, x);
+    return;
   }
-  rho_.swap(out);
+  // Permutation P rho P: swap rows, then columns (see apply_controlled_kq for the bit layout)
+  kernels::apply_cx(rho_.data(), 2*n_, control + n_, target + n_);
+  kernels::apply_cx(rho_.data(), 2*n_, control, target);
+}
+
+void DensityMatrix::apply_diag_1q(std::size_t target, const c64 d0, const c64 d1){
+  // rho[r][c] *= d_r conj(d_c). The phases cancel on the two diagonal blocks (|d0|=|d1|=1),
+  // so only the off-diagonal blocks are touched, with one multiply per element.
+  const c64 f01 = d0*std::conj(d1), f10 = d1*std::conj(d0);
+  visit([&](auto L){
+    for_each_quad<decltype(L)::packed>(n_, target, [=](std::size_t r0, std::size_t r1, std::size_t c0, std::size_t c1){
+      const c64 b = L.get(r0,c1), c = L.get(r1,c0);
+      L.set(r0,c1, b*f01);
+      L.set(r1,c0, c*f10);
+    });
+  });
+}
+
+void DensityMatrix::apply_x(std::size_t target){
+  // X rho X: swap (r,c) with (r^m, c^m) inside every block
+  visit([&](auto L){
+    for_each_quad<decltype(L)::packed>(n_, target, [=](std::size_t r0, std::size_t r1, std::size_t c0, std::size_t c1){
+      const c64 a = L.get(r0,c0), b = L.get(r0,c1), c = L.get(r1,c0), e = L.get(r1,c1);
+      L.set(r0,c0, e); L.set(r1,c1, a);
+      L.set(r0,c1, c); L.set(r1,c0, b);
+    });
+  });
 }
 
 void DensityMatrix::dephase(std::size_t target, double p){
-  // Kraus: sqrt(1-p) I, sqrt(p) Z
-  using namespace qsx::gates;
-  c64 u00,u01,u10,u11;
-  Z_coeffs(u00,u01,u10,u11);
-  // E[rho] = (1-p) rho + p Z rho Z
-  std::vector<c64> tmp = rho_;
-  // Z rho Z: flip phase on |1> rows and cols
-  const std::size_t d = dim();
-  const std::size_t m = std::size_t(1) << target;
-  for (std::size_t r=0;r<d;++r){
-    bool rz = (r & m);
-    for (std::size_t c=0;c<d;++c){
-      bool cz = (c & m);
-      c64 val = rho_[idx(r,c,d)];
-      if (rz ^ cz) val = -val;
-      tmp[idx(r,c,d)] = val;
-    }
-  }
-  for (std::size_t i=0;i<rho_.size();++i){
-    rho_[i] = (1.0 - p)*rho_[i] + p*tmp[i];
-  }
-  renormalize_();
+  // Kraus: sqrt(1-p) I, sqrt(p) Z. E[rho] = (1-p) rho + p Z rho Z keeps the diagonal blocks and
+  // scales the off-diagonal ones by 1 - 2p.
+  using real = c64::value_type;
+  const real f = real(1.0 - 2.0*p);
+  visit([&](auto L){
+    for_each_quad<decltype(L)::packed>(n_, target, [=](std::size_t r0, std::size_t r1, std::size_t c0, std::size_t c1){
+      const c64 b = L.get(r0,c1), c = L.get(r1,c0);
+      L.set(r0,c1, b*f);
+      L.set(r1,c0, c*f);
+    });
+  });
 }
 
 void DensityMatrix::depolarize(std::size_t target, double p){
-  // E[rho] = (1-p)rho + p/3 (X rho X + Y rho Y + Z rho Z)
-  std::vector<c64> acc(rho_.size(), {0.0,0.0});
-  auto apply_pauli = [&](int which){
-    std::vector<c64> out(rho_.size(), {0.0,0.0});
-    const std::size_t d = dim();
-    const std::size_t m = std::size_t(1) << target;
-    if (which==0){ // X flips target bit on rows/cols
-      for (std::size_t r=0;r<d;++r){
-        std::size_t r2 = r ^ m;
-        for (std::size_t c=0;c<d;++c){
-          std::size_t c2 = c ^ m;
-          out[idx(r2,c2,d)] = rho_[idx(r,c,d)];
+  // E[rho] = (1-p)rho + p/3 (X rho X + Y rho Y + Z rho Z). On a block [[a, b], [c, e]] the Pauli
+  // sum is [[a + 2e, -b], [-c, 2a + e]], so the populations mix and the coherences shrink.
+  using real = c64::value_type;
+  const real keep = real(1.0 - 2.0*p/3.0), move = real(2.0*p/3.0), coh = real(1.0 - 4.0*p/3.0);
+  visit([&](auto L){
+    for_each_quad<decltype(L)::packed>(n_, target, [=](std::size_t r0, std::size_t r1, std::size_t c0, std::size_t c1){
+      const c64 a = L.get(r0,c0), b = L.get(r0,c1), c = L.get(r1,c0), e = L.get(r1,c1);
+      L.set(r0,c0, keep*a + move*e);
+      L.set(r1,c1, move*a + keep*e);
+      L.set(r0,c1, b*coh);
+      L.set(r1,c0, c*coh);
+    });
+  });
+}
+
+void DensityMatrix::amp_damp(std::size_t target, double gamma){
+  apply_channel(amplitude_damping(gamma), {target});
+}
+
+void DensityMatrix::apply_channel(const Channel& ch, const std::vector<std::size_t>& qubits){
+  assert(qubits.size() == ch.nqubits);
+  const std::size_t d = dim();
+  const c64* S = ch.superop.data();
+  if (ch.nqubits == 1){
+    visit([&](auto L){
+      for_each_quad<decltype(L)::packed>(n_, qubits[0], [=](std::size_t r0, std::size_t r1, std::size_t c0, std::size_t c1){
+        const c64 v[4] = {L.get(r0,c0), L.get(r0,c1), L.get(r1,c0), L.get(r1,c1)};
+        c64 w[4];
+        for (std::size_t l=0;l<4;++l) w[l] = S[l*4]*v[0] + S[l*4+1]*v[1] + S[l*4+2]*v[2] + S[l*4+3]*v[3];
+        L.set(r0,c0, w[0]); L.set(r0,c1, w[1]); L.set(r1,c0, w[2]); L.set(r1,c1, w[3]);
+      });
+    });
+    return;
+  }
+  // Two qubits: 4 rows x 4 columns per group, gathered, transformed by the 16x16 superoperator
+  // and written back in place. Row groups are independent.
+  const std::size_t q0 = qubits[0], q1 = qubits[1];
+  const std::size_t lo = std::min(q0, q1), hi = std::max(q0, q1);
+  const std::size_t offs[4] = {0, std::size_t(1) << q0, std::size_t(1) << q1, (std::size_t(1) << q0) | (std::size_t(1) << q1)};
+  const std::size_t quarter = d >> 2;
+  visit([&](auto L){
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+    for (std::ptrdiff_t rg=0; rg<(std::ptrdiff_t)quarter; ++rg){
+      const std::size_t rb = kernels::insert_zero_bit(kernels::insert_zero_bit(std::size_t(rg), lo), hi);
+      for (std::size_t cg = decltype(L)::packed ? std::size_t(rg) : 0; cg<quarter; ++cg){
+        const std::size_t cb = kernels::insert_zero_bit(kernels::insert_zero_bit(cg, lo), hi);
+        c64 v[16], w[16];
+        for (std::size_t l=0;l<16;++l) v[l] = L.get(rb + offs[l >> 2], cb + offs[l & 3]);
+        for (std::size_t l=0;l<16;++l){
+          c64 acc{0, 0};
+          for (std::size_t lp=0;lp<16;++lp) acc += S[l*16 + lp]*v[lp];
+          w[l] = acc;
         }
+        for (std::size_t l=0;l<16;++l) L.set(rb + offs[l >> 2], cb + offs[l & 3], w[l]);
       }
-    } else if (which==1){ // Y: like X with i/-i phases
-      for (std::size_t r=0;r<d;++r){
-        std::size_t r2 = r ^ m;
-        bool rb = r & m;
-        for (std::size_t c=0;c<d;++c){
-          std::size_t c2 = c ^ m;
-          bool cb = c & m;
-          c64 v = rho_[idx(r,c,d)];
-          if (rb) v *= c64{-1,0};
-          else v *= c64{0,1};
-          if (cb) v *= c64{0,1};
-          else v *= c64{-1,0};
-          out[idx(r2,c2,d)] = v;
-        }
+    }
+  });
+}
+
+// Packed storage: U rho U^dagger for a dense 2^k x 2^k U on `qubits` (local bit j = qubits[j]).
+// Every (row group, column group) block on or above the diagonal is gathered, multiplied on
+// both sides and scattered back.
+void DensityMatrix::apply_dense_packed(const std::vector<std::size_t>& qubits, const c64* u){
+  const std::size_t k = qubits.size(), K = std::size_t(1) << k;
+  std::vector<std::size_t> sorted(qubits), offs(K, 0);
+  std::sort(sorted.begin(), sorted.end());
+  for (std::size_t l=0;l<K;++l)
+    for (std::size_t j=0;j<k;++j) if ((l >> j) & 1) offs[l] |= std::size_t(1) << qubits[j];
+  const std::size_t groups = dim() >> k;
+  const PackedView<c64> L{rho_.data(), dim()};
+  auto base = [&](std::size_t g){ for (auto q : sorted) g = kernels::insert_zero_bit(g, q); return g; };
+#ifdef QSX_OPENMP
+#pragma omp parallel
+#endif
+  {
+  std::vector<c64> b(K*K), t(K*K); // per thread
+#ifdef QSX_OPENMP
+#pragma omp for schedule(static, 1)
+#endif
+  for (std::ptrdiff_t rg=0; rg<(std::ptrdiff_t)groups; ++rg){
+    const std::size_t rb = base(std::size_t(rg));
+    for (std::size_t cg=std::size_t(rg); cg<groups; ++cg){
+      const std::size_t cb = base(cg);
+      for (std::size_t i=0;i<K;++i) for (std::size_t j=0;j<K;++j) b[i*K + j] = L.get(rb + offs[i], cb + offs[j]);
+      // T = U B, B' = T U^dagger
+      for (std::size_t i=0;i<K;++i) for (std::size_t j=0;j<K;++j){
+        c64 acc{0, 0};
+        for (std::size_t l=0;l<K;++l) acc += u[i*K + l]*b[l*K + j];
+        t[i*K + j] = acc;
       }
-    } else { // Z: sign on |1> rows/cols
-      const std::size_t d2 = d;
-      for (std::size_t r=0;r<d2;++r){
-        bool rb = r & m;
-        for (std::size_t c=0;c<d2;++c){
-          bool cb = c & m;
-          c64 v = rho_[idx(r,c,d2)];
-          if (rb ^ cb) v = -v;
-          out[idx(r,c,d2)] = v;
-        }
+      for (std::size_t i=0;i<K;++i) for (std::size_t j=0;j<K;++j){
+        c64 acc{0, 0};
+        for (std::size_t l=0;l<K;++l) acc += t[i*K + l]*std::conj(u[j*K + l]);
+        L.set(rb + offs[i], cb + offs[j], acc);
       }
     }
-    for (std::size_t i=0;i<acc.size();++i) acc[i] += out[i];
-  };
-  apply_pauli(0); apply_pauli(1); apply_pauli(2);
-  for (std::size_t i=0;i<rho_.size();++i){
-    rho_[i] = (1.0 - p)*rho_[i] + (p/3.0)*acc[i];
   }
-  renormalize_();
+  }
 }
 
-DMRunResult run_density(const Circuit& c, uint64_t seed, bool collapse){
-  (void)collapse; // density matrix keeps mixed states; collapse not applied
-  DensityMatrix dm(c.nqubits);
+// rho (row-major) is a vector over 2n bits with the row index in the high n bits, so
+// U rho U^dagger is U on qubits q + n followed by conj(U) on qubits q.
+void DensityMatrix::apply_controlled_kq(const std::vector<std::size_t>& qubits, std::size_t control_mask, const c64* m){
+  const std::size_t k = qubits.size(), cells = std::size_t(1) << (2*k);
+  if (storage_ == DensityStorage::Packed){
+    // Controls become high local bits of one dense block: m where they are all set, else identity
+    std::vector<std::size_t> qs(qubits);
+    for (std::size_t q=0;q<n_;++q) if ((control_mask >> q) & 1) qs.push_back(q);
+    const std::size_t K = std::size_t(1) << qs.size(), Kt = std::size_t(1) << k, hi = K - Kt;
+    std::vector<c64> u(K*K, c64{0, 0});
+    for (std::size_t i=0;i<K;++i) u[i*K + i] = c64{1, 0};
+    for (std::size_t i=0;i<Kt;++i)
+      for (std::size_t j=0;j<Kt;++j) u[(hi | i)*K + (hi | j)] = m[i*Kt + j];
+    apply_dense_packed(qs, u.data());
+    return;
+  }
+  std::vector<std::size_t> rows(qubits);
+  for (auto& q : rows) q += n_;
+  kernels::apply_controlled_kq(rho_.data(), 2*n_, rows.data(), k, control_mask << n_, m);
+  std::vector<c64> mc(m, m + cells);
+  for (auto& z : mc) z = std::conj(z);
+  kernels::apply_controlled_kq(rho_.data(), 2*n_, qubits.data(), k, control_mask, mc.data());
+}
+
+void DensityMatrix::apply_mcx(std::size_t control_mask, std::size_t target){
+  if (storage_ == DensityStorage::Packed){
+    const c64 x[4] = {{0,0}, {1,0}, {1,0}, {0,0}};
+    apply_controlled_kq({target}, control_mask, x);
+    return;
+  }
+  kernels::apply_mcx(rho_.data(), 2*n_, control_mask << n_, target + n_);
+  kernels::apply_mcx(rho_.data(), 2*n_, control_mask, target);
+}
+
+void DensityMatrix::apply_mcphase(std::size_t mask, const c64 phase){
+  if (storage_ == DensityStorage::Packed){
+    std::size_t t = 0;
+    while (!((mask >> t) & 1)) ++t;
+    const c64 ph[4] = {{1,0}, {0,0}, {0,0}, phase};
+    apply_controlled_kq({t}, mask & ~(std::size_t(1) << t), ph);
+    return;
+  }
+  kernels::apply_mcphase(rho_.data(), 2*n_, mask << n_, phase);
+  kernels::apply_mcphase(rho_.data(), 2*n_, mask, std::conj(phase));
+}
+
+void DensityMatrix::apply_swap(std::size_t q0, std::size_t q1){
+  if (storage_ == DensityStorage::Packed){
+    const c64 sw[16] = {{1,0},{0,0},{0,0},{0,0}, {0,0},{0,0},{1,0},{0,0}, {0,0},{1,0},{0,0},{0,0}, {0,0},{0,0},{0,0},{1,0}};
+    apply_dense_packed({q0, q1}, sw);
+    return;
+  }
+  kernels::apply_swap(rho_.data(), 2*n_, q0 + n_, q1 + n_);
+  kernels::apply_swap(rho_.data(), 2*n_, q0, q1);
+}
+
+// Probabilities = diag(rho); one outcome is sampled deterministically from the seed
+static DMRunResult sample_diagonal(std::vector<double> diag, std::size_t n, uint64_t seed){
+  DMRunResult rr;
+  rr.probabilities = std::move(diag);
+  const std::size_t d = rr.probabilities.size();
+  Rng rng(seed);
+  double r = rng.uniform();
+  double acc=0.0; std::size_t idxv=0;
+  for (std::size_t i=0;i<d;++i){ acc += rr.probabilities[i]; if (r<=acc){ idxv=i; break; } }
+  rr.outcome.resize(n);
+  for (std::size_t q=0;q<n;++q) rr.outcome[q] = (idxv>>q)&1;
+  return rr;
+}
+
+void DensityMatrix::apply_op(const Op& op){
   using namespace qsx::gates;
   c64 u00,u01,u10,u11;
+  switch(op.type){
+    case OpType::H: H_coeffs(u00,u01,u10,u11); apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
+    case OpType::X: apply_x(op.qubits[0]); break;
+    case OpType::Y: Y_coeffs(u00,u01,u10,u11); apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
+    case OpType::Z: apply_diag_1q(op.qubits[0], c64{1,0}, c64{-1,0}); break;
+    case OpType::S: apply_diag_1q(op.qubits[0], c64{1,0}, c64{0,1}); break;
+    case OpType::RX: RX_coeffs(op.angle,u00,u01,u10,u11); apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
+    case OpType::RY: RY_coeffs(op.angle,u00,u01,u10,u11); apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
+    case OpType::RZ: RZ_coeffs(op.angle,u00,u01,u10,u11); apply_diag_1q(op.qubits[0],u00,u11); break;
+    case OpType::U3: U3_coeffs(op.params[0],op.params[1],op.params[2],u00,u01,u10,u11); apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
+    case OpType::CNOT: apply_cx(op.qubits[0], op.qubits[1]); break;
+    case OpType::CCX: apply_mcx((std::size_t(1)<<op.qubits[0]) | (std::size_t(1)<<op.qubits[1]), op.qubits[2]); break;
+    case OpType::CZ: apply_mcphase((std::size_t(1)<<op.qubits[0]) | (std::size_t(1)<<op.qubits[1]), c64{-1,0}); break;
+    case OpType::SWAP: apply_swap(op.qubits[0], op.qubits[1]); break;
+    case OpType::U2Q: {
+      std::vector<std::size_t> qs{std::min(op.qubits[0], op.qubits[1]), std::max(op.qubits[0], op.qubits[1])};
+      auto m = block_matrix({op}, qs);
+      apply_controlled_kq(qs, 0, m.data());
+      break;
+    }
+    case OpType::DEPHASE: dephase(op.qubits[0], op.angle); break;
+    case OpType::DEPOL: depolarize(op.qubits[0], op.angle); break;
+    case OpType::AMPDAMP: amp_damp(op.qubits[0], op.angle); break;
+    case OpType::MEASURE: break;
+  }
+}
+
+void DensityMatrix::apply_step(const DensityStep& step){
+  if (!step.is_fused()) apply_op(step.op);
+  else if (step.unitary.empty()) apply_channel(step.channel, step.qubits);
+  else if (step.qubits.size() == 1){
+    const c64* m = step.unitary.data();
+    apply_unitary_1q(step.qubits[0], m[0], m[1], m[2], m[3]);
+  } else apply_controlled_kq(step.qubits, 0, step.unitary.data());
+}
+
+static DMRunResult run_matrix(const Circuit& c, uint64_t seed, const RunOptions& opts, DensityStorage storage){
+  DensityMatrix dm(c.nqubits, storage);
+  std::size_t passes = 0;
+  if (opts.fuse_channels){
+    // Only the diagonal is read below, so trailing dephasing can be dropped
+    const auto prog = compile_density(c, true);
+    for (const auto& st : prog.steps) dm.apply_step(st);
+    passes = prog.steps.size();
+  } else {
+    for (const auto& op : c.ops){
+      dm.apply_op(op);
+      if (op.type != OpType::MEASURE) ++passes;
+    }
+  }
+  // Gates and channels are trace preserving, so rounding drift is removed once at the end
+  dm.renormalize();
+  auto rr = sample_diagonal(dm.diagonal(), c.nqubits, seed);
+  rr.passes = passes;
+  return rr;
+}
+
+// Circuit noise ops as channels (angle = probability / damping rate)
+static Channel channel_of(const Op& op){
+  switch (op.type){
+    case OpType::DEPHASE: return dephasing(op.angle);
+    case OpType::DEPOL: return depolarizing(op.angle);
+    default: return amplitude_damping(op.angle);
+  }
+}
+
+// Conjugate of a gate, up to a global phase: conj(S) = e^{-i pi/4} RZ(-pi/2), conj(Y) = -Y.
+// Global factors scale the whole vector and cancel in the final division by the trace.
+static Op conj_op(const Op& op){
+  Op o = op;
+  switch (op.type){
+    case OpType::RX: case OpType::RZ: o.angle = -op.angle; break;
+    case OpType::S: o.type = OpType::RZ; o.angle = -std::numbers::pi/2; break;
+    case OpType::U3: o.params[1] = -op.params[1]; o.params[2] = -op.params[2]; break;
+    case OpType::U2Q: for (std::size_t k=1;k<o.params.size();k+=2) o.params[k] = -o.params[k]; break;
+    default: break; // H, X, Y, Z, RY, CNOT, CCX, CZ, SWAP have real matrices (up to sign)
+  }
+  return o;
+}
+
+static DMRunResult run_vectorized(const Circuit& c, uint64_t seed, const RunOptions& opts){
+  const std::size_t n = c.nqubits;
+  Circuit v; v.nqubits = 2*n;
   for (const auto& op : c.ops){
-    switch(op.type){
-      case OpType::H: H_coeffs(u00,u01,u10,u11); dm.apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
-      case OpType::X: X_coeffs(u00,u01,u10,u11); dm.apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
-      case OpType::Y: Y_coeffs(u00,u01,u10,u11); dm.apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
-      case OpType::Z:
-      Z_coeffs(u00,u01,u10,u11); dm.apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
-    case OpType::S:
-      S_coeffs(u00,u01,u10,u11); dm.apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
-    case OpType::RX:
-      RX_coeffs(op.angle,u00,u01,u10,u11); dm.apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
-    case OpType::RY:
-      RY_coeffs(op.angle,u00,u01,u10,u11); dm.apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
-    case OpType::Z: Z_coeffs(u00,u01,u10,u11); dm.apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
-      case OpType::RZ: RZ_coeffs(op.angle,u00,u01,u10,u11); dm.apply_unitary_1q(op.qubits[0],u00,u01,u10,u11); break;
-      case OpType::CNOT: dm.apply_cx(op.qubits[0], op.qubits[1]); break;
-      case OpType::DEPHASE: dm.dephase(op.qubits[0], op.angle); break;
-      case OpType::DEPOL: dm.depolarize(op.qubits[0], op.angle); break;
-      case OpType::AMPDAMP: dm.amp_damp(op.qubits[0], op.angle); break;
+    switch (op.type){
       case OpType::MEASURE: break;
+      case OpType::DEPHASE: case OpType::DEPOL: case OpType::AMPDAMP:
+      {
+        // Superoperator block order (c + 2r) matches local bits (q, q + n) of the dense op
+        const auto ch = channel_of(op);
+        std::vector<double> params;
+        for (auto z : ch.superop){ params.push_back(z.real()); params.push_back(z.imag()); }
+        v.ops.push_back({OpType::U2Q, {op.qubits[0], op.qubits[0] + n}, 0.0, std::move(params)});
+        break;
+      }
+      default: {
+        Op row = op;
+        for (auto& q : row.qubits) q += n;
+        v.ops.push_back(std::move(row));
+        v.ops.push_back(conj_op(op));
+      }
     }
   }
-  // Probabilities = diag(rho)
-  DMRunResult rr;
-  std::size_t d = dm.dim();
-  rr.probabilities.resize(d);
-  for (std::size_t i=0;i<d;++i) rr.probabilities[i] = std::real(dm.data()[idx(i,i,d)]);
-  // Sample one outcome deterministically from seed
+  StateVector sv(2*n);
   Rng rng(seed);
-  double r = rng.uniform();
-  double acc=0.0; std::size_t idxv=0;
-  for (std::size_t i=0;i<d;++i){ acc += rr.probabilities[i]; if (r<=acc){ idxv=i; break; } }
-  rr.outcome.resize(c.nqubits);
-  for (std::size_t q=0;q<c.nqubits;++q) rr.outcome[q] = (idxv>>q)&1;
+  const auto prof = execute(sv, v, rng, opts);
+  // Dividing by the (complex) trace removes global phases and the state-vector renormalisation
+  const std::size_t d = std::size_t(1) << n;
+  const auto& a = sv.amplitudes();
+  c64 tr{0,0};
+  for (std::size_t i=0;i<d;++i) tr += a[idx(i,i,d)];
+  std::vector<double> diag(d);
+  for (std::size_t i=0;i<d;++i) diag[i] = std::real(a[idx(i,i,d)] / tr);
+  auto rr = sample_diagonal(std::move(diag), n, seed);
+  rr.passes = prof.passes;
   return rr;
 }
 
+DMRunResult run_density(const Circuit& c, uint64_t seed, bool collapse, DensityMode mode, const RunOptions& opts){
+  (void)collapse; // density matrix keeps mixed states; collapse not applied
+  if (mode == DensityMode::Vectorized) return run_vectorized(c, seed, opts);
+  return run_matrix(c, seed, opts, mode == DensityMode::Packed ? DensityStorage::Packed : DensityStorage::Full);
+}
+
 } // namespace qsx
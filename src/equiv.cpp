@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/equiv.hpp"
+#include "quantum/schedule.hpp"
+#include "quantum/reduce.hpp"
+#include "quantum/rng.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+namespace qsx {
+
+static void check_ops(const Circuit& c){
+  for (const auto& op : c.ops)
+    if (op.type==OpType::DEPHASE || op.type==OpType::DEPOL || op.type==OpType::AMPDAMP)
+      throw std::runtime_error("Non-unitary op present");
+}
+
+// Gates preparing input t from |0...0>: a Haar-random product state for even t, a random
+// stabilizer state for odd t
+static std::vector<Op> input_state(std::size_t n, uint64_t seed, std::size_t t){
+  Pcg32 rng(seed, t);
+  std::vector<Op> ops;
+  if (t % 2 == 0){
+    const double two_pi = 6.283185307179586;
+    for (std::size_t q=0;q<n;++q){
+      const double theta = std::acos(1.0 - 2.0*rng.uniform01());
+      ops.push_back({OpType::U3, {q}, 0.0, {theta, two_pi*rng.uniform01(), 0.0}});
+    }
+    return ops;
+  }
+  // One of the six single-qubit stabilizer states per qubit, entangled by random CNOTs, then a
+  // random local Clifford layer
+  auto local = [&](std::size_t q){
+    const uint32_t k = rng.randint(6);
+    if (k & 1) ops.push_back({OpType::X, {q}, 0.0});
+    if (k >= 2) ops.push_back({OpType::H, {q}, 0.0});
+    if (k >= 4) ops.push_back({OpType::S, {q}, 0.0});
+  };
+  for (std::size_t q=0;q<n;++q) local(q);
+  if (n >= 2)
+    for (std::size_t i=0;i<n;++i){
+      const std::size_t c = rng.randint(uint32_t(n));
+      const std::size_t d = (c + 1 + rng.randint(uint32_t(n - 1))) % n;
+      ops.push_back({OpType::CNOT, {c, d}, 0.0});
+    }
+  for (std::size_t q=0;q<n;++q) local(q);
+  return ops;
+}
+
+// Move the content of bit position q to position layout[q] with at most n - 1 swaps
+static void permute_qubits(StateVector& sv, const std::vector<std::size_t>& layout){
+  const std::size_t n = layout.size();
+  std::vector<std::size_t> at(n), pos(n); // at[p]: source qubit now at position p; pos = inverse
+  for (std::size_t q=0;q<n;++q){ at[q] = q; pos[q] = q; }
+  for (std::size_t q=0;q<n;++q){
+    const std::size_t p = layout[q], from = pos[q];
+    if (p == from) continue;
+    sv.apply_swap(p, from);
+    const std::size_t r = at[p];
+    std::swap(at[p], at[from]);
+    pos[r] = from; pos[q] = p;
+  }
+}
+
+EquivResult check_equivalence(const Circuit& a, const Circuit& b, uint64_t seed, const EquivOptions& opts){
+  check_ops(a);
+  check_ops(b);
+  const std::size_t n = a.nqubits;
+  if (b.nqubits != n) throw std::invalid_argument("Circuits have different qubit counts");
+  const auto& layout = opts.output_layout;
+  if (!layout.empty()){
+    std::vector<bool> seen(n, false);
+    bool ok = layout.size() == n;
+    for (std::size_t q=0;ok && q<n;++q){ ok = layout[q] < n && !seen[layout[q]]; if (ok) seen[layout[q]] = true; }
+    if (!ok) throw std::invalid_argument("output_layout is not a permutation of the qubits");
+  }
+#ifdef QSX_FP32
+  const double tol = opts.tolerance > 0.0 ? opts.tolerance : 1e-3;
+#else
+  const double tol = opts.tolerance > 0.0 ? opts.tolerance : 1e-6;
+#endif
+  std::size_t trials = opts.trials;
+  if (trials == 0){
+    const double miss = std::clamp(1.0 - opts.confidence, 1e-300, 0.5);
+    trials = std::max<std::size_t>(2, std::size_t(std::ceil(std::log2(1.0 / miss))));
+  }
+
+  const ExecPlan plan_a = plan_execution(a, opts.run), plan_b = plan_execution(b, opts.run);
+  const auto none = [](const Op&){}; // MEASURE
+  auto overlap = [&](std::size_t t){
+    const auto prep = input_state(n, seed, t);
+    StateVector sa(n);
+    for (const auto& op : prep) apply_unitary(sa, op);
+    StateVector sb = sa;
+    apply_plan(sa, plan_a, none);
+    if (!layout.empty()) permute_qubits(sa, layout);
+    apply_plan(sb, plan_b, none);
+    return inner_product(sa.amplitudes().data(), sb.amplitudes().data(), sa.dimension());
+  };
+
+  EquivResult res;
+#ifdef QSX_OPENMP
+  const std::size_t batch = n <= kParallelStatesQubits ? std::size_t(std::max(1, omp_get_max_threads())) : 1;
+#else
+  const std::size_t batch = 1;
+#endif
+  std::vector<std::complex<double>> ov(batch);
+  for (std::size_t t0=0;t0<trials;t0+=batch){
+    const std::size_t nb = std::min(batch, trials - t0);
+    if (nb > 1){
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (std::ptrdiff_t i = 0; i < (std::ptrdiff_t)nb; ++i) ov[i] = overlap(t0 + std::size_t(i));
+    } else {
+      ov[0] = overlap(t0);
+    }
+    // Checked in input order, so the outcome is the same for any batch size
+    for (std::size_t i=0;i<nb;++i){
+      const std::size_t t = t0 + i;
+      if (t == 0 && std::abs(ov[i]) > 0.0) res.phase = ov[i] / std::abs(ov[i]);
+      const double dev = std::abs(ov[i] - res.phase);
+      res.max_deviation = std::max(res.max_deviation, dev);
+      res.trials = t + 1;
+      if (dev > tol){
+        res.equivalent = false;
+        res.first_mismatch = t;
+        return res;
+      }
+    }
+  }
+  return res;
+}
+
+} // namespace qsx
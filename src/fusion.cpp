@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/fusion.hpp"
+#include "quantum/kernels.hpp"
+#include <algorithm>
+
+namespace qsx {
+
+static bool is_gate(OpType t){
+  return !(t==OpType::MEASURE || t==OpType::DEPHASE || t==OpType::DEPOL || t==OpType::AMPDAMP);
+}
+
+std::vector<c64> block_matrix(const std::vector<Op>& ops, const std::vector<std::size_t>& qubits){
+  const std::size_t k = qubits.size();
+  const std::size_t dim = std::size_t(1) << k;
+  // Re-index ops onto the block's local qubits
+  std::vector<Op> local = ops;
+  for (auto& op : local){
+    for (auto& q : op.qubits) q = std::size_t(std::lower_bound(qubits.begin(), qubits.end(), q) - qubits.begin());
+  }
+  // Column j is the image of basis state |j>
+  std::vector<c64> m(dim*dim);
+  for (std::size_t j=0;j<dim;++j){
+    StateVector col(k);
+    auto& a = col.amplitudes_mut();
+    a[0] = {0.0, 0.0}; a[j] = {1.0, 0.0};
+    for (const auto& op : local) apply_unitary(col, op);
+    for (std::size_t r=0;r<dim;++r) m[r*dim + j] = a[r];
+  }
+  return m;
+}
+
+FusedCircuit fuse_gates(const Circuit& c, std::size_t max_qubits){
+  const std::size_t k = std::clamp<std::size_t>(max_qubits, 2, kernels::kMaxDenseQubits);
+  FusedCircuit fc; fc.nqubits = c.nqubits; fc.max_qubits = k;
+  const std::size_t m = c.ops.size();
+  std::vector<bool> used(m, false);
+  for (std::size_t i=0;i<m;++i){
+    if (used[i]) continue;
+    const Op& first = c.ops[i];
+    used[i] = true;
+    if (!is_gate(first.type) || first.qubits.size() > k){
+      if (is_gate(first.type)){ ++fc.source_gates; ++fc.fused_gates; }
+      FusedOp f; f.op = first; fc.ops.push_back(std::move(f));
+      continue;
+    }
+    std::vector<std::size_t> qs = first.qubits;
+    std::sort(qs.begin(), qs.end());
+    std::vector<Op> members{first};
+    // Greedy forward scan: a later gate joins if the union stays within k qubits and no skipped
+    // gate on its qubits lies in between (so it commutes past everything it overtakes).
+    std::vector<bool> blocked(c.nqubits, false);
+    std::size_t nblocked = 0;
+    for (std::size_t j=i+1;j<m && nblocked<c.nqubits;++j){
+      if (used[j]) continue;
+      const Op& op = c.ops[j];
+      if (!is_gate(op.type)) break;
+      bool free = true;
+      for (auto q : op.qubits) if (blocked[q]) free = false;
+      std::vector<std::size_t> uni = qs;
+      for (auto q : op.qubits) if (!std::binary_search(qs.begin(), qs.end(), q)) uni.push_back(q);
+      if (free && uni.size() <= k){
+        std::sort(uni.begin(), uni.end());
+        qs = std::move(uni);
+        members.push_back(op);
+        used[j] = true;
+      } else {
+        for (auto q : op.qubits) if (!blocked[q]){ blocked[q] = true; ++nblocked; }
+      }
+    }
+    fc.source_gates += members.size();
+    ++fc.fused_gates;
+    FusedOp f;
+    if (members.size() == 1){
+      // Lone gate: keep the specialised kernel
+      f.op = first;
+    } else {
+      f.qubits = qs;
+      f.matrix = block_matrix(members, qs);
+      f.gates = members.size();
+      if (std::any_of(members.begin(), members.end(), [](const Op& op){ return !op.param.empty(); })) f.members = std::move(members);
+    }
+    fc.ops.push_back(std::move(f));
+  }
+  return fc;
+}
+
+} // namespace qsx
@@ -2,21 +2,89 @@
 
 #include "quantum/grad.hpp"
 #include "quantum/circuit.hpp"
+#include "quantum/compiled.hpp"
+#include "quantum/reduce.hpp"
+#include "quantum/schedule.hpp"
+#include <algorithm>
 #include <cmath>
 
 namespace qsx {
 
-static std::vector<double> expZ_from_probs(const std::vector<double>& probs, std::size_t nqubits){
-  std::vector<double> out(nqubits, 0.0);
-  for (std::size_t q=0;q<nqubits;++q){
-    double z=0.0;
-    for (std::size_t i=0;i<probs.size();++i){
-      int bit = (i>>q)&1;
-      z += (bit? -probs[i] : probs[i]);
+static bool is_rotation(OpType t){ return t==OpType::RX || t==OpType::RY || t==OpType::RZ; }
+
+// Parameter-shift runs from prefix checkpoints. Every differentiated op becomes a named parameter
+// of one compiled plan, and parameters are visited in plan order while a single checkpoint (state
+// and rng before the first window that depends on the current parameter) moves forward through
+// the plan. The two shifted runs of a parameter then replay only the windows from its gate on.
+// Up to 13 qubits the shifted runs of several consecutive parameters share one batch (batched.hpp)
+// resumed from the checkpoint of the first of them. read(k, sign, state) gets the final state of
+// run(c with params[k] shifted by sign * pi/2, seed); wrt indices that are not RX/RY/RZ ops are
+// skipped. Returns the unshifted final state.
+template <class Read>
+static StateVector shift_from_checkpoints(const Circuit& c, const std::vector<std::size_t>& params, uint64_t seed, Read&& read){
+  Circuit shifted = c;
+  for (auto i : params)
+    if (i < c.ops.size() && is_rotation(c.ops[i].type)){
+      shifted.ops[i].param = "shift." + std::to_string(i);
+      shifted.ops[i].param_scale = 1.0;
+    }
+  CompiledCircuit cc = compile_circuit(shifted);
+  std::vector<double> vals(cc.parameters.size(), 0.0);
+  bind_parameters(cc, vals);
+  std::vector<std::size_t> slot(params.size()), window(params.size()), order;
+  for (std::size_t k=0;k<params.size();++k){
+    if (params[k] >= c.ops.size() || !is_rotation(c.ops[params[k]].type)) continue;
+    const std::string name = "shift." + std::to_string(params[k]);
+    slot[k] = std::size_t(std::find(cc.parameters.begin(), cc.parameters.end(), name) - cc.parameters.begin());
+    window[k] = parameter_window(cc, slot[k]);
+    order.push_back(k);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y){ return window[x] < window[y]; });
+
+  StateVector checkpoint(c.nqubits), sv(c.nqubits);
+  Rng rng(seed);
+  std::size_t at = 0;
+  const std::size_t width = batch_width(c.nqubits, 2 * order.size());
+  if (width > 1){
+    // Both shifts of width / 2 parameters per batch
+    BatchedStateVector bsv(c.nqubits, width);
+    std::vector<std::vector<double>> lanes;
+    for (std::size_t g=0;g<order.size();g+=width/2){
+      const std::size_t count = std::min(width / 2, order.size() - g);
+      execute(checkpoint, cc, rng, at, window[order[g]]);
+      at = window[order[g]];
+      lanes.assign(2 * count, vals);
+      for (std::size_t j=0;j<count;++j){
+        lanes[2*j][slot[order[g + j]]] = M_PI/2.0;
+        lanes[2*j + 1][slot[order[g + j]]] = -M_PI/2.0;
+      }
+      bsv.assign(checkpoint);
+      Rng r = rng;
+      execute(bsv, cc, lanes, r, at);
+      for (std::size_t j=0;j<2*count;++j){
+        bsv.extract(j, sv);
+        read(order[g + j/2], j % 2 ? -1.0 : 1.0, sv);
+      }
     }
-    out[q]=z;
+    execute(checkpoint, cc, rng, at);
+    return checkpoint;
   }
-  return out;
+  for (auto k : order){
+    execute(checkpoint, cc, rng, at, window[k]);
+    at = window[k];
+    for (double sign : {+1.0, -1.0}){
+      vals[slot[k]] = sign * M_PI/2.0;
+      bind_parameters(cc, vals);
+      sv = checkpoint;
+      Rng r = rng;
+      execute(sv, cc, r, at);
+      read(k, sign, sv);
+    }
+    vals[slot[k]] = 0.0;
+    bind_parameters(cc, vals);
+  }
+  execute(checkpoint, cc, rng, at);
+  return checkpoint;
 }
 
 std::optional<GradResult> grad_expZ_parameter_shift(const Circuit& c, const std::vector<std::size_t>& wrt_indices, uint64_t seed){
@@ -32,26 +100,149 @@ std::optional<GradResult> grad_expZ_parameter_shift(const Circuit& c, const std:
   }
   GradResult gr; gr.param_op_indices = params;
   gr.grads.assign(params.size(), std::vector<double>(c.nqubits, 0.0));
+  shift_from_checkpoints(c, params, seed, [&](std::size_t k, double sign, const StateVector& sv){
+    const auto ez = expect_z_all(probabilities(sv.amplitudes()), c.nqubits);
+    for (std::size_t q=0;q<c.nqubits;++q) gr.grads[k][q] += 0.5 * sign * ez[q];
+  });
+  return gr;
+}
 
-  // Helper to run circuit with modified angle at given index
-  auto run_probs = [&](std::size_t idx, double delta)->std::vector<double>{
-    Circuit c2 = c;
-    c2.ops[idx].angle += delta;
-    auto rr = run(c2, seed, false);
-    return rr.probabilities;
-  };
+std::optional<GradResult> grad_expectation_parameter_shift(const Circuit& c, const Hamiltonian& h, const std::vector<std::size_t>& wrt_indices, uint64_t seed){
+  if (h.nqubits != c.nqubits) return std::nullopt;
+  std::vector<std::size_t> params;
+  if (wrt_indices.empty()){
+    for (std::size_t i=0;i<c.ops.size();++i){
+      auto t = c.ops[i].type;
+      if (t==OpType::RX || t==OpType::RY || t==OpType::RZ) params.push_back(i);
+    }
+  } else {
+    params = wrt_indices;
+  }
+  GradResult gr; gr.param_op_indices = params;
+  gr.grads.assign(params.size(), std::vector<double>(1, 0.0));
+  const auto final_state = shift_from_checkpoints(c, params, seed, [&](std::size_t k, double sign, const StateVector& sv){
+    gr.grads[k][0] += 0.5 * sign * expectation(sv.amplitudes(), h);
+  });
+  gr.expectation = expectation(final_state.amplitudes(), h);
+  return gr;
+}
 
-  const double s = M_PI/2.0;
-  for (std::size_t k=0;k<params.size();++k){
-    std::size_t idx = params[k];
-    auto p_plus  = run_probs(idx, +s);
-    auto p_minus = run_probs(idx, -s);
-    auto ez_plus  = expZ_from_probs(p_plus,  c.nqubits);
-    auto ez_minus = expZ_from_probs(p_minus, c.nqubits);
-    for (std::size_t q=0;q<c.nqubits;++q){
-      gr.grads[k][q] = 0.5 * (ez_plus[q] - ez_minus[q]);
+// G^dagger up to a global phase (which cancels between |phi> and |lambda>)
+static Op inverse_op(const Op& op){
+  Op inv = op;
+  switch (op.type){
+    case OpType::S: inv.type = OpType::RZ; inv.angle = -M_PI/2; break;
+    case OpType::RX: case OpType::RY: case OpType::RZ: inv.angle = -op.angle; break;
+    case OpType::U3: inv.params = {-op.params[0], -op.params[2], -op.params[1]}; break;
+    case OpType::U2Q:
+      for (std::size_t r=0;r<4;++r)
+        for (std::size_t c=0;c<4;++c){
+          inv.params[2*(4*r + c)] = op.params[2*(4*c + r)];
+          inv.params[2*(4*r + c) + 1] = -op.params[2*(4*c + r) + 1];
+        }
+      break;
+    default: break; // H, X, Y, Z, CNOT, CCX, CZ, SWAP are self-inverse
+  }
+  return inv;
+}
+
+// P |a> for the generator of op: R(theta) = exp(-i theta P / 2). RY_coeffs is exp(+i theta Y / 2),
+// so its generator is -Y.
+static void apply_axis(StateVector& sv, const Op& op){
+  const std::size_t q = op.qubits[0];
+  if (op.type == OpType::RX) sv.apply_x(q);
+  else if (op.type == OpType::RY) sv.apply_gate_1q(q, c64{0, 0}, c64{0, 1}, c64{0, -1}, c64{0, 0});
+  else sv.apply_diag_1q(q, c64{1, 0}, c64{-1, 0});
+}
+
+// Adjoint differentiation of one observable O: phi and lambda = O phi start from the final state
+// and are un-applied op by op; at a differentiated rotation, dO/d theta = Im <lambda|P|phi>.
+class AdjointSweep {
+  const Circuit& c_;
+  std::vector<std::vector<std::size_t>> slots_; // gradient slots per op (wrt indices may repeat)
+  std::size_t lowest_;                          // first op the sweep has to reach
+  std::vector<Op> inverse_;
+  StateVector mu_;
+public:
+  AdjointSweep(const Circuit& c, const std::vector<std::size_t>& params)
+    : c_(c), slots_(c.ops.size()), lowest_(c.ops.size()), inverse_(c.ops.size()), mu_(c.nqubits) {
+    for (std::size_t k=0;k<params.size();++k){ slots_[params[k]].push_back(k); lowest_ = std::min(lowest_, params[k]); }
+    for (std::size_t i=lowest_;i<c.ops.size();++i) inverse_[i] = inverse_op(c.ops[i]);
+  }
+  // grad[k] receives the gradient for params[k]
+  template <class Store>
+  void run(StateVector& phi, StateVector& lambda, Store&& grad){
+    for (std::size_t i=c_.ops.size(); i-- > lowest_; ){
+      const Op& op = c_.ops[i];
+      if (op.type == OpType::MEASURE) continue;
+      // phi and lambda are the states right after op i
+      if (!slots_[i].empty()){
+        mu_ = phi;
+        apply_axis(mu_, op);
+        const double g = inner_product(lambda.amplitudes().data(), mu_.amplitudes().data(), mu_.dimension()).imag();
+        for (auto k : slots_[i]) grad(k, g);
+      }
+      if (i == lowest_) break;
+      apply_unitary(phi, inverse_[i]);
+      apply_unitary(lambda, inverse_[i]);
     }
   }
+};
+
+// Differentiated ops for the adjoint method: nullopt with noise or non-rotation wrt indices
+static std::optional<std::vector<std::size_t>> adjoint_params(const Circuit& c, const std::vector<std::size_t>& wrt_indices){
+  for (const auto& op : c.ops)
+    if (op.type==OpType::DEPHASE || op.type==OpType::DEPOL || op.type==OpType::AMPDAMP) return std::nullopt;
+  std::vector<std::size_t> params;
+  if (wrt_indices.empty()){
+    for (std::size_t i=0;i<c.ops.size();++i) if (is_rotation(c.ops[i].type)) params.push_back(i);
+  } else {
+    params = wrt_indices;
+    for (auto i : params) if (i >= c.ops.size() || !is_rotation(c.ops[i].type)) return std::nullopt;
+  }
+  return params;
+}
+
+std::optional<GradResult> grad_expZ_adjoint(const Circuit& c, const std::vector<std::size_t>& wrt_indices,
+                                            const RunOptions& opts, const std::vector<std::size_t>& qubits){
+  const auto params = adjoint_params(c, wrt_indices);
+  if (!params) return std::nullopt;
+  const std::size_t n = c.nqubits;
+  std::vector<std::size_t> observed = qubits;
+  if (observed.empty()) for (std::size_t q=0;q<n;++q) observed.push_back(q);
+  for (auto q : observed) if (q >= n) return std::nullopt;
+  GradResult gr; gr.param_op_indices = *params;
+  gr.grads.assign(params->size(), std::vector<double>(n, 0.0));
+  if (params->empty()) return gr;
+
+  StateVector final_state(n);
+  apply_plan(final_state, plan_execution(c, opts), [](const Op&){});
+
+  AdjointSweep sweep(c, *params);
+  StateVector phi(n), lambda(n);
+  for (auto q : observed){
+    phi = final_state;
+    lambda = final_state;
+    lambda.apply_diag_1q(q, c64{1, 0}, c64{-1, 0});
+    sweep.run(phi, lambda, [&](std::size_t k, double g){ gr.grads[k][q] = g; });
+  }
+  return gr;
+}
+
+std::optional<GradResult> grad_expectation_adjoint(const Circuit& c, const Hamiltonian& h, const std::vector<std::size_t>& wrt_indices,
+                                                   const RunOptions& opts){
+  const auto params = adjoint_params(c, wrt_indices);
+  if (!params || h.nqubits != c.nqubits) return std::nullopt;
+  const std::size_t n = c.nqubits;
+  GradResult gr; gr.param_op_indices = *params;
+  gr.grads.assign(params->size(), std::vector<double>(1, 0.0));
+
+  StateVector phi(n), lambda(n);
+  apply_plan(phi, plan_execution(c, opts), [](const Op&){});
+  apply_hamiltonian(phi.amplitudes(), h, lambda.amplitudes_mut());
+  gr.expectation = inner_product(phi.amplitudes().data(), lambda.amplitudes().data(), phi.dimension()).real();
+  if (params->empty()) return gr;
+  AdjointSweep(c, *params).run(phi, lambda, [&](std::size_t k, double g){ gr.grads[k][0] = g; });
   return gr;
 }
 
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/hamiltonian.hpp"
+#include "quantum/reduce.hpp"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+namespace qsx {
+
+using cd = std::complex<double>;
+
+std::optional<PauliTerm> parse_pauli_string(std::string_view s, std::size_t n, std::string& err){
+  PauliTerm t;
+  std::string compact;
+  for (char ch : s) if (!std::isspace((unsigned char)ch)) compact.push_back(char(std::toupper((unsigned char)ch)));
+  if (compact == "I") return t;
+  std::size_t i = 0;
+  while (i < compact.size()){
+    const char p = compact[i++];
+    std::size_t q = 0, digits = 0;
+    while (i < compact.size() && std::isdigit((unsigned char)compact[i]) && digits < 19){ q = 10*q + std::size_t(compact[i++] - '0'); ++digits; }
+    if ((p != 'X' && p != 'Y' && p != 'Z' && p != 'I') || digits == 0){ err = "Bad pauli format: " + std::string(s); return std::nullopt; }
+    if (q >= n || q >= 64){ err = "Qubit index out of range: " + std::string(s); return std::nullopt; }
+    const std::uint64_t bit = std::uint64_t(1) << q;
+    if ((t.x_mask | t.z_mask) & bit){ err = "Repeated qubit in pauli string: " + std::string(s); return std::nullopt; }
+    if (p == 'X' || p == 'Y') t.x_mask |= bit;
+    if (p == 'Z' || p == 'Y') t.z_mask |= bit;
+  }
+  if (compact.empty()){ err = "Empty pauli string"; return std::nullopt; }
+  return t;
+}
+
+std::optional<Hamiltonian> parse_hamiltonian_file(const std::string& path, std::size_t n, std::string& err){
+  std::ifstream in(path);
+  if (!in){ err = "Cannot open " + path; return std::nullopt; }
+  Hamiltonian h; h.nqubits = n;
+  std::string line;
+  std::size_t lineno = 0;
+  while (std::getline(in, line)){
+    ++lineno;
+    const auto hash = line.find('#');
+    if (hash != std::string::npos) line.resize(hash);
+    std::istringstream ss(line);
+    double coeff;
+    if (!(ss >> coeff)){
+      if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+      err = "Bad coefficient at line " + std::to_string(lineno); return std::nullopt;
+    }
+    std::string rest((std::istreambuf_iterator<char>(ss)), std::istreambuf_iterator<char>());
+    auto t = parse_pauli_string(rest, n, err);
+    if (!t){ err += " at line " + std::to_string(lineno); return std::nullopt; }
+    t->coeff = coeff;
+    auto same = std::find_if(h.terms.begin(), h.terms.end(), [&](const PauliTerm& o){ return o.x_mask == t->x_mask && o.z_mask == t->z_mask; });
+    if (same != h.terms.end()) same->coeff += coeff;
+    else h.terms.push_back(*t);
+  }
+  return h;
+}
+
+namespace {
+
+// Groups with more Z variants than this use a Walsh-Hadamard transform per chunk (cost ~ chunk bits
+// per amplitude) instead of a sign parity per term and amplitude
+constexpr std::size_t kWalshTerms = 16;
+
+// Terms sharing one x_mask, with the i^{#Y} phase folded into the weight
+struct FlipGroup {
+  std::uint64_t x_mask = 0;
+  std::vector<std::uint64_t> z;
+  std::vector<cd> w;
+  // sum_t w_t (-1)^{popcount(x & z_t)}
+  cd weight(std::uint64_t x) const {
+    cd s{0.0, 0.0};
+    for (std::size_t t=0;t<z.size();++t) s += (std::popcount(x & z[t]) & 1) ? -w[t] : w[t];
+    return s;
+  }
+};
+
+std::vector<FlipGroup> group_terms(const Hamiltonian& h){
+  static const cd ipow[4] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+  std::vector<FlipGroup> groups;
+  for (const auto& t : h.terms){
+    auto g = std::find_if(groups.begin(), groups.end(), [&](const FlipGroup& o){ return o.x_mask == t.x_mask; });
+    if (g == groups.end()){ groups.push_back(FlipGroup{t.x_mask, {}, {}}); g = groups.end() - 1; }
+    g->z.push_back(t.z_mask);
+    g->w.push_back(t.coeff * ipow[std::popcount(t.x_mask & t.z_mask) & 3]);
+  }
+  return groups;
+}
+
+// In-place unnormalised Walsh-Hadamard transform: v[j] <- sum_i (-1)^{popcount(i & j)} v[i]
+void fwht(cd* v, std::size_t len){
+  for (std::size_t h=1;h<len;h<<=1)
+    for (std::size_t i=0;i<len;i+=2*h)
+      for (std::size_t j=i;j<i+h;++j){
+        const cd u = v[j], t = v[j + h];
+        v[j] = u + t; v[j + h] = u - t;
+      }
+}
+
+// W(base + lo) = sum_t w_t (-1)^{popcount((base + lo) & z_t)} for every lo < len (base aligned to len):
+// the w_t go to index z_t & (len - 1) with the sign of their high bits, then one transform
+void walsh_weights(const FlipGroup& g, std::uint64_t base, std::size_t len, std::vector<cd>& W){
+  W.assign(len, cd{0.0, 0.0});
+  for (std::size_t t=0;t<g.z.size();++t)
+    W[g.z[t] & (len - 1)] += (std::popcount(base & g.z[t]) & 1) ? -g.w[t] : g.w[t];
+  fwht(W.data(), len);
+}
+
+} // namespace
+
+double expectation(const vec_c64& a, const Hamiltonian& h){
+  const auto groups = group_terms(h);
+  const std::size_t N = a.size(), chunk = std::min(N, kReduceChunk), nchunks = (N + chunk - 1) / chunk;
+  std::vector<double> part(nchunks, 0.0);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t k = 0; k < (std::ptrdiff_t)nchunks; ++k){
+    const std::size_t lo = std::size_t(k) * chunk, hi = lo + chunk;
+    std::vector<cd> W;
+    double s = 0.0;
+    for (const auto& g : groups){
+      cd acc{0.0, 0.0};
+      if (g.z.size() > kWalshTerms){
+        walsh_weights(g, lo, chunk, W);
+        for (std::size_t x = lo; x < hi; ++x) acc += std::conj(cd(a[x ^ g.x_mask])) * cd(a[x]) * W[x - lo];
+      } else {
+        for (std::size_t x = lo; x < hi; ++x) acc += std::conj(cd(a[x ^ g.x_mask])) * cd(a[x]) * g.weight(x);
+      }
+      s += acc.real();
+    }
+    part[k] = s;
+  }
+  double total = 0.0;
+  for (double v : part) total += v;
+  return total;
+}
+
+void apply_hamiltonian(const vec_c64& a, const Hamiltonian& h, vec_c64& out){
+  const auto groups = group_terms(h);
+  const std::size_t N = a.size(), chunk = std::min(N, kReduceChunk), nchunks = (N + chunk - 1) / chunk;
+  out.assign(N, c64{0, 0});
+  // out[y] = sum over groups of W_g(x) a[x] with x = y ^ x_mask, chunk by chunk of x
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t k = 0; k < (std::ptrdiff_t)nchunks; ++k){
+    const std::size_t lo = std::size_t(k) * chunk, hi = lo + chunk;
+    std::vector<cd> W;
+    std::vector<cd> acc(chunk, cd{0.0, 0.0});
+    for (const auto& g : groups){
+      // x ^ x_mask runs over the chunk lo ^ (x_mask & ~(chunk - 1)) of y
+      const std::uint64_t src = lo ^ (g.x_mask & ~std::uint64_t(chunk - 1));
+      if (g.z.size() > kWalshTerms){
+        walsh_weights(g, src, chunk, W);
+        for (std::size_t y = lo; y < hi; ++y){ const std::size_t x = y ^ g.x_mask; acc[y - lo] += W[x - src] * cd(a[x]); }
+      } else {
+        for (std::size_t y = lo; y < hi; ++y){ const std::size_t x = y ^ g.x_mask; acc[y - lo] += g.weight(x) * cd(a[x]); }
+      }
+    }
+    for (std::size_t y = lo; y < hi; ++y) out[y] = c64(acc[y - lo]);
+  }
+}
+
+} // namespace qsx
@@ -0,0 +1,510 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/kernels.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define QSX_SIMD_X86 1
+#include <immintrin.h>
+#endif
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+namespace qsx::kernels {
+
+// ---------------------------------------------------------------------------------------------
+// Scalar reference kernels (also used for shapes the vector kernels do not cover)
+// ---------------------------------------------------------------------------------------------
+
+// Bases below the lowest gate bit are consecutive: the pair loops step through runs of this many
+// bits so the index arithmetic is done once per run (batched states, batched.hpp, always have runs)
+constexpr std::size_t kPairRunBits = 3;
+
+// Visit the N/2 pair bases (i0 with target bit clear, i1 = i0 | 2^target) without skipping.
+template <class F>
+static inline void for_each_pair(std::size_t n, std::size_t target, F&& f) {
+  const std::size_t half = (std::size_t(1) << n) >> 1;
+  const std::size_t stride = std::size_t(1) << target;
+  if (target == 0) {
+    // Low target: contiguous pairs (2k, 2k+1)
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (std::size_t k = 0; k < half; ++k) f(2 * k, 2 * k + 1);
+  } else if (target + 1 == n) {
+    // High target: two streaming halves [0, N/2) and [N/2, N)
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (std::size_t k = 0; k < half; ++k) f(k, k + half);
+  } else {
+    // Runs of up to 2^kPairRunBits consecutive pair bases share one index computation
+    const std::size_t rb = std::min(target, kPairRunBits), run = std::size_t(1) << rb;
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (std::size_t r = 0; r < (half >> rb); ++r) {
+      const std::size_t i0 = insert_zero_bit(r << rb, target);
+      for (std::size_t t = 0; t < run; ++t) f(i0 + t, (i0 + t) | stride);
+    }
+  }
+}
+
+// Bit positions to insert zeros at for a gate on `qubits` (ascending) with control_mask: all of
+// them in ascending order. Returns the count; group g then has base index
+// insert_zero_bits(g) | control_mask.
+static inline std::size_t gate_bits(const std::size_t* qubits, std::size_t k, std::size_t control_mask,
+                                    std::size_t bits[64]) {
+  std::size_t nb = 0;
+  for (std::size_t j = 0; j < k; ++j) bits[nb++] = qubits[j];
+  for (std::size_t b = 0; b < 64; ++b) if ((control_mask >> b) & 1) bits[nb++] = b;
+  std::sort(bits, bits + nb);
+  return nb;
+}
+
+static inline std::size_t insert_zero_bits(std::size_t g, const std::size_t* bits, std::size_t nb) {
+  for (std::size_t j = 0; j < nb; ++j) g = insert_zero_bit(g, bits[j]);
+  return g;
+}
+
+// Visit the N/4 bases with control = 1 and target = 0.
+template <class F>
+static inline void for_each_controlled_pair(std::size_t n, std::size_t control, std::size_t target, F&& f) {
+  const std::size_t quarter = (std::size_t(1) << n) >> 2;
+  const std::size_t cm = std::size_t(1) << control;
+  const std::size_t tm = std::size_t(1) << target;
+  const std::size_t lo = std::min(control, target), hi = std::max(control, target);
+  const std::size_t rb = std::min(lo, kPairRunBits), run = std::size_t(1) << rb;
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::size_t r = 0; r < (quarter >> rb); ++r) {
+    const std::size_t i0 = insert_zero_bit(insert_zero_bit(r << rb, lo), hi) | cm;
+    for (std::size_t t = 0; t < run; ++t) f(i0 + t, (i0 + t) | tm);
+  }
+}
+
+static void scalar_1q(c64* a, std::size_t n, std::size_t target, const c64 u[4]) {
+  const c64 u00 = u[0], u01 = u[1], u10 = u[2], u11 = u[3];
+  for_each_pair(n, target, [=](std::size_t i, std::size_t j) {
+    const c64 a0 = a[i];
+    const c64 a1 = a[j];
+    a[i] = u00 * a0 + u01 * a1;
+    a[j] = u10 * a0 + u11 * a1;
+  });
+}
+
+static void scalar_controlled_1q(c64* a, std::size_t n, std::size_t control, std::size_t target, const c64 u[4]) {
+  const c64 u00 = u[0], u01 = u[1], u10 = u[2], u11 = u[3];
+  for_each_controlled_pair(n, control, target, [=](std::size_t i, std::size_t j) {
+    const c64 a0 = a[i];
+    const c64 a1 = a[j];
+    a[i] = u00 * a0 + u01 * a1;
+    a[j] = u10 * a0 + u11 * a1;
+  });
+}
+
+static void scalar_diag_1q(c64* a, std::size_t n, std::size_t target, c64 d0, c64 d1) {
+  if (d0 == c64{1, 0}) {
+    // Only the |1> half changes; Z is a plain sign flip
+    if (d1 == c64{-1, 0}) for_each_pair(n, target, [=](std::size_t, std::size_t j) { a[j] = -a[j]; });
+    else for_each_pair(n, target, [=](std::size_t, std::size_t j) { a[j] *= d1; });
+    return;
+  }
+  for_each_pair(n, target, [=](std::size_t i, std::size_t j) {
+    a[i] *= d0;
+    a[j] *= d1;
+  });
+}
+
+#ifdef QSX_SIMD_X86
+// ---------------------------------------------------------------------------------------------
+// Vector kernels. A register holds L interleaved complex numbers (re, im, re, im, ...).
+// Targets with 2^target >= L use whole registers of pair bases; lower targets pair lanes inside
+// one register through a lane permutation with per-lane coefficients.
+// ---------------------------------------------------------------------------------------------
+
+#define QSX_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define QSX_TARGET_AVX512 __attribute__((target("avx512f")))
+
+// Per-lane complex coefficients split into duplicated real and imaginary parts.
+template <class T, std::size_t L>
+struct LaneCoeffs {
+  alignas(64) T re[2 * L];
+  alignas(64) T im[2 * L];
+  void set(std::size_t lane, std::complex<T> c) {
+    re[2 * lane] = re[2 * lane + 1] = c.real();
+    im[2 * lane] = im[2 * lane + 1] = c.imag();
+  }
+};
+
+namespace avx2 {
+
+struct D {
+  using T = double;
+  using R = __m256d;
+  static constexpr std::size_t L = 2;
+  QSX_TARGET_AVX2 static inline R load(const std::complex<T>* p) { return _mm256_loadu_pd(reinterpret_cast<const T*>(p)); }
+  QSX_TARGET_AVX2 static inline void store(std::complex<T>* p, R v) { _mm256_storeu_pd(reinterpret_cast<T*>(p), v); }
+  QSX_TARGET_AVX2 static inline R set1(T x) { return _mm256_set1_pd(x); }
+  QSX_TARGET_AVX2 static inline R loada(const T* p) { return _mm256_load_pd(p); }
+  QSX_TARGET_AVX2 static inline R add(R x, R y) { return _mm256_add_pd(x, y); }
+  // (v * c) with c given as duplicated real/imaginary registers
+  QSX_TARGET_AVX2 static inline R cmul(R v, R cr, R ci) {
+    return _mm256_fmaddsub_pd(v, cr, _mm256_mul_pd(_mm256_permute_pd(v, 0x5), ci));
+  }
+  // Exchange complex lanes j and j ^ s (s < L)
+  QSX_TARGET_AVX2 static inline R lane_swap(R v, std::size_t) { return _mm256_permute2f128_pd(v, v, 0x01); }
+};
+
+struct F {
+  using T = float;
+  using R = __m256;
+  static constexpr std::size_t L = 4;
+  QSX_TARGET_AVX2 static inline R load(const std::complex<T>* p) { return _mm256_loadu_ps(reinterpret_cast<const T*>(p)); }
+  QSX_TARGET_AVX2 static inline void store(std::complex<T>* p, R v) { _mm256_storeu_ps(reinterpret_cast<T*>(p), v); }
+  QSX_TARGET_AVX2 static inline R set1(T x) { return _mm256_set1_ps(x); }
+  QSX_TARGET_AVX2 static inline R loada(const T* p) { return _mm256_load_ps(p); }
+  QSX_TARGET_AVX2 static inline R add(R x, R y) { return _mm256_add_ps(x, y); }
+  QSX_TARGET_AVX2 static inline R cmul(R v, R cr, R ci) {
+    return _mm256_fmaddsub_ps(v, cr, _mm256_mul_ps(_mm256_permute_ps(v, 0xB1), ci));
+  }
+  QSX_TARGET_AVX2 static inline R lane_swap(R v, std::size_t s) {
+    return s == 1 ? _mm256_permute_ps(v, _MM_SHUFFLE(1, 0, 3, 2)) : _mm256_permute2f128_ps(v, v, 0x01);
+  }
+};
+
+#define QSX_TARGET QSX_TARGET_AVX2
+#include "kernels_simd.inl"
+#undef QSX_TARGET
+
+} // namespace avx2
+
+// GCC 12's AVX-512 shuffle intrinsics pass _mm512_undefined_*() as the merge source, which trips
+// -Wmaybe-uninitialized once inlined; the value is never read (mask is all ones).
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace avx512 {
+
+struct D {
+  using T = double;
+  using R = __m512d;
+  static constexpr std::size_t L = 4;
+  QSX_TARGET_AVX512 static inline R load(const std::complex<T>* p) { return _mm512_loadu_pd(reinterpret_cast<const T*>(p)); }
+  QSX_TARGET_AVX512 static inline void store(std::complex<T>* p, R v) { _mm512_storeu_pd(reinterpret_cast<T*>(p), v); }
+  QSX_TARGET_AVX512 static inline R set1(T x) { return _mm512_set1_pd(x); }
+  QSX_TARGET_AVX512 static inline R loada(const T* p) { return _mm512_load_pd(p); }
+  QSX_TARGET_AVX512 static inline R add(R x, R y) { return _mm512_add_pd(x, y); }
+  QSX_TARGET_AVX512 static inline R cmul(R v, R cr, R ci) {
+    return _mm512_fmaddsub_pd(v, cr, _mm512_mul_pd(_mm512_shuffle_pd(v, v, 0x55), ci));
+  }
+  QSX_TARGET_AVX512 static inline R lane_swap(R v, std::size_t s) {
+    return s == 1 ? _mm512_shuffle_f64x2(v, v, _MM_SHUFFLE(2, 3, 0, 1)) : _mm512_shuffle_f64x2(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+  }
+};
+
+struct F {
+  using T = float;
+  using R = __m512;
+  static constexpr std::size_t L = 8;
+  QSX_TARGET_AVX512 static inline R load(const std::complex<T>* p) { return _mm512_loadu_ps(reinterpret_cast<const T*>(p)); }
+  QSX_TARGET_AVX512 static inline void store(std::complex<T>* p, R v) { _mm512_storeu_ps(reinterpret_cast<T*>(p), v); }
+  QSX_TARGET_AVX512 static inline R set1(T x) { return _mm512_set1_ps(x); }
+  QSX_TARGET_AVX512 static inline R loada(const T* p) { return _mm512_load_ps(p); }
+  QSX_TARGET_AVX512 static inline R add(R x, R y) { return _mm512_add_ps(x, y); }
+  QSX_TARGET_AVX512 static inline R cmul(R v, R cr, R ci) {
+    return _mm512_fmaddsub_ps(v, cr, _mm512_mul_ps(_mm512_shuffle_ps(v, v, 0xB1), ci));
+  }
+  QSX_TARGET_AVX512 static inline R lane_swap(R v, std::size_t s) {
+    if (s == 1) return _mm512_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+    if (s == 2) return _mm512_shuffle_f32x4(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm512_shuffle_f32x4(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+  }
+};
+
+#define QSX_TARGET QSX_TARGET_AVX512
+#include "kernels_simd.inl"
+#undef QSX_TARGET
+
+} // namespace avx512
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif // QSX_SIMD_X86
+
+// ---------------------------------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------------------------------
+
+Isa detect_isa() {
+#ifdef QSX_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return Isa::AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Isa::AVX2;
+#endif
+  return Isa::Scalar;
+}
+
+static Isa initial_isa() {
+  Isa best = detect_isa();
+  if (const char* env = std::getenv("QSX_SIMD")) {
+    std::string v(env);
+    Isa want = v == "scalar" ? Isa::Scalar : v == "avx2" ? Isa::AVX2 : best;
+    return static_cast<int>(want) < static_cast<int>(best) ? want : best;
+  }
+  return best;
+}
+
+static std::atomic<int>& isa_slot() {
+  static std::atomic<int> slot{static_cast<int>(initial_isa())};
+  return slot;
+}
+
+Isa active_isa() { return static_cast<Isa>(isa_slot().load(std::memory_order_relaxed)); }
+
+void set_isa(Isa isa) {
+  Isa best = detect_isa();
+  if (static_cast<int>(isa) > static_cast<int>(best)) isa = best;
+  isa_slot().store(static_cast<int>(isa), std::memory_order_relaxed);
+}
+
+const char* isa_name(Isa isa) {
+  switch (isa) {
+    case Isa::AVX512: return "avx512";
+    case Isa::AVX2: return "avx2";
+    case Isa::Scalar: break;
+  }
+  return "scalar";
+}
+
+#ifdef QSX_SIMD_X86
+#ifdef QSX_FP32
+using Avx2V = avx2::F;
+using Avx512V = avx512::F;
+#else
+using Avx2V = avx2::D;
+using Avx512V = avx512::D;
+#endif
+#endif
+
+void apply_1q(Isa isa, c64* a, std::size_t n, std::size_t target, const c64 u[4]) {
+#ifdef QSX_SIMD_X86
+  if (isa == Isa::AVX512 && avx512::kernel_1q<Avx512V>(a, n, target, u)) return;
+  if (isa != Isa::Scalar && avx2::kernel_1q<Avx2V>(a, n, target, u)) return;
+#else
+  (void)isa;
+#endif
+  scalar_1q(a, n, target, u);
+}
+
+void apply_controlled_1q(Isa isa, c64* a, std::size_t n, std::size_t control, std::size_t target, const c64 u[4]) {
+  if (control == target) return;
+#ifdef QSX_SIMD_X86
+  if (isa == Isa::AVX512 && avx512::kernel_controlled_1q<Avx512V>(a, n, control, target, u)) return;
+  if (isa != Isa::Scalar && avx2::kernel_controlled_1q<Avx2V>(a, n, control, target, u)) return;
+#else
+  (void)isa;
+#endif
+  scalar_controlled_1q(a, n, control, target, u);
+}
+
+void apply_diag_1q(Isa isa, c64* a, std::size_t n, std::size_t target, c64 d0, c64 d1) {
+#ifdef QSX_SIMD_X86
+  if (isa == Isa::AVX512 && avx512::kernel_diag_1q<Avx512V>(a, n, target, d0, d1)) return;
+  if (isa != Isa::Scalar && avx2::kernel_diag_1q<Avx2V>(a, n, target, d0, d1)) return;
+#else
+  (void)isa;
+#endif
+  scalar_diag_1q(a, n, target, d0, d1);
+}
+
+// Dense k-qubit kernel with the matrix split into real/imaginary planes on the stack. K is a
+// template parameter so the gather/multiply loops fully unroll; complex products are spelled out
+// to avoid the NaN-recovery path of std::complex multiplication. Controls only shrink the set of
+// groups: zeros are inserted at every target and control bit, then the control bits are set.
+template <std::size_t K>
+static void dense_kq(c64* a, std::size_t n, const std::size_t* qubits, std::size_t control_mask, const c64* m) {
+  using T = c64::value_type;
+  constexpr std::size_t dim = std::size_t(1) << K;
+  std::size_t off[dim];
+  for (std::size_t j = 0; j < dim; ++j) {
+    off[j] = 0;
+    for (std::size_t b = 0; b < K; ++b) off[j] |= ((j >> b) & 1) << qubits[b];
+  }
+  T mre[dim * dim], mim[dim * dim];
+  for (std::size_t i = 0; i < dim * dim; ++i) { mre[i] = m[i].real(); mim[i] = m[i].imag(); }
+  std::size_t bits[64];
+  const std::size_t nb = gate_bits(qubits, K, control_mask, bits);
+  const std::ptrdiff_t groups = std::ptrdiff_t((std::size_t(1) << n) >> nb);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t g = 0; g < groups; ++g) {
+    const std::size_t base = insert_zero_bits(std::size_t(g), bits, nb) | control_mask;
+    T vr[dim], vi[dim];
+    for (std::size_t j = 0; j < dim; ++j) { vr[j] = a[base + off[j]].real(); vi[j] = a[base + off[j]].imag(); }
+    for (std::size_t r = 0; r < dim; ++r) {
+      const T* rr = mre + r * dim;
+      const T* ri = mim + r * dim;
+      T accr = 0, acci = 0;
+      for (std::size_t j = 0; j < dim; ++j) {
+        accr += rr[j] * vr[j] - ri[j] * vi[j];
+        acci += rr[j] * vi[j] + ri[j] * vr[j];
+      }
+      a[base + off[r]] = c64(accr, acci);
+    }
+  }
+}
+
+void apply_controlled_kq(Isa isa, c64* a, std::size_t n, const std::size_t* qubits, std::size_t k,
+                         std::size_t control_mask, const c64* m) {
+  if (k == 0 || k > kMaxDenseQubits) return;
+#ifdef QSX_SIMD_X86
+  if (isa == Isa::AVX512 && avx512::kernel_kq<Avx512V>(a, n, qubits, k, control_mask, m)) return;
+  if (isa != Isa::Scalar && avx2::kernel_kq<Avx2V>(a, n, qubits, k, control_mask, m)) return;
+#else
+  (void)isa;
+#endif
+  switch (k) {
+    case 1: dense_kq<1>(a, n, qubits, control_mask, m); break;
+    case 2: dense_kq<2>(a, n, qubits, control_mask, m); break;
+    case 3: dense_kq<3>(a, n, qubits, control_mask, m); break;
+    case 4: dense_kq<4>(a, n, qubits, control_mask, m); break;
+    default: dense_kq<5>(a, n, qubits, control_mask, m); break;
+  }
+}
+
+void apply_kq(Isa isa, c64* a, std::size_t n, const std::size_t* qubits, std::size_t k, const c64* m) {
+  apply_controlled_kq(isa, a, n, qubits, k, 0, m);
+}
+
+// Per-state dense kernel for batched states: the same gather/multiply as dense_kq, once per state
+// of the batch with that state's matrix.
+template <std::size_t K>
+static void dense_kq_lanes(c64* a, std::size_t n, std::size_t lane_bits, const std::size_t* qubits, const c64* m) {
+  using T = c64::value_type;
+  constexpr std::size_t dim = std::size_t(1) << K;
+  const std::size_t B = std::size_t(1) << lane_bits;
+  std::size_t off[dim];
+  for (std::size_t j = 0; j < dim; ++j) {
+    off[j] = 0;
+    for (std::size_t b = 0; b < K; ++b) off[j] |= ((j >> b) & 1) << qubits[b];
+  }
+  std::size_t bits[64];
+  const std::size_t nb = gate_bits(qubits, K, 0, bits);
+  const std::ptrdiff_t groups = std::ptrdiff_t((std::size_t(1) << n) >> nb);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t g = 0; g < groups; ++g) {
+    const std::size_t base = insert_zero_bits(std::size_t(g), bits, nb);
+    for (std::size_t lane = 0; lane < B; ++lane) {
+      const c64* mb = m + lane * dim * dim;
+      T vr[dim], vi[dim];
+      for (std::size_t j = 0; j < dim; ++j) {
+        const c64 v = a[((base + off[j]) << lane_bits) + lane];
+        vr[j] = v.real(); vi[j] = v.imag();
+      }
+      for (std::size_t r = 0; r < dim; ++r) {
+        T accr = 0, acci = 0;
+        for (std::size_t j = 0; j < dim; ++j) {
+          const T mr = mb[r * dim + j].real(), mi = mb[r * dim + j].imag();
+          accr += mr * vr[j] - mi * vi[j];
+          acci += mr * vi[j] + mi * vr[j];
+        }
+        a[((base + off[r]) << lane_bits) + lane] = c64(accr, acci);
+      }
+    }
+  }
+}
+
+void apply_kq_lanes(Isa isa, c64* a, std::size_t n, std::size_t lane_bits, const std::size_t* qubits, std::size_t k,
+                    const c64* m) {
+  if (lane_bits == 0) {
+    apply_kq(isa, a, n, qubits, k, m);
+    return;
+  }
+  if (k == 0 || k > kMaxDenseQubits) return;
+#ifdef QSX_SIMD_X86
+  if (isa == Isa::AVX512 && avx512::kernel_kq_lanes<Avx512V>(a, n, lane_bits, qubits, k, m)) return;
+  if (isa != Isa::Scalar && avx2::kernel_kq_lanes<Avx2V>(a, n, lane_bits, qubits, k, m)) return;
+#else
+  (void)isa;
+#endif
+  switch (k) {
+    case 1: dense_kq_lanes<1>(a, n, lane_bits, qubits, m); break;
+    case 2: dense_kq_lanes<2>(a, n, lane_bits, qubits, m); break;
+    case 3: dense_kq_lanes<3>(a, n, lane_bits, qubits, m); break;
+    case 4: dense_kq_lanes<4>(a, n, lane_bits, qubits, m); break;
+    default: dense_kq_lanes<5>(a, n, lane_bits, qubits, m); break;
+  }
+}
+
+void apply_x(c64* a, std::size_t n, std::size_t target) {
+  for_each_pair(n, target, [=](std::size_t i, std::size_t j) {
+    std::swap(a[i], a[j]);
+  });
+}
+
+void apply_cx(c64* a, std::size_t n, std::size_t control, std::size_t target) {
+  if (control == target) return;
+  for_each_controlled_pair(n, control, target, [=](std::size_t i, std::size_t j) {
+    std::swap(a[i], a[j]);
+  });
+}
+
+void apply_swap(c64* a, std::size_t n, std::size_t q0, std::size_t q1) {
+  if (q0 == q1) return;
+  const std::size_t quarter = (std::size_t(1) << n) >> 2;
+  const std::size_t m0 = std::size_t(1) << q0;
+  const std::size_t m1 = std::size_t(1) << q1;
+  const std::size_t lo = std::min(q0, q1), hi = std::max(q0, q1);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::size_t k = 0; k < quarter; ++k) {
+    const std::size_t i = insert_zero_bit(insert_zero_bit(k, lo), hi);
+    std::swap(a[i | m0], a[i | m1]);
+  }
+}
+
+void apply_mcx(c64* a, std::size_t n, std::size_t control_mask, std::size_t target) {
+  const std::size_t tm = std::size_t(1) << target;
+  control_mask &= ~tm;
+  std::size_t bits[64];
+  const std::size_t nb = gate_bits(&target, 1, control_mask, bits);
+  const std::ptrdiff_t groups = std::ptrdiff_t((std::size_t(1) << n) >> nb);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t g = 0; g < groups; ++g) {
+    const std::size_t i = insert_zero_bits(std::size_t(g), bits, nb) | control_mask;
+    std::swap(a[i], a[i | tm]);
+  }
+}
+
+void apply_mcphase(c64* a, std::size_t n, std::size_t mask, c64 phase) {
+  std::size_t bits[64];
+  const std::size_t nb = gate_bits(nullptr, 0, mask, bits);
+  const std::ptrdiff_t count = std::ptrdiff_t((std::size_t(1) << n) >> nb);
+  const bool flip = (phase == c64{-1, 0});
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t g = 0; g < count; ++g) {
+    const std::size_t i = insert_zero_bits(std::size_t(g), bits, nb) | mask;
+    a[i] = flip ? -a[i] : a[i] * phase;
+  }
+}
+
+} // namespace qsx::kernels
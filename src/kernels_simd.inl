@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: MIT
+//
+// Vector gate kernels, included once per instruction set from kernels.cpp with QSX_TARGET set to
+// the matching function attribute. V is a register traits type (see avx2::D and friends).
+// Every kernel returns false when the shape is not covered so the caller can use the scalar path.
+
+// out = c1 * v + c2 * (v with lanes j and j ^ s exchanged)
+template <class V>
+QSX_TARGET static inline typename V::R lane_mix(typename V::R v, std::size_t s,
+                                                const LaneCoeffs<typename V::T, V::L>& c1,
+                                                const LaneCoeffs<typename V::T, V::L>& c2) {
+  return V::add(V::cmul(v, V::loada(c1.re), V::loada(c1.im)),
+                V::cmul(V::lane_swap(v, s), V::loada(c2.re), V::loada(c2.im)));
+}
+
+// Coefficients of a 2x2 matrix for pairs that live inside one register (stride s < L)
+template <class V>
+static inline void lane_coeffs(std::size_t s, const c64 u[4],
+                               LaneCoeffs<typename V::T, V::L>& c1, LaneCoeffs<typename V::T, V::L>& c2) {
+  for (std::size_t j = 0; j < V::L; ++j) {
+    const bool one = (j & s) != 0;
+    c1.set(j, one ? u[3] : u[0]);
+    c2.set(j, one ? u[2] : u[1]);
+  }
+}
+
+template <class V>
+QSX_TARGET static bool kernel_1q(c64* a, std::size_t n, std::size_t target, const c64 u[4]) {
+  using R = typename V::R;
+  constexpr std::size_t L = V::L;
+  const std::size_t N = std::size_t(1) << n;
+  const std::size_t stride = std::size_t(1) << target;
+  if (N < L) return false;
+  if (stride >= L) {
+    const R r00 = V::set1(u[0].real()), i00 = V::set1(u[0].imag());
+    const R r01 = V::set1(u[1].real()), i01 = V::set1(u[1].imag());
+    const R r10 = V::set1(u[2].real()), i10 = V::set1(u[2].imag());
+    const R r11 = V::set1(u[3].real()), i11 = V::set1(u[3].imag());
+    const std::ptrdiff_t blocks = std::ptrdiff_t(N / 2 / L);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (std::ptrdiff_t b = 0; b < blocks; ++b) {
+      c64* p0 = a + insert_zero_bit(std::size_t(b) * L, target);
+      c64* p1 = p0 + stride;
+      const R a0 = V::load(p0), a1 = V::load(p1);
+      V::store(p0, V::add(V::cmul(a0, r00, i00), V::cmul(a1, r01, i01)));
+      V::store(p1, V::add(V::cmul(a0, r10, i10), V::cmul(a1, r11, i11)));
+    }
+    return true;
+  }
+  LaneCoeffs<typename V::T, L> c1, c2;
+  lane_coeffs<V>(stride, u, c1, c2);
+  const std::ptrdiff_t regs = std::ptrdiff_t(N / L);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t b = 0; b < regs; ++b) {
+    c64* p = a + std::size_t(b) * L;
+    V::store(p, lane_mix<V>(V::load(p), stride, c1, c2));
+  }
+  return true;
+}
+
+template <class V>
+QSX_TARGET static bool kernel_controlled_1q(c64* a, std::size_t n, std::size_t control, std::size_t target,
+                                            const c64 u[4]) {
+  using R = typename V::R;
+  constexpr std::size_t L = V::L;
+  const std::size_t N = std::size_t(1) << n;
+  const std::size_t cm = std::size_t(1) << control;
+  const std::size_t tm = std::size_t(1) << target;
+  const std::size_t lo = std::min(control, target), hi = std::max(control, target);
+  if ((std::size_t(1) << lo) >= L) {
+    // Both bits above the register width: L consecutive bases per block
+    const R r00 = V::set1(u[0].real()), i00 = V::set1(u[0].imag());
+    const R r01 = V::set1(u[1].real()), i01 = V::set1(u[1].imag());
+    const R r10 = V::set1(u[2].real()), i10 = V::set1(u[2].imag());
+    const R r11 = V::set1(u[3].real()), i11 = V::set1(u[3].imag());
+    const std::ptrdiff_t blocks = std::ptrdiff_t(N / 4 / L);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (std::ptrdiff_t b = 0; b < blocks; ++b) {
+      c64* p0 = a + (insert_zero_bit(insert_zero_bit(std::size_t(b) * L, lo), hi) | cm);
+      c64* p1 = p0 + tm;
+      const R a0 = V::load(p0), a1 = V::load(p1);
+      V::store(p0, V::add(V::cmul(a0, r00, i00), V::cmul(a1, r01, i01)));
+      V::store(p1, V::add(V::cmul(a0, r10, i10), V::cmul(a1, r11, i11)));
+    }
+    return true;
+  }
+  if (cm >= L) {
+    // Target inside the register, control above it: whole registers with control = 1
+    LaneCoeffs<typename V::T, L> c1, c2;
+    lane_coeffs<V>(tm, u, c1, c2);
+    const std::ptrdiff_t regs = std::ptrdiff_t(N / 2 / L);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (std::ptrdiff_t b = 0; b < regs; ++b) {
+      c64* p = a + (insert_zero_bit(std::size_t(b) * L, control) | cm);
+      V::store(p, lane_mix<V>(V::load(p), tm, c1, c2));
+    }
+    return true;
+  }
+  return false;
+}
+
+template <class V>
+QSX_TARGET static bool kernel_diag_1q(c64* a, std::size_t n, std::size_t target, c64 d0, c64 d1) {
+  using R = typename V::R;
+  constexpr std::size_t L = V::L;
+  const std::size_t N = std::size_t(1) << n;
+  const std::size_t stride = std::size_t(1) << target;
+  if (N < L) return false;
+  if (stride >= L) {
+    // diag(1, d1) only touches the |1> half
+    const bool skip0 = (d0 == c64{1, 0});
+    const R r0 = V::set1(d0.real()), i0 = V::set1(d0.imag());
+    const R r1 = V::set1(d1.real()), i1 = V::set1(d1.imag());
+    const std::ptrdiff_t blocks = std::ptrdiff_t(N / 2 / L);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (std::ptrdiff_t b = 0; b < blocks; ++b) {
+      c64* p0 = a + insert_zero_bit(std::size_t(b) * L, target);
+      c64* p1 = p0 + stride;
+      if (!skip0) V::store(p0, V::cmul(V::load(p0), r0, i0));
+      V::store(p1, V::cmul(V::load(p1), r1, i1));
+    }
+    return true;
+  }
+  LaneCoeffs<typename V::T, L> c;
+  for (std::size_t j = 0; j < L; ++j) c.set(j, (j & stride) ? d1 : d0);
+  const std::ptrdiff_t regs = std::ptrdiff_t(N / L);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t b = 0; b < regs; ++b) {
+    c64* p = a + std::size_t(b) * L;
+    V::store(p, V::cmul(V::load(p), V::loada(c.re), V::loada(c.im)));
+  }
+  return true;
+}
+
+// Dense k-qubit block with optional controls. Needs every target and control bit >= log2(L) so
+// that L consecutive groups have L consecutive base indices; each register then carries the same
+// matrix row for L independent groups.
+template <class V, std::size_t K>
+QSX_TARGET static bool kernel_kq(c64* a, std::size_t n, const std::size_t* qubits, std::size_t control_mask,
+                                 const c64* m) {
+  using R = typename V::R;
+  using T = typename V::T;
+  constexpr std::size_t L = V::L;
+  constexpr std::size_t dim = std::size_t(1) << K;
+  std::size_t bits[64];
+  const std::size_t nb = gate_bits(qubits, K, control_mask, bits);
+  if ((std::size_t(1) << bits[0]) < L) return false;
+  std::size_t off[dim];
+  for (std::size_t j = 0; j < dim; ++j) {
+    off[j] = 0;
+    for (std::size_t b = 0; b < K; ++b) off[j] |= ((j >> b) & 1) << qubits[b];
+  }
+  T mre[dim * dim], mim[dim * dim];
+  for (std::size_t i = 0; i < dim * dim; ++i) { mre[i] = m[i].real(); mim[i] = m[i].imag(); }
+  const T* pr = mre;
+  const T* pi = mim;
+  const std::ptrdiff_t blocks = std::ptrdiff_t(((std::size_t(1) << n) >> nb) / L);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t b = 0; b < blocks; ++b) {
+    const std::size_t base = insert_zero_bits(std::size_t(b) * L, bits, nb) | control_mask;
+    R v[dim];
+    for (std::size_t j = 0; j < dim; ++j) v[j] = V::load(a + base + off[j]);
+    for (std::size_t r = 0; r < dim; ++r) {
+      R acc = V::cmul(v[0], V::set1(pr[r * dim]), V::set1(pi[r * dim]));
+      for (std::size_t j = 1; j < dim; ++j)
+        acc = V::add(acc, V::cmul(v[j], V::set1(pr[r * dim + j]), V::set1(pi[r * dim + j])));
+      V::store(a + base + off[r], acc);
+    }
+  }
+  return true;
+}
+
+template <class V>
+QSX_TARGET static bool kernel_kq(c64* a, std::size_t n, const std::size_t* qubits, std::size_t k,
+                                 std::size_t control_mask, const c64* m) {
+  switch (k) {
+    case 1: return kernel_kq<V, 1>(a, n, qubits, control_mask, m);
+    case 2: return kernel_kq<V, 2>(a, n, qubits, control_mask, m);
+    case 3: return kernel_kq<V, 3>(a, n, qubits, control_mask, m);
+    case 4: return kernel_kq<V, 4>(a, n, qubits, control_mask, m);
+    case 5: return kernel_kq<V, 5>(a, n, qubits, control_mask, m);
+    default: return false;
+  }
+}
+
+// Batched states with a matrix per state (kernels.hpp, apply_kq_lanes). Needs at least L states:
+// a register then holds the same amplitude of L consecutive states, and the coefficients are laid
+// out state by state as duplicated (re, re) / (im, im) pairs so that L states load as one register.
+// Groups are walked in runs of up to 2^kPairRunBits consecutive ones (the free bits below the
+// lowest target), so each run is one contiguous sweep over its states.
+template <class V, std::size_t K>
+QSX_TARGET static bool kernel_kq_lanes(c64* a, std::size_t n, std::size_t lane_bits, const std::size_t* qubits,
+                                       const c64* m) {
+  using R = typename V::R;
+  using T = typename V::T;
+  using C = std::complex<T>;
+  constexpr std::size_t L = V::L;
+  constexpr std::size_t dim = std::size_t(1) << K;
+  const std::size_t B = std::size_t(1) << lane_bits;
+  if (B < L) return false;
+  // Registers per block of L states, in a local buffer so that stores to `a` do not force
+  // reloads; the heap only for wide batches of large gates
+  struct Coef { R re, im; };
+  constexpr std::size_t kStack = 64;
+  const std::size_t blocks = B / L, count = dim * dim * blocks;
+  Coef stack[kStack];
+  std::vector<T> heap;
+  Coef* coef = stack;
+  if (count > kStack) {
+    // Over-allocated by one Coef and aligned by hand: Coef is over-aligned for the allocator
+    heap.resize((count + 1) * sizeof(Coef) / sizeof(T));
+    void* p = heap.data();
+    std::size_t space = heap.size() * sizeof(T);
+    coef = static_cast<Coef*>(std::align(alignof(Coef), count * sizeof(Coef), p, space));
+  }
+  for (std::size_t blk = 0; blk < blocks; ++blk)
+    for (std::size_t e = 0; e < dim * dim; ++e) {
+      C re[L], im[L];
+      for (std::size_t l = 0; l < L; ++l) {
+        const c64 x = m[(blk * L + l) * dim * dim + e];
+        re[l] = C(x.real(), x.real());
+        im[l] = C(x.imag(), x.imag());
+      }
+      coef[blk * dim * dim + e] = {V::load(re), V::load(im)};
+    }
+  std::size_t off[dim];
+  std::size_t low = n;
+  for (std::size_t j = 0; j < dim; ++j) {
+    off[j] = 0;
+    for (std::size_t b = 0; b < K; ++b) off[j] |= ((j >> b) & 1) << qubits[b];
+  }
+  for (std::size_t b = 0; b < K; ++b) low = std::min(low, qubits[b]);
+  std::size_t bits[64];
+  const std::size_t nb = gate_bits(qubits, K, 0, bits);
+  const std::size_t rb = std::min(low, kPairRunBits);
+  const std::size_t run = B << rb;
+  const std::ptrdiff_t runs = std::ptrdiff_t(((std::size_t(1) << n) >> nb) >> rb);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t g = 0; g < runs; ++g) {
+    c64* p = a + (insert_zero_bits(std::size_t(g) << rb, bits, nb) << lane_bits);
+    for (std::size_t t = 0; t < run; t += L) {
+      const Coef* c = coef + ((t & (B - 1)) / L) * dim * dim;
+      R v[dim];
+      for (std::size_t j = 0; j < dim; ++j) v[j] = V::load(p + (off[j] << lane_bits) + t);
+      for (std::size_t r = 0; r < dim; ++r) {
+        R acc = V::cmul(v[0], c[r * dim].re, c[r * dim].im);
+        for (std::size_t j = 1; j < dim; ++j) acc = V::add(acc, V::cmul(v[j], c[r * dim + j].re, c[r * dim + j].im));
+        V::store(p + (off[r] << lane_bits) + t, acc);
+      }
+    }
+  }
+  return true;
+}
+
+template <class V>
+QSX_TARGET static bool kernel_kq_lanes(c64* a, std::size_t n, std::size_t lane_bits, const std::size_t* qubits,
+                                       std::size_t k, const c64* m) {
+  switch (k) {
+    case 1: return kernel_kq_lanes<V, 1>(a, n, lane_bits, qubits, m);
+    case 2: return kernel_kq_lanes<V, 2>(a, n, lane_bits, qubits, m);
+    case 3: return kernel_kq_lanes<V, 3>(a, n, lane_bits, qubits, m);
+    case 4: return kernel_kq_lanes<V, 4>(a, n, lane_bits, qubits, m);
+    case 5: return kernel_kq_lanes<V, 5>(a, n, lane_bits, qubits, m);
+    default: return false;
+  }
+}
@@ -14,8 +14,8 @@ Circuit optimize(const Circuit& in, OptimizeOptions opts){
   out.ops.reserve(in.ops.size());
   // First pass: merge and cancel on the fly for single-qubit gates per target
   for (const auto& op : in.ops){
-    if (op.type==OpType::MEASURE || op.type==OpType::CNOT || op.type==OpType::DEPHASE || op.type==OpType::DEPOL || op.type==OpType::AMPDAMP){
-      // handle 2q and noise ops verbatim
+    if (op.type==OpType::MEASURE || op.qubits.size()!=1 || op.type==OpType::DEPHASE || op.type==OpType::DEPOL || op.type==OpType::AMPDAMP){
+      // handle multi-qubit and noise ops verbatim
       out.ops.push_back(op);
       continue;
     }
@@ -29,8 +29,16 @@ Circuit optimize(const Circuit& in, OptimizeOptions opts){
       if ((prev.type==OpType::RZ && op.type==OpType::RZ) ||
           (prev.type==OpType::RX && op.type==OpType::RX) ||
           (prev.type==OpType::RY && op.type==OpType::RY)){
-        prev.angle += op.angle;
-        continue;
+        // Named parameters merge with literals and with themselves: the sum stays affine in one parameter
+        if (prev.param.empty() || op.param.empty() || prev.param == op.param){
+          prev.angle += op.angle;
+          if (!op.param.empty()){
+            prev.param_scale = prev.param.empty() ? op.param_scale : prev.param_scale + op.param_scale;
+            prev.param = op.param;
+          }
+          if (!prev.param.empty() && prev.param_scale == 0.0){ prev.param.clear(); prev.param_scale = 1.0; }
+          continue;
+        }
       }
     }
     if (opts.cancel_involutory && is_involutory(prev.type) && prev.type==op.type){
@@ -49,7 +57,7 @@ Circuit optimize(const Circuit& in, OptimizeOptions opts){
   Circuit out2; out2.nqubits = out.nqubits;
   for (size_t i=0;i<out.ops.size();++i){
     const auto& op = out.ops[i];
-    if ((op.type==OpType::RX || op.type==OpType::RY || op.type==OpType::RZ) && std::fabs(op.angle) < 1e-15) continue;
+    if ((op.type==OpType::RX || op.type==OpType::RY || op.type==OpType::RZ) && op.param.empty() && std::fabs(op.angle) < 1e-15) continue;
     if (opts.cancel_cnot_pairs && op.type==OpType::CNOT && i+1<out.ops.size()){
       const auto& op2 = out.ops[i+1];
       if (op2.type==OpType::CNOT && op.qubits==op2.qubits){
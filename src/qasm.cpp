@@ -5,6 +5,7 @@
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <cmath>
 
 namespace qsx {
 static std::string trim(const std::string& s){
@@ -13,9 +14,57 @@ static std::string trim(const std::string& s){
   if (l>=r) return "";
   return std::string(l,r);
 }
-std::optional<Circuit> parse_qasm_file(const std::string& path, std::string& err){
-  std::ifstream in(path);
-  if (!in){ err="Cannot open QASM file"; return std::nullopt; }
+// Qubit indices of all q[i] operands in order
+static std::vector<size_t> qubit_args(const std::string& argstr){
+  std::vector<size_t> qs;
+  for (auto p = argstr.find('['); p != std::string::npos; p = argstr.find('[', p+1)){
+    auto e = argstr.find(']', p);
+    qs.push_back(std::stoull(argstr.substr(p+1, e-p-1)));
+  }
+  return qs;
+}
+// A literal value: a number, or numbers and pi multiplied together with at most one divisor
+// ("pi/2", "-3*pi/4", "0.5*pi"), as standard QASM writes angles
+static bool parse_real(std::string s, double& v){
+  s.erase(std::remove_if(s.begin(), s.end(), [](unsigned char ch){ return std::isspace(ch); }), s.end());
+  double sign = 1.0;
+  if (!s.empty() && (s[0]=='-' || s[0]=='+')){ if (s[0]=='-') sign = -1.0; s.erase(0, 1); }
+  auto product = [](const std::string& t, double& x){
+    std::stringstream ss(t);
+    x = 1.0;
+    std::size_t count = 0;
+    for (std::string f; std::getline(ss, f, '*'); ++count){
+      if (f == "pi"){ x *= M_PI; continue; }
+      try {
+        std::size_t pos = 0;
+        x *= std::stod(f, &pos);
+        const char last = f.back(); // rejects "inf" and "nan"
+        if (pos != f.size() || (!std::isdigit((unsigned char)last) && last != '.')) return false;
+      } catch (...) { return false; }
+    }
+    return count > 0 && t.back() != '*';
+  };
+  const auto slash = s.find('/');
+  double num = 0.0, den = 1.0;
+  if (s.empty() || !product(s.substr(0, slash), num)) return false;
+  if (slash != std::string::npos && (!product(s.substr(slash + 1), den) || den == 0.0)) return false;
+  v = sign * num / den;
+  return true;
+}
+// Comma-separated values between the parentheses; false if one is not a literal (parse_real)
+static bool paren_args(const std::string& line, std::vector<double>& v){
+  v.clear();
+  auto lp = line.find('('), rp = line.find(')');
+  if (lp == std::string::npos || rp == std::string::npos || rp < lp) return false;
+  std::stringstream ss(line.substr(lp+1, rp-lp-1));
+  for (std::string tok; std::getline(ss, tok, ',');){
+    double x;
+    if (!parse_real(tok, x)) return false;
+    v.push_back(x);
+  }
+  return true;
+}
+static std::optional<Circuit> parse_qasm_stream(std::istream& in, std::string& err){
   Circuit c; c.nqubits=0;
   std::string line;
   size_t qcount=0;
@@ -34,7 +83,7 @@ std::optional<Circuit> parse_qasm_file(const std::string& path, std::string& err
     auto par = line.find('(');
     std::string op = line.substr(0, par==std::string::npos? line.find(' '): par);
     std::transform(op.begin(), op.end(), op.begin(), ::tolower);
-    auto argstr = line.substr(line.find(' ')+1);
+    auto argstr = line.substr(par==std::string::npos ? line.find(' ')+1 : line.find(')')+1);
     auto q1p = argstr.find('['); auto q1e = argstr.find(']');
     if (q1p==std::string::npos) { err="No target qubit"; return std::nullopt; }
     size_t q1 = std::stoull(argstr.substr(q1p+1, q1e-q1p-1));
@@ -42,13 +91,39 @@ std::optional<Circuit> parse_qasm_file(const std::string& path, std::string& err
       c.ops.push_back({ op=="h"?OpType::H: op=="x"?OpType::X: op=="y"?OpType::Y: op=="z"?OpType::Z: OpType::S, {q1}, 0.0 });
     } else if (op=="rz"||op=="rx"||op=="ry"){
       auto lp = line.find('('), rp = line.find(')');
-      double ang = std::stod(line.substr(lp+1, rp-lp-1));
-      c.ops.push_back({ op=="rz"?OpType::RZ: op=="rx"?OpType::RX: OpType::RY, {q1}, ang });
+      std::string ang = line.substr(lp+1, rp-lp-1);
+      ang.erase(std::remove_if(ang.begin(), ang.end(), [](unsigned char ch){ return std::isspace(ch); }), ang.end());
+      Op r{ op=="rz"?OpType::RZ: op=="rx"?OpType::RX: OpType::RY, {q1}, 0.0 };
+      double lit;
+      if (parse_real(ang, lit)) r.angle = lit;
+      else if (!parse_angle(ang, r)){ err = "Invalid angle for " + op + ": " + ang; return std::nullopt; }
+      c.ops.push_back(std::move(r));
     } else if (op=="cx"){
       auto comma = argstr.find(',');
       auto q2p = argstr.find('[', comma); auto q2e = argstr.find(']', q2p);
       size_t q2 = std::stoull(argstr.substr(q2p+1, q2e-q2p-1));
       c.ops.push_back({OpType::CNOT,{q1,q2},0.0});
+    } else if (op=="ccx"||op=="cz"||op=="swap"){
+      auto qs = qubit_args(argstr);
+      if (qs.size() != (op=="ccx" ? 3u : 2u)){ err = "Wrong operand count for " + op; return std::nullopt; }
+      c.ops.push_back({ op=="ccx"?OpType::CCX: op=="cz"?OpType::CZ: OpType::SWAP, qs, 0.0 });
+      for (auto q : qs) q1 = std::max(q1, q);
+    } else if (op=="u3"||op=="u"){
+      std::vector<double> p;
+      if (!paren_args(line, p) || p.size() != 3){ err = "u3 needs three numeric parameters"; return std::nullopt; }
+      c.ops.push_back({OpType::U3,{q1},0.0,p});
+    } else if (op=="dephase"||op=="depol"||op=="ampdamp"){
+      // Non-standard noise statements: dephase(p) q[i]; depol(p) q[i]; ampdamp(gamma) q[i];
+      std::vector<double> p;
+      if (!paren_args(line, p) || p.size() != 1 || p[0] < 0.0 || p[0] > 1.0){ err = op + " needs one probability in [0,1]"; return std::nullopt; }
+      c.ops.push_back({ op=="dephase"?OpType::DEPHASE: op=="depol"?OpType::DEPOL: OpType::AMPDAMP, {q1}, p[0] });
+    } else if (op=="u2q"){
+      // Non-standard: u2q(32 values: 4x4 row-major re,im pairs) q[a], q[b]; local bit 0 = q[a]
+      std::vector<double> p;
+      auto qs = qubit_args(argstr);
+      if (!paren_args(line, p) || p.size() != 32 || qs.size() != 2 || qs[0] == qs[1]){ err = "u2q needs 32 parameters and two distinct qubits"; return std::nullopt; }
+      c.ops.push_back({OpType::U2Q,qs,0.0,p});
+      q1 = std::max(qs[0], qs[1]);
     } else {
       err = "Unsupported op: " + op;
       return std::nullopt;
@@ -57,4 +132,13 @@ std::optional<Circuit> parse_qasm_file(const std::string& path, std::string& err
   }
   return c;
 }
+std::optional<Circuit> parse_qasm_file(const std::string& path, std::string& err){
+  std::ifstream in(path);
+  if (!in){ err="Cannot open QASM file"; return std::nullopt; }
+  return parse_qasm_stream(in, err);
+}
+std::optional<Circuit> parse_qasm_string(const std::string& text, std::string& err){
+  std::istringstream in(text);
+  return parse_qasm_stream(in, err);
+}
 } // namespace qsx
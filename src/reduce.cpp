@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/reduce.hpp"
+#include <algorithm>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+namespace qsx {
+
+using real = c64::value_type;
+
+static std::size_t chunks_of(std::size_t N) { return (N + kReduceChunk - 1) / kReduceChunk; }
+
+double norm_squared(const c64* a, std::size_t N) {
+  const std::size_t nchunks = chunks_of(N);
+  std::vector<double> part(nchunks, 0.0);
+  const real* d = reinterpret_cast<const real*>(a);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t k = 0; k < (std::ptrdiff_t)nchunks; ++k) {
+    const std::size_t lo = 2 * std::size_t(k) * kReduceChunk, hi = 2 * std::min(N, std::size_t(k + 1) * kReduceChunk);
+    // Four independent accumulators: breaks the add dependency chain and lets the loop vectorise
+    double s[4] = {0.0, 0.0, 0.0, 0.0};
+    std::size_t i = lo;
+    for (; i + 4 <= hi; i += 4)
+      for (std::size_t l = 0; l < 4; ++l) s[l] += double(d[i + l]) * double(d[i + l]);
+    for (; i < hi; ++i) s[0] += double(d[i]) * double(d[i]);
+    part[k] = (s[0] + s[1]) + (s[2] + s[3]);
+  }
+  double total = 0.0;
+  for (double v : part) total += v;
+  return total;
+}
+
+std::complex<double> inner_product(const c64* a, const c64* b, std::size_t N) {
+  const std::size_t nchunks = chunks_of(N);
+  std::vector<std::complex<double>> part(nchunks);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t k = 0; k < (std::ptrdiff_t)nchunks; ++k) {
+    const std::size_t lo = std::size_t(k) * kReduceChunk, hi = std::min(N, lo + kReduceChunk);
+    double re = 0.0, im = 0.0;
+    for (std::size_t i = lo; i < hi; ++i) {
+      const double ar = a[i].real(), ai = a[i].imag(), br = b[i].real(), bi = b[i].imag();
+      re += ar * br + ai * bi;
+      im += ar * bi - ai * br;
+    }
+    part[k] = {re, im};
+  }
+  std::complex<double> total{0.0, 0.0};
+  for (const auto& v : part) total += v;
+  return total;
+}
+
+void scale_amplitudes(c64* a, std::size_t N, double s) {
+  real* d = reinterpret_cast<real*>(a);
+  const real f = real(s);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t i = 0; i < (std::ptrdiff_t)(2 * N); ++i) d[i] *= f;
+}
+
+std::vector<double> probabilities(const vec_c64& a) {
+  std::vector<double> p(a.size());
+  const real* d = reinterpret_cast<const real*>(a.data());
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t i = 0; i < (std::ptrdiff_t)a.size(); ++i)
+    p[i] = double(d[2 * i]) * double(d[2 * i]) + double(d[2 * i + 1]) * double(d[2 * i + 1]);
+  return p;
+}
+
+// Chunks are power-of-two aligned, so bits >= c of the index are constant inside a chunk and
+// their marginals follow from the chunk totals. The c low bits are folded pairwise: level q
+// adds the odd entries (bit q set) to p1[q] and halves the buffer, 2 * 2^c additions in total.
+template <class Load>
+static double marginals_impl(Load load, std::size_t n, double* p1) {
+  const std::size_t N = std::size_t(1) << n;
+  const std::size_t c = std::min(n, kReduceChunkBits);
+  const std::size_t C = std::size_t(1) << c, nchunks = N >> c;
+  std::vector<double> totals(nchunks), lows(nchunks * c);
+#ifdef QSX_OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<double> buf(std::max<std::size_t>(C / 2, 1));
+#ifdef QSX_OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (std::ptrdiff_t k = 0; k < (std::ptrdiff_t)nchunks; ++k) {
+      const std::size_t lo = std::size_t(k) << c;
+      double* ones = lows.data() + std::size_t(k) * c;
+      if (c == 0) { totals[k] = load(lo); continue; }
+      double o = 0.0;
+      for (std::size_t j = 0; j < C / 2; ++j) {
+        const double x0 = load(lo + 2 * j), x1 = load(lo + 2 * j + 1);
+        o += x1;
+        buf[j] = x0 + x1;
+      }
+      ones[0] = o;
+      for (std::size_t q = 1, len = C / 2; q < c; ++q, len /= 2) {
+        o = 0.0;
+        for (std::size_t j = 0; j < len / 2; ++j) {
+          o += buf[2 * j + 1];
+          buf[j] = buf[2 * j] + buf[2 * j + 1];
+        }
+        ones[q] = o;
+      }
+      totals[k] = buf[0];
+    }
+  }
+  double total = 0.0;
+  std::fill(p1, p1 + n, 0.0);
+  for (std::size_t k = 0; k < nchunks; ++k) {
+    total += totals[k];
+    for (std::size_t q = 0; q < c; ++q) p1[q] += lows[k * c + q];
+    for (std::size_t q = c; q < n; ++q)
+      if ((k >> (q - c)) & 1) p1[q] += totals[k];
+  }
+  return total;
+}
+
+double marginals_one(const double* p, std::size_t n, double* p1) {
+  return marginals_impl([p](std::size_t i) { return p[i]; }, n, p1);
+}
+
+double marginals_one(const c64* a, std::size_t n, double* p1) {
+  return marginals_impl([a](std::size_t i) {
+    const double re = a[i].real(), im = a[i].imag();
+    return re * re + im * im;
+  }, n, p1);
+}
+
+static std::vector<double> z_from_marginals(double total, std::vector<double> p1) {
+  for (auto& v : p1) v = total - 2.0 * v;
+  return p1;
+}
+
+std::vector<double> expect_z_all(const std::vector<double>& p, std::size_t n) {
+  std::vector<double> p1(n);
+  const double total = marginals_one(p.data(), n, p1.data());
+  return z_from_marginals(total, std::move(p1));
+}
+
+std::vector<double> expect_z_all(const vec_c64& a, std::size_t n) {
+  std::vector<double> p1(n);
+  const double total = marginals_one(a.data(), n, p1.data());
+  return z_from_marginals(total, std::move(p1));
+}
+
+void reduced_density(const c64* a, std::size_t n, const std::size_t* qubits, std::size_t k, c64* rho) {
+  const std::size_t d = std::size_t(1) << k, groups = std::size_t(1) << (n - k);
+  std::size_t off[4] = {0, 0, 0, 0}, sorted[2] = {qubits[0], k > 1 ? qubits[1] : 0};
+  for (std::size_t l = 0; l < d; ++l)
+    for (std::size_t j = 0; j < k; ++j) if ((l >> j) & 1) off[l] |= std::size_t(1) << qubits[j];
+  if (k > 1 && sorted[0] > sorted[1]) std::swap(sorted[0], sorted[1]);
+  // Upper triangle per chunk of groups (2^k amplitudes that differ only in the reduced qubits)
+  const std::size_t nchunks = chunks_of(groups);
+  std::vector<std::complex<double>> part(nchunks * 16);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t ch = 0; ch < (std::ptrdiff_t)nchunks; ++ch) {
+    std::complex<double> acc[16] = {};
+    const std::size_t lo = std::size_t(ch) * kReduceChunk, hi = std::min(groups, lo + kReduceChunk);
+    for (std::size_t g = lo; g < hi; ++g) {
+      std::size_t base = g;
+      for (std::size_t j = 0; j < k; ++j)
+        base = ((base >> sorted[j]) << (sorted[j] + 1)) | (base & ((std::size_t(1) << sorted[j]) - 1));
+      std::complex<double> v[4];
+      for (std::size_t l = 0; l < d; ++l) v[l] = std::complex<double>(a[base + off[l]]);
+      for (std::size_t r = 0; r < d; ++r)
+        for (std::size_t c = r; c < d; ++c) acc[r * d + c] += v[r] * std::conj(v[c]);
+    }
+    std::copy(acc, acc + 16, part.begin() + 16 * ch);
+  }
+  std::complex<double> sum[16] = {};
+  for (std::size_t ch = 0; ch < nchunks; ++ch)
+    for (std::size_t e = 0; e < 16; ++e) sum[e] += part[16 * ch + e];
+  for (std::size_t r = 0; r < d; ++r)
+    for (std::size_t c = 0; c < d; ++c)
+      rho[r * d + c] = c64(r <= c ? sum[r * d + c] : std::conj(sum[c * d + r]));
+}
+
+} // namespace qsx
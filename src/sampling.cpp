@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/sampling.hpp"
+#include <algorithm>
+#include <numeric>
+#include <cstddef>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+namespace qsx {
+
+// Fixed chunk size so partial sums (and therefore the CDF) do not depend on the thread count.
+static constexpr std::size_t kCdfChunk = std::size_t(1) << 14;
+
+AliasSampler::AliasSampler(const std::vector<double>& p) : prob_(p.size(), 0.0), alias_(p.size(), 0) {
+  const std::size_t N = p.size();
+  if (N == 0) return;
+  double total = 0.0;
+  for (double v : p) total += v;
+  if (total <= 0.0) { std::fill(prob_.begin(), prob_.end(), 1.0); return; }
+  // Vose's method: scaled probabilities, split into under- and over-full columns.
+  std::vector<double> q(N);
+  std::vector<std::uint64_t> small, large;
+  small.reserve(N); large.reserve(N);
+  const double scale = double(N) / total;
+  for (std::size_t i=0;i<N;++i){
+    q[i] = p[i] * scale;
+    (q[i] < 1.0 ? small : large).push_back(i);
+  }
+  while (!small.empty() && !large.empty()){
+    std::uint64_t s = small.back(); small.pop_back();
+    std::uint64_t l = large.back();
+    prob_[s] = q[s];
+    alias_[s] = l;
+    q[l] = (q[l] + q[s]) - 1.0;
+    if (q[l] < 1.0){ large.pop_back(); small.push_back(l); }
+  }
+  // Leftovers are full columns up to rounding.
+  for (auto l : large){ prob_[l] = 1.0; alias_[l] = l; }
+  for (auto s : small){ prob_[s] = 1.0; alias_[s] = s; }
+}
+
+std::uint64_t AliasSampler::sample(Rng& rng) const {
+  const std::size_t N = prob_.size();
+  double u = rng.uniform() * double(N);
+  std::size_t i = std::min<std::size_t>(std::size_t(u), N-1);
+  double frac = u - double(i);
+  return frac < prob_[i] ? i : alias_[i];
+}
+
+std::vector<double> build_cdf(const std::vector<double>& p){
+  const std::size_t N = p.size();
+  std::vector<double> cdf(N);
+  const std::size_t nchunks = (N + kCdfChunk - 1) / kCdfChunk;
+  std::vector<double> offs(nchunks, 0.0);
+  // Pass 1: local inclusive scan of every chunk
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t k=0;k<(std::ptrdiff_t)nchunks;++k){
+    const std::size_t lo = std::size_t(k)*kCdfChunk, hi = std::min(N, lo + kCdfChunk);
+    double acc = 0.0;
+    for (std::size_t i=lo;i<hi;++i){ acc += p[i]; cdf[i] = acc; }
+    offs[k] = acc;
+  }
+  // Exclusive scan of chunk totals (serial, nchunks is small)
+  double run = 0.0;
+  for (auto& o : offs){ double t = o; o = run; run += t; }
+  // Pass 2: shift every chunk by its offset
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::ptrdiff_t k=1;k<(std::ptrdiff_t)nchunks;++k){
+    const std::size_t lo = std::size_t(k)*kCdfChunk, hi = std::min(N, lo + kCdfChunk);
+    const double o = offs[k];
+    for (std::size_t i=lo;i<hi;++i) cdf[i] += o;
+  }
+  return cdf;
+}
+
+std::vector<std::uint64_t> sample_cdf(const std::vector<double>& p, std::size_t shots, Rng& rng){
+  std::vector<std::uint64_t> out(shots, 0);
+  if (p.empty()) return out;
+  auto cdf = build_cdf(p);
+  const double total = cdf.back();
+  for (std::size_t s=0;s<shots;++s){
+    double r = rng.uniform() * total;
+    auto it = std::upper_bound(cdf.begin(), cdf.end(), r);
+    out[s] = std::min<std::size_t>(std::size_t(it - cdf.begin()), cdf.size()-1);
+  }
+  return out;
+}
+
+std::vector<std::uint64_t> sample_sorted(const std::vector<double>& p, std::size_t shots, Rng& rng){
+  std::vector<std::uint64_t> out(shots, 0);
+  if (p.empty()) return out;
+  auto cdf = build_cdf(p);
+  const double total = cdf.back();
+  std::vector<double> r(shots);
+  for (std::size_t s=0;s<shots;++s) r[s] = rng.uniform() * total;
+  std::vector<std::size_t> order(shots);
+  std::iota(order.begin(), order.end(), std::size_t(0));
+  std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b){ return r[a] < r[b]; });
+  // Single forward sweep: same predicate as upper_bound in sample_cdf
+  const std::size_t last = cdf.size()-1;
+  std::size_t j = 0;
+  for (auto s : order){
+    while (j < last && cdf[j] <= r[s]) ++j;
+    out[s] = j;
+  }
+  return out;
+}
+
+std::vector<std::uint64_t> sample_alias(const std::vector<double>& p, std::size_t shots, Rng& rng){
+  std::vector<std::uint64_t> out(shots, 0);
+  if (p.empty()) return out;
+  AliasSampler table(p);
+  for (std::size_t s=0;s<shots;++s) out[s] = table.sample(rng);
+  return out;
+}
+
+SamplerKind choose_sampler(std::size_t n_outcomes, std::size_t shots){
+  if (shots == 0 || n_outcomes <= 1) return SamplerKind::Cdf;
+  // Many shots per outcome: the O(N) table build is amortized by O(1) draws.
+  if (shots >= n_outcomes) return SamplerKind::Alias;
+  // Large states: one streaming sweep beats K cache-missing binary searches.
+  if (n_outcomes >= (std::size_t(1) << 16) && shots >= 64) return SamplerKind::Sorted;
+  return SamplerKind::Cdf;
+}
+
+std::vector<std::uint64_t> sample_indices(const std::vector<double>& p, std::size_t shots, Rng& rng, SamplerKind kind){
+  if (kind == SamplerKind::Auto) kind = choose_sampler(p.size(), shots);
+  switch (kind){
+    case SamplerKind::Alias: return sample_alias(p, shots, rng);
+    case SamplerKind::Sorted: return sample_sorted(p, shots, rng);
+    case SamplerKind::Cdf:
+    case SamplerKind::Auto: break;
+  }
+  return sample_cdf(p, shots, rng);
+}
+
+} // namespace qsx
@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/schedule.hpp"
+#include <algorithm>
+#include <unistd.h>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+namespace qsx {
+
+static bool is_gate(OpType t){
+  return !(t==OpType::MEASURE || t==OpType::DEPHASE || t==OpType::DEPOL || t==OpType::AMPDAMP);
+}
+
+std::size_t cache_block_qubits(){
+  long l2 = -1;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+  l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+  if (l2 <= 0) l2 = 1L << 20; // 1 MiB when the OS does not report it
+  // Half of L2 per chunk leaves room for the other working data
+  const std::size_t amps = std::size_t(l2) / 2 / sizeof(c64);
+  std::size_t b = 0;
+  while ((std::size_t(2) << b) <= amps) ++b;
+  return std::clamp<std::size_t>(b, 10, 20);
+}
+
+static bool is_unitary(const FusedOp& f){
+  return f.is_block() || f.layout_swap || is_gate(f.op.type);
+}
+
+static const std::vector<std::size_t>& qubits_of(const FusedOp& f){
+  return (f.is_block() || f.layout_swap) ? f.qubits : f.op.qubits;
+}
+
+// Highest qubit touched by a step
+static std::size_t top_qubit(const FusedOp& f){
+  const auto& qs = qubits_of(f);
+  return qs.empty() ? 0 : *std::max_element(qs.begin(), qs.end());
+}
+
+// Rewrite a step from logical to physical bit positions
+static FusedOp to_physical(const FusedOp& f, const std::vector<std::size_t>& phys){
+  FusedOp out = f;
+  if (!f.is_block()){
+    for (auto& q : out.op.qubits) q = phys[q];
+    return out;
+  }
+  for (auto& op : out.members) for (auto& q : op.qubits) q = phys[q];
+  const std::size_t k = f.qubits.size(), dim = std::size_t(1) << k;
+  std::vector<std::size_t> order(k); // new local bit j <- old local bit order[j]
+  for (std::size_t j=0;j<k;++j) order[j] = j;
+  std::sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y){ return phys[f.qubits[x]] < phys[f.qubits[y]]; });
+  for (std::size_t j=0;j<k;++j) out.qubits[j] = phys[f.qubits[order[j]]];
+  bool same = true;
+  for (std::size_t j=0;j<k;++j) same = same && order[j] == j;
+  if (same) return out;
+  auto old_index = [&](std::size_t x){
+    std::size_t r = 0;
+    for (std::size_t j=0;j<k;++j) r |= ((x >> j) & 1) << order[j];
+    return r;
+  };
+  for (std::size_t r=0;r<dim;++r)
+    for (std::size_t c=0;c<dim;++c) out.matrix[r*dim + c] = f.matrix[old_index(r)*dim + old_index(c)];
+  return out;
+}
+
+static FusedOp layout_swap(std::size_t p0, std::size_t p1){
+  FusedOp f{};
+  f.qubits = {std::min(p0, p1), std::max(p0, p1)};
+  f.gates = 0;
+  f.layout_swap = true;
+  return f;
+}
+
+// Steps per layout decision
+static constexpr std::size_t kSegment = 64;
+static constexpr std::size_t kSwapCost = 3;
+
+// Full-state passes for steps [begin, end) under a layout, with the window rule of plan_execution
+static std::size_t passes_under(const std::vector<FusedOp>& steps, std::size_t begin, std::size_t end,
+                                const std::vector<std::size_t>& phys, std::size_t b){
+  std::size_t passes = 0, run = 0;
+  auto close = [&]{ passes += run >= 2 ? 1 : run; run = 0; };
+  for (std::size_t i=begin;i<end;++i){
+    if (!is_unitary(steps[i])){ close(); continue; }
+    bool low = true;
+    for (auto q : qubits_of(steps[i])) low = low && phys[q] < b;
+    if (low) ++run;
+    else { close(); ++passes; }
+  }
+  close();
+  return passes;
+}
+
+static std::vector<FusedOp> reorder_qubits(const std::vector<FusedOp>& steps, std::size_t n, std::size_t b){
+  std::vector<std::size_t> phys(n), at(n); // logical -> physical, physical -> logical
+  for (std::size_t q=0;q<n;++q) phys[q] = at[q] = q;
+  std::vector<FusedOp> out;
+  out.reserve(steps.size());
+  auto swap_positions = [&](std::size_t p0, std::size_t p1){
+    out.push_back(layout_swap(p0, p1));
+    std::swap(at[p0], at[p1]);
+    phys[at[p0]] = p0; phys[at[p1]] = p1;
+  };
+  const std::size_t m = steps.size();
+  for (std::size_t seg=0;seg<m;seg+=kSegment){
+    const std::size_t end = std::min(m, seg + kSegment);
+    // Candidate layout: the b busiest qubits of the segment in the low positions, keeping
+    // qubits that are already low where they are
+    std::vector<std::size_t> use(n, 0);
+    for (std::size_t i=seg;i<end;++i) if (is_unitary(steps[i])) for (auto q : qubits_of(steps[i])) ++use[q];
+    std::vector<std::size_t> order(n);
+    for (std::size_t q=0;q<n;++q) order[q] = q;
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y){
+      if (use[x] != use[y]) return use[x] > use[y];
+      return (phys[x] < b) > (phys[y] < b);
+    });
+    std::vector<bool> want(n, false);
+    for (std::size_t j=0;j<b;++j) want[order[j]] = use[order[j]] > 0 || phys[order[j]] < b;
+    std::vector<std::pair<std::size_t, std::size_t>> moves; // (high position, low position)
+    std::size_t p_low = b;
+    for (std::size_t j=0;j<b;++j){
+      const std::size_t q = order[j];
+      if (!want[q] || phys[q] < b) continue;
+      while (p_low > 0 && want[at[p_low - 1]]) --p_low;
+      if (p_low == 0) break;
+      moves.push_back({phys[q], --p_low});
+    }
+    if (!moves.empty()){
+      std::vector<std::size_t> cand = phys;
+      for (auto [hi, lo] : moves) std::swap(cand[at[hi]], cand[at[lo]]);
+      // A swap is a scattered pass of its own and is undone later: charge it kSwapCost passes
+      if (passes_under(steps, seg, end, cand, b) + kSwapCost * moves.size() < passes_under(steps, seg, end, phys, b))
+        for (auto [hi, lo] : moves) swap_positions(hi, lo);
+    }
+    for (std::size_t i=seg;i<end;++i) out.push_back(to_physical(steps[i], phys));
+  }
+  // Restore the identity layout so probabilities and outcomes use circuit qubit order
+  for (std::size_t p=0;p<n;++p) if (at[p] != p) swap_positions(p, phys[p]);
+  return out;
+}
+
+ExecPlan plan_execution(const Circuit& c, const RunOptions& opts){
+  ExecPlan plan;
+  if (opts.fuse_qubits >= 2) {
+    plan.steps = fuse_gates(c, opts.fuse_qubits).ops;
+  } else {
+    plan.steps.reserve(c.ops.size());
+    for (const auto& op : c.ops){ FusedOp f; f.op = op; plan.steps.push_back(std::move(f)); }
+  }
+  const std::size_t n = c.nqubits;
+  std::size_t b = opts.block_qubits ? opts.block_qubits : cache_block_qubits();
+#ifdef QSX_OPENMP
+  // Chunks are the unit of parallel work: keep at least one per thread
+  const std::size_t threads = std::size_t(omp_get_max_threads());
+  while (b > 6 && b < n && (std::size_t(1) << (n - b)) < threads) --b;
+#endif
+  const bool blocking = opts.cache_blocking && b < n;
+  auto blockable = [&](const FusedOp& f){ return blocking && is_unitary(f) && top_qubit(f) < b; };
+
+  auto& prof = plan.profile;
+  prof.block_qubits = blocking ? b : 0;
+  if (blocking && opts.reorder_qubits) {
+    plan.steps = reorder_qubits(plan.steps, n, b);
+    for (const auto& f : plan.steps) prof.layout_swaps += f.layout_swap;
+  }
+  const std::size_t m = plan.steps.size();
+  for (std::size_t i=0;i<m;){
+    const FusedOp& f = plan.steps[i];
+    std::size_t j = i + 1;
+    if (blockable(f)) {
+      while (j < m && blockable(plan.steps[j])) ++j;
+    }
+    // A lone low-qubit gate gains nothing from chunking
+    const ExecWindow w{i, j, j - i >= 2};
+    if (is_unitary(f)) {
+      prof.steps += j - i;
+      ++prof.passes;
+    }
+    if (w.blocked) {
+      ++prof.blocked_windows;
+      prof.passes_saved += (j - i) - 1;
+    }
+    plan.windows.push_back(w);
+    i = j;
+  }
+  return plan;
+}
+
+std::size_t next_noise_window(const ExecPlan& plan, std::size_t from){
+  for (std::size_t w=from;w<plan.windows.size();++w){
+    const FusedOp& f = plan.steps[plan.windows[w].begin];
+    if (!is_unitary(f) && f.op.type != OpType::MEASURE) return w;
+  }
+  return plan.windows.size();
+}
+
+} // namespace qsx
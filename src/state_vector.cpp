@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: MIT
 
 #include "quantum/state_vector.hpp"
+#include "quantum/kernels.hpp"
+#include "quantum/reduce.hpp"
 #include <algorithm>
 #include <cassert>
 #include <cmath>
@@ -15,65 +17,71 @@ StateVector::StateVector(std::size_t n) : n_(n), amp_(std::size_t(1) << n, c64{0
 }
 
 void StateVector::normalize_() {
-  double norm2 = 0.0, c=0.0; for (auto& a : amp_) { double y = std::norm(a) - c; double t = norm2 + y; c = (t - norm2) - y; norm2 = t; }
-  double inv = 1.0 / std::sqrt(norm2);
-  for (auto& a : amp_) a *= inv;
+  const double norm2 = norm_squared(amp_.data(), amp_.size());
+  scale_amplitudes(amp_.data(), amp_.size(), 1.0 / std::sqrt(norm2));
 }
 
 void StateVector::apply_gate_1q(std::size_t target, const c64 u00, const c64 u01, const c64 u10, const c64 u11) {
-  const std::size_t N = amp_.size();
-  const std::size_t mask = std::size_t(1) << target;
-  #ifdef QSX_OPENMP
-#pragma omp parallel for schedule(static)
-#endif
+  const c64 u[4] = {u00, u01, u10, u11};
+  kernels::apply_1q(amp_.data(), n_, target, u);
+  if ((++applied_ & 255) == 0) normalize_();
+}
+
+void StateVector::apply_diag_1q(std::size_t target, const c64 d0, const c64 d1) {
+  kernels::apply_diag_1q(amp_.data(), n_, target, d0, d1);
+  if ((++applied_ & 255) == 0) normalize_();
+}
+
+void StateVector::apply_x(std::size_t target) {
+  kernels::apply_x(amp_.data(), n_, target);
+}
+
+void StateVector::apply_swap(std::size_t q0, std::size_t q1) {
+  kernels::apply_swap(amp_.data(), n_, q0, q1);
+}
+
+void StateVector::apply_gate_kq(const std::vector<std::size_t>& qubits, const c64* m) {
+  apply_controlled_kq(qubits, 0, m);
+}
+
+void StateVector::apply_controlled_kq(const std::vector<std::size_t>& qubits, std::size_t control_mask, const c64* m) {
+  assert(qubits.size() <= kernels::kMaxDenseQubits);
+  assert(std::is_sorted(qubits.begin(), qubits.end()));
+  kernels::apply_controlled_kq(amp_.data(), n_, qubits.data(), qubits.size(), control_mask, m);
+  if ((++applied_ & 255) == 0) normalize_();
+}
+
+void StateVector::apply_mcx(std::size_t control_mask, std::size_t target) {
+  kernels::apply_mcx(amp_.data(), n_, control_mask, target);
+}
+
+void StateVector::apply_mcphase(std::size_t mask, const c64 phase) {
+  kernels::apply_mcphase(amp_.data(), n_, mask, phase);
+  if ((++applied_ & 255) == 0) normalize_();
+}
+
+void StateVector::apply_blocked(std::size_t block_qubits, std::size_t gates, const std::function<void(c64*, std::size_t)>& f) {
+  const std::size_t b = std::min(block_qubits, n_);
+  const std::ptrdiff_t chunks = std::ptrdiff_t(amp_.size() >> b);
+  c64* a = amp_.data();
+  // Kernels called from f see an active parallel region and run serially inside their chunk
 #ifdef QSX_OPENMP
 #pragma omp parallel for schedule(static)
 #endif
-for (std::size_t i = 0; i < N; ++i) {
-    if ((i & mask) == 0) {
-      const std::size_t j = i | mask;
-      c64 a0 = amp_[i];
-      c64 a1 = amp_[j];
-      amp_[i] = u00 * a0 + u01 * a1;
-      amp_[j] = u10 * a0 + u11 * a1;
-    }
-  }
-  if ((++applied_ & 255) == 0) normalize_();
+  for (std::ptrdiff_t ch = 0; ch < chunks; ++ch) f(a + (std::size_t(ch) << b), b);
+  const std::size_t before = applied_;
+  applied_ += gates;
+  if ((before >> 8) != (applied_ >> 8)) normalize_();
 }
 
 void StateVector::apply_cx(std::size_t control, std::size_t target) {
-  if (control == target) return;
-  const std::size_t N = amp_.size();
-  const std::size_t cm = std::size_t(1) << control;
-  const std::size_t tm = std::size_t(1) << target;
-  #ifdef QSX_OPENMP
-#pragma omp parallel for schedule(static)
-#endif
-for (std::size_t i = 0; i < N; ++i) {
-    if ((i & cm) && !(i & tm)) {
-      std::size_t j = i | tm;
-      std::swap(amp_[i], amp_[j]);
-    }
-  }
+  kernels::apply_cx(amp_.data(), n_, control, target);
 }
 
 void StateVector::apply_controlled_1q(std::size_t control, std::size_t target, const c64 u00, const c64 u01, const c64 u10, const c64 u11) {
   if (control == target) return;
-  const std::size_t N = amp_.size();
-  const std::size_t cm = std::size_t(1) << control;
-  const std::size_t tm = std::size_t(1) << target;
-  #ifdef QSX_OPENMP
-#pragma omp parallel for schedule(static)
-#endif
-for (std::size_t i = 0; i < N; ++i) {
-    if ((i & cm) && !(i & tm)) {
-      const std::size_t j = i | tm;
-      c64 a0 = amp_[i];
-      c64 a1 = amp_[j];
-      amp_[i] = u00 * a0 + u01 * a1;
-      amp_[j] = u10 * a0 + u11 * a1;
-    }
-  }
+  const c64 u[4] = {u00, u01, u10, u11};
+  kernels::apply_controlled_1q(amp_.data(), n_, control, target, u);
   if ((++applied_ & 255) == 0) normalize_();
 }
 
@@ -83,16 +91,29 @@ double StateVector::probability_of_basis(std::size_t basis_index) const {
 
 std::vector<int> StateVector::measure_all(Rng& rng, bool collapse) {
   const std::size_t N = amp_.size();
-  // Cumulative distribution
-  double r = rng.uniform();
-  double acc = 0.0;
-  std::size_t idx = 0;
-  #ifdef QSX_OPENMP
+  // Chunk totals are reduced in parallel; only the chunk holding r is scanned serially.
+  const std::size_t chunk = std::min<std::size_t>(N, std::size_t(1) << 14);
+  const std::size_t nchunks = N / chunk;
+  std::vector<double> sums(nchunks, 0.0);
+#ifdef QSX_OPENMP
 #pragma omp parallel for schedule(static)
 #endif
-for (std::size_t i = 0; i < N; ++i) {
+  for (std::ptrdiff_t k = 0; k < (std::ptrdiff_t)nchunks; ++k) {
+    double s = 0.0;
+    for (std::size_t i = std::size_t(k) * chunk, e = i + chunk; i < e; ++i) s += std::norm(amp_[i]);
+    sums[k] = s;
+  }
+  double total = 0.0;
+  for (double s : sums) total += s;
+  double r = rng.uniform() * total;
+  std::size_t k = 0;
+  double acc = 0.0;
+  while (k + 1 < nchunks && acc + sums[k] <= r) acc += sums[k++];
+  std::size_t idx = k * chunk;
+  for (std::size_t i = k * chunk, e = i + chunk; i < e; ++i) {
     acc += std::norm(amp_[i]);
-    if (r <= acc) { idx = i; break; }
+    idx = i;
+    if (r < acc) break;
   }
   std::vector<int> bits(n_, 0);
   for (std::size_t q = 0; q < n_; ++q) bits[q] = (idx >> q) & 1;
@@ -108,6 +129,7 @@ for (std::size_t i = 0; i < N; ++i) {
 
 #include <fstream>
 #include <optional>
+#include <cstring>
 
 namespace qsx {
 bool StateVector::save(const std::string& path) const {
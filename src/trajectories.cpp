@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/trajectories.hpp"
+#include "quantum/schedule.hpp"
+#include "quantum/reduce.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+namespace qsx {
+
+using cd = std::complex<double>;
+
+// Trajectories between two checks of the stopping rule (fixed, so the stopping point does not
+// depend on the thread count)
+constexpr std::size_t kTrajectoryBatch = 64;
+
+static bool is_multiple_of_identity(const std::vector<cd>& m, std::size_t d, double tol) {
+  for (std::size_t r=0;r<d;++r)
+    for (std::size_t c=0;c<d;++c){
+      const cd expect = r == c ? m[0] : cd{0, 0};
+      if (std::abs(m[r*d + c] - expect) > tol) return false;
+    }
+  return true;
+}
+
+KrausSampler::KrausSampler(const Channel& ch) : k_(ch.nqubits) {
+  if (ch.kraus.empty()) throw std::invalid_argument("trajectories need a channel with Kraus operators");
+  const std::size_t d = std::size_t(1) << k_;
+  std::vector<std::vector<cd>> effects;
+  for (const auto& K : ch.kraus){
+    std::vector<cd> e(d*d, cd{0, 0});
+    for (std::size_t r=0;r<d;++r)
+      for (std::size_t c=0;c<d;++c)
+        for (std::size_t l=0;l<d;++l) e[r*d + c] += std::conj(cd(K[l*d + r])) * cd(K[l*d + c]);
+    double tr = 0.0;
+    for (std::size_t r=0;r<d;++r) tr += std::real(e[r*d + r]);
+    if (tr == 0.0) continue; // K = 0 (e.g. generalized amplitude damping with p = 1)
+    ops_.push_back(K);
+    effects.push_back(std::move(e));
+  }
+  bool unital = true;
+  for (const auto& e : effects) unital &= is_multiple_of_identity(e, d, 1e-12);
+  if (unital){
+    // K_i = sqrt(p_i) U_i with U_i unitary
+    for (std::size_t i=0;i<ops_.size();++i){
+      const double p = std::real(effects[i][0]);
+      fixed_.push_back(p);
+      for (auto& x : ops_[i]) x *= c64::value_type(1.0 / std::sqrt(p));
+    }
+  } else effects_ = std::move(effects);
+  for (const auto& K : ops_){
+    std::vector<cd> m(K.begin(), K.end());
+    identity_.push_back(is_multiple_of_identity(m, d, 1e-12) && std::abs(m[0] - cd{1, 0}) < 1e-12);
+  }
+}
+
+// m (2^k x 2^k, local bit j = qubits[j]) on the state
+static void apply_matrix(StateVector& sv, const std::vector<std::size_t>& qubits, const c64* m) {
+  if (qubits.size() == 1){
+    if (m[1] == c64{0, 0} && m[2] == c64{0, 0}) sv.apply_diag_1q(qubits[0], m[0], m[3]);
+    else sv.apply_gate_1q(qubits[0], m[0], m[1], m[2], m[3]);
+    return;
+  }
+  if (qubits[0] < qubits[1]){ sv.apply_gate_kq(qubits, m); return; }
+  // apply_gate_kq wants ascending qubits: exchange local bits 0 and 1
+  auto sw = [](std::size_t x){ return ((x & 1) << 1) | ((x >> 1) & 1); };
+  c64 t[16];
+  for (std::size_t r=0;r<4;++r) for (std::size_t c=0;c<4;++c) t[sw(r)*4 + sw(c)] = m[r*4 + c];
+  sv.apply_gate_kq({qubits[1], qubits[0]}, t);
+}
+
+std::size_t KrausSampler::apply(StateVector& sv, const std::vector<std::size_t>& qubits, Pcg32& rng) const {
+  const std::size_t d = std::size_t(1) << k_, nb = ops_.size();
+  std::vector<double> p;
+  if (mixed_unitary()) p = fixed_;
+  else {
+    c64 rho[16];
+    reduced_density(sv.amplitudes().data(), sv.num_qubits(), qubits.data(), k_, rho);
+    // p_i = Tr(E_i rho)
+    for (const auto& e : effects_){
+      double v = 0.0;
+      for (std::size_t r=0;r<d;++r)
+        for (std::size_t c=0;c<d;++c) v += std::real(e[r*d + c] * cd(rho[c*d + r]));
+      p.push_back(std::max(v, 0.0));
+    }
+  }
+  double total = 0.0;
+  for (double v : p) total += v;
+  const double u = rng.uniform01() * total;
+  std::size_t i = 0;
+  double acc = p[0];
+  while (i + 1 < nb && (u >= acc || p[i] == 0.0)) acc += p[++i];
+  if (identity_[i]) return i;
+  if (mixed_unitary()){ apply_matrix(sv, qubits, ops_[i].data()); return i; }
+  // Non-unitary branch: apply K_i / sqrt(p_i), which also removes any accumulated norm drift
+  std::vector<c64> m = ops_[i];
+  for (auto& x : m) x *= c64::value_type(1.0 / std::sqrt(p[i]));
+  apply_matrix(sv, qubits, m.data());
+  return i;
+}
+
+static Channel noise_channel(const Op& op) {
+  switch (op.type){
+    case OpType::DEPHASE: return dephasing(op.angle);
+    case OpType::DEPOL: return depolarizing(op.angle);
+    case OpType::AMPDAMP: return amplitude_damping(op.angle);
+    default: throw std::invalid_argument("not a noise op");
+  }
+}
+
+TrajectoryResult run_trajectories(const Circuit& c, uint64_t seed, const TrajectoryOptions& opts) {
+  if (opts.max_trajectories == 0) throw std::invalid_argument("max_trajectories must be at least 1");
+  const std::size_t n = c.nqubits;
+  const ExecPlan plan = plan_execution(c, opts.run);
+  // One sampler per distinct noise op
+  std::map<std::pair<OpType, double>, KrausSampler> samplers;
+  for (const auto& op : c.ops)
+    if (op.type == OpType::DEPHASE || op.type == OpType::DEPOL || op.type == OpType::AMPDAMP)
+      samplers.try_emplace({op.type, op.angle}, noise_channel(op));
+
+  TrajectoryResult tr;
+  tr.profile = plan.profile;
+  std::vector<double> sum_z(n, 0.0), sum_z2(n, 0.0);
+  if (opts.probabilities) tr.probabilities.assign(std::size_t(1) << n, 0.0);
+
+  // Everything before the first noise op is the same for every trajectory
+  const std::size_t first = next_noise_window(plan);
+  StateVector prefix(n);
+  apply_plan(prefix, plan, [](const Op&){}, 0, first);
+
+  const bool across = n <= kParallelStatesQubits;
+  std::vector<std::vector<double>> z(kTrajectoryBatch), probs(opts.probabilities ? kTrajectoryBatch : 0);
+  auto one = [&](std::size_t t, std::size_t slot){
+    StateVector sv = prefix;
+    Pcg32 rng(seed, t);
+    apply_plan(sv, plan, [&](const Op& op){
+      const auto it = samplers.find({op.type, op.angle});
+      if (it != samplers.end()) it->second.apply(sv, op.qubits, rng); // MEASURE is read afterwards
+    }, first);
+    z[slot] = expect_z_all(sv.amplitudes(), n);
+    if (opts.probabilities) probs[slot] = probabilities(sv.amplitudes());
+  };
+
+  std::size_t done = 0;
+  while (done < opts.max_trajectories){
+    const std::size_t nb = std::min(kTrajectoryBatch, opts.max_trajectories - done);
+    if (across){
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (std::ptrdiff_t i = 0; i < (std::ptrdiff_t)nb; ++i) one(done + std::size_t(i), std::size_t(i));
+    } else {
+      for (std::size_t i=0;i<nb;++i) one(done + i, i);
+    }
+    // Accumulate in trajectory order
+    for (std::size_t i=0;i<nb;++i){
+      for (std::size_t q=0;q<n;++q){ sum_z[q] += z[i][q]; sum_z2[q] += z[i][q]*z[i][q]; }
+      if (opts.probabilities){
+        const double* p = probs[i].data();
+        double* out = tr.probabilities.data();
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (std::ptrdiff_t j = 0; j < (std::ptrdiff_t)tr.probabilities.size(); ++j) out[j] += p[j];
+      }
+    }
+    done += nb;
+    if (opts.target_stderr > 0.0 && done >= std::max<std::size_t>(opts.min_trajectories, 2)){
+      double worst = 0.0;
+      for (std::size_t q=0;q<n;++q){
+        const double var = std::max(0.0, (sum_z2[q] - sum_z[q]*sum_z[q]/double(done)) / double(done - 1));
+        worst = std::max(worst, std::sqrt(var / double(done)));
+      }
+      if (worst <= opts.target_stderr){ tr.converged = true; break; }
+    }
+  }
+
+  tr.trajectories = done;
+  tr.expect_z.resize(n);
+  tr.stderr_z.resize(n);
+  for (std::size_t q=0;q<n;++q){
+    tr.expect_z[q] = sum_z[q] / double(done);
+    const double var = done > 1 ? std::max(0.0, (sum_z2[q] - sum_z[q]*sum_z[q]/double(done)) / double(done - 1)) : 0.0;
+    tr.stderr_z[q] = std::sqrt(var / double(done));
+  }
+  for (auto& v : tr.probabilities) v /= double(done);
+  return tr;
+}
+
+} // namespace qsx
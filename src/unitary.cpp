@@ -1,97 +1,53 @@
 // SPDX-License-Identifier: MIT
 
 #include "quantum/unitary.hpp"
-#include "quantum/gates.hpp"
+#include "quantum/reduce.hpp"
+#include "quantum/schedule.hpp"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <fstream>
+#include <stdexcept>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
 
 namespace qsx {
 
-static std::vector<c64> eye(std::size_t d){
-  std::vector<c64> m(d*d, {0.0,0.0});
-  for (std::size_t i=0;i<d;i++) m[i*d+i] = {1.0,0.0};
-  return m;
-}
-
-static std::vector<c64> kron2(const std::vector<c64>& A, std::size_t arows, std::size_t acols,
-                              const std::vector<c64>& B, std::size_t brows, std::size_t bcols){
-  std::vector<c64> K(arows*brows*acols*bcols);
-  for (std::size_t i=0;i<arows;i++)
-    for (std::size_t j=0;j<acols;j++)
-      for (std::size_t r=0;r<brows;r++)
-        for (std::size_t s=0;s<bcols;s++)
-          K[(i*brows+r)*(acols*bcols) + (j*bcols+s)] = A[i*acols+j]*B[r*bcols+s];
-  return K;
-}
-
-static std::vector<c64> matmul(const std::vector<c64>& A, const std::vector<c64>& B, std::size_t d){
-  std::vector<c64> C(d*d, {0.0,0.0});
-  for (std::size_t i=0;i<d;i++)
-    for (std::size_t k=0;k<d;k++){
-      auto aik = A[i*d+k];
-      for (std::size_t j=0;j<d;j++)
-        C[i*d+j] += aik * B[k*d+j];
-    }
-  return C;
-}
-
-static std::vector<c64> gate_1q_matrix(const c64 u00,const c64 u01,const c64 u10,const c64 u11, std::size_t n, std::size_t target){
-  // Build U (2^n) as I⊗...⊗U⊗...⊗I with target at position
-  std::vector<c64> U2 = {u00,u01,u10,u11}; // row-major 2x2
-  std::vector<c64> M = U2;
-  std::size_t left = target, right = n - target - 1;
-  for (std::size_t i=0;i<left;i++)  M = kron2({{1,0},{0,0},{0,0},{1,0}},2,2, M, 2, M.size()/2); // I ⊗ M
-  for (std::size_t i=0;i<right;i++) M = kron2(M, M.size()/2, 2, {{1,0},{0,0},{0,0},{1,0}}, 2, 2); // M ⊗ I
-  return M;
-}
-
-std::vector<c64> build_unitary(const Circuit& c){
-  // Validate
+static void check_unitary_ops(const Circuit& c){
   for (auto& op: c.ops){
     if (op.type==OpType::MEASURE || op.type==OpType::DEPHASE || op.type==OpType::DEPOL || op.type==OpType::AMPDAMP)
       throw std::runtime_error("Non-unitary op present");
   }
-  std::size_t n = c.nqubits;
-  std::size_t d = std::size_t(1) << n;
-  auto U = eye(d);
-  using namespace qsx::gates; c64 u00,u01,u10,u11;
-  for (auto& op : c.ops){
-    if (op.qubits.size()==1){
-      switch(op.type){
-        case OpType::H: H_coeffs(u00,u01,u10,u11); break;
-        case OpType::X: X_coeffs(u00,u01,u10,u11); break;
-        case OpType::Y: Y_coeffs(u00,u01,u10,u11); break;
-        case OpType::Z: Z_coeffs(u00,u01,u10,u11); break;
-        case OpType::S: S_coeffs(u00,u01,u10,u11); break;
-        case OpType::RX: RX_coeffs(op.angle,u00,u01,u10,u11); break;
-        case OpType::RY: RY_coeffs(op.angle,u00,u01,u10,u11); break;
-        case OpType::RZ: RZ_coeffs(op.angle,u00,u01,u10,u11); break;
-        default: throw std::runtime_error("Unsupported unitary op");
-      }
-      auto G = gate_1q_matrix(u00,u01,u10,u11,n, op.qubits[0]);
-      U = matmul(G, U, d);
-    } else if (op.type==OpType::CNOT){
-      // Build CNOT on (control,target)
-      std::size_t cbit = op.qubits[0], tbit = op.qubits[1];
-      // Apply as permutation on the basis states: we can compose into U by permuting columns
-      // Construct P such that |i> -> |i ^ ( (i>>c)&1 ? (1<<t) : 0 )>
-      std::vector<c64> P(d*d, {0.0,0.0});
-      for (std::size_t i=0;i<d;i++){
-        bool c1 = ( (i>>cbit) & 1 ) != 0;
-        std::size_t j = c1 ? (i ^ (std::size_t(1)<<tbit)) : i;
-        P[j*d + i] = {1.0,0.0};
-      }
-      U = matmul(P, U, d);
-    } else {
-      throw std::runtime_error("Unsupported multi-qubit op");
-    }
+}
+
+std::vector<c64> build_unitary(const Circuit& c, const RunOptions& opts){
+  check_unitary_ops(c);
+  const std::size_t n = c.nqubits, d = std::size_t(1) << n;
+  // Row-major U is a 2n-qubit vector whose high n bits are the row index: gate G on qubit q is G
+  // on bit q + n, which updates every column (a state vector) in the same sweep. Starting from
+  // vec(I), each gate costs O(d^2) through the regular kernels, fusion, blocking and threading.
+  Circuit wide; wide.nqubits = 2*n;
+  for (const auto& op : c.ops){
+    Op row = op;
+    for (auto& q : row.qubits) q += n;
+    wide.ops.push_back(std::move(row));
   }
-  return U;
+  StateVector sv(2*n);
+  auto& a = sv.amplitudes_mut();
+  a[0] = c64{0, 0};
+  for (std::size_t i=0;i<d;i++) a[i*d + i] = c64{1, 0};
+  Rng rng(0);
+  execute(sv, wide, rng, opts);
+  // The periodic state-vector renormalisation scales U by a global factor; a unitary has
+  // Frobenius norm^2 = d
+  scale_amplitudes(a.data(), a.size(), std::sqrt(double(d) / norm_squared(a.data(), a.size())));
+  return std::move(a);
 }
 
 bool export_unitary_csv(const Circuit& c, const std::string& path){
   std::size_t d = std::size_t(1) << c.nqubits;
-  if (d > (1u<<10)) return false; // safety: limit to 10 qubits
+  if (d > (1u<<14)) return false; // safety: limit to 14 qubits (a 4 GiB matrix)
   auto U = build_unitary(c);
   std::ofstream out(path);
   if (!out) return false;
@@ -106,4 +62,91 @@ bool export_unitary_csv(const Circuit& c, const std::string& path){
   return bool(out);
 }
 
+struct UnitaryHeader { char magic[8]; uint32_t version; uint32_t flags; uint64_t n; uint32_t scalar_bytes; uint32_t reserved; };
+static_assert(sizeof(UnitaryHeader) == 32, "unitary file data starts at byte 32");
+
+template <class T>
+static bool write_column(std::ofstream& out, const vec_c64& a){
+  if (sizeof(T) == sizeof(c64::value_type)) {
+    out.write(reinterpret_cast<const char*>(a.data()), sizeof(c64)*a.size());
+  } else {
+    std::vector<std::complex<T>> buf(a.begin(), a.end());
+    out.write(reinterpret_cast<const char*>(buf.data()), sizeof(std::complex<T>)*buf.size());
+  }
+  return bool(out);
+}
+
+bool export_unitary_binary(const Circuit& c, const std::string& path, bool single, const RunOptions& opts){
+  check_unitary_ops(c);
+  const std::size_t n = c.nqubits, d = std::size_t(1) << n;
+  std::ofstream out(path, std::ios::binary);
+  if (!out) return false;
+  UnitaryHeader h{};
+  std::memcpy(h.magic, "QSXUNI1", 8);
+  h.version = 1; h.flags = 1; h.n = n;
+  h.scalar_bytes = single ? 4 : uint32_t(sizeof(c64::value_type));
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+  const ExecPlan plan = plan_execution(c, opts);
+  // Columns are simulated a batch at a time (one per thread, each on serial kernels) and then
+  // written in order, so only the batch is ever held in memory
+#ifdef QSX_OPENMP
+  const std::size_t batch = std::min<std::size_t>(d, std::size_t(omp_get_max_threads()));
+#else
+  const std::size_t batch = 1;
+#endif
+  std::vector<vec_c64> cols(batch);
+  for (std::size_t j0=0;j0<d;j0+=batch){
+    const std::size_t nb = std::min(batch, d - j0);
+#ifdef QSX_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (std::ptrdiff_t i = 0; i < (std::ptrdiff_t)nb; ++i){
+      StateVector sv(n);
+      auto& a = sv.amplitudes_mut();
+      a[0] = c64{0, 0};
+      a[j0 + std::size_t(i)] = c64{1, 0};
+      apply_plan(sv, plan, [](const Op&){});
+      cols[i] = std::move(a);
+    }
+    for (std::size_t i=0;i<nb;++i){
+      const bool ok = single ? write_column<float>(out, cols[i]) : write_column<c64::value_type>(out, cols[i]);
+      if (!ok) return false;
+    }
+  }
+  return bool(out);
+}
+
+template <class T>
+static bool read_columns(std::ifstream& in, std::vector<c64>& U, std::size_t d){
+  std::vector<std::complex<T>> col(d);
+  for (std::size_t j=0;j<d;j++){
+    in.read(reinterpret_cast<char*>(col.data()), sizeof(std::complex<T>)*d);
+    if (!in) return false;
+    for (std::size_t i=0;i<d;i++) U[i*d + j] = c64(col[i]);
+  }
+  return true;
+}
+
+std::optional<std::vector<c64>> load_unitary_binary(const std::string& path, std::size_t& nqubits){
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return std::nullopt;
+  UnitaryHeader h;
+  in.read(reinterpret_cast<char*>(&h), sizeof(h));
+  if (!in || std::string(h.magic, h.magic+7) != std::string("QSXUNI1", 7) || h.version != 1 || !(h.flags & 1)) return std::nullopt;
+  // n <= 29 keeps the expected size below 2^64 bytes
+  if (h.n > 29 || (h.scalar_bytes != 4 && h.scalar_bytes != 8)) return std::nullopt;
+  const std::size_t d = std::size_t(1) << h.n;
+  // Truncated or padded files are rejected before the d x d matrix is allocated
+  in.seekg(0, std::ios::end);
+  const std::streamoff size = in.tellg();
+  if (size < 0 || uint64_t(size) != sizeof(h) + uint64_t(d)*d*2*h.scalar_bytes) return std::nullopt;
+  in.seekg(sizeof(h));
+  std::vector<c64> U(d*d);
+  const bool ok = h.scalar_bytes == 4 ? read_columns<float>(in, U, d) : read_columns<double>(in, U, d);
+  if (!ok) return std::nullopt;
+  nqubits = std::size_t(h.n);
+  return U;
+}
+
 } // namespace qsx
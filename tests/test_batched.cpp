@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/batched.hpp"
+#include "quantum/compiled.hpp"
+#include "quantum/kernels.hpp"
+#include "quantum/reduce.hpp"
+#include "test_util.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+using namespace qsx;
+using namespace qsx::kernels;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-4;
+#else
+static const double tol = 1e-10;
+#endif
+
+int main(){
+  Rng rng(5);
+
+  // Per-state dense kernel: every ISA against one apply_kq per state
+  for (Isa isa : {Isa::Scalar, Isa::AVX2, Isa::AVX512}){
+    if (static_cast<int>(isa) > static_cast<int>(detect_isa())) continue;
+    for (std::size_t lane_bits=0;lane_bits<=4;++lane_bits)
+      for (std::size_t n=1;n<=6;++n)
+        for (std::size_t k=1;k<=std::min<std::size_t>(n, 3);++k){
+          const std::size_t B = std::size_t(1) << lane_bits, dim = std::size_t(1) << k;
+          std::vector<std::size_t> qubits;
+          for (std::size_t q=0;q<n && qubits.size()<k;++q) if (rng.uniform() < double(k) / double(n) || n - q == k - qubits.size()) qubits.push_back(q);
+          vec_c64 m(B * dim * dim), a(B << n);
+          for (auto& x : m) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+          for (auto& x : a) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+          vec_c64 ref = a;
+          for (std::size_t b=0;b<B;++b){
+            vec_c64 one(std::size_t(1) << n);
+            for (std::size_t i=0;i<one.size();++i) one[i] = ref[i * B + b];
+            apply_kq(Isa::Scalar, one.data(), n, qubits.data(), k, m.data() + b * dim * dim);
+            for (std::size_t i=0;i<one.size();++i) ref[i * B + b] = one[i];
+          }
+          apply_kq_lanes(isa, a.data(), n, lane_bits, qubits.data(), k, m.data());
+          EXPECT_TRUE(max_diff(a, ref) < tol);
+        }
+  }
+
+  // Layout: batch rounded up, assign / extract, per-state normalisation
+  {
+    BatchedStateVector bsv(3, 5);
+    EXPECT_TRUE(bsv.batch() == 8 && bsv.lane_bits() == 3 && bsv.amplitudes().size() == 64);
+    StateVector sv(3), out(3);
+    auto& a = sv.amplitudes_mut();
+    for (auto& x : a) x = c64(rng.uniform(), rng.uniform());
+    bsv.assign(sv);
+    bsv.amplitudes_mut()[8 * 5 + 2] *= 3.0f;
+    bsv.normalize();
+    bsv.extract(2, out);
+    EXPECT_TRUE(std::fabs(norm_squared(out.amplitudes().data(), 8) - 1.0) < tol);
+    bsv.extract(7, out);
+    const double s = std::sqrt(norm_squared(a.data(), 8));
+    for (std::size_t i=0;i<8;++i) EXPECT_TRUE(std::abs(out.amplitudes()[i] - a[i] / c64::value_type(s)) < tol);
+  }
+
+  // Batched execution matches one compiled run per binding: noise, fusion, cache blocking and
+  // qubit reordering, fewer bindings than states, and resuming from a checkpoint
+  for (std::size_t fuse : {0, 3}){
+    const std::size_t n = 8;
+    auto c = random_circuit(n, 150, 11 + fuse, true, true);
+    // A parameter-free start (with a noise draw) for the checkpoint below
+    c.ops.insert(c.ops.begin(), {OpType::DEPOL, {2}, 0.9});
+    for (std::size_t q=0;q<n;++q) c.ops.insert(c.ops.begin(), {OpType::H, {q}, 0.0});
+    RunOptions ro; ro.fuse_qubits = fuse; ro.block_qubits = 4;
+    auto cc = compile_circuit(c, ro);
+    EXPECT_TRUE(cc.parameters.size() == 3);
+    std::vector<std::vector<double>> values;
+    for (int b=0;b<6;++b) values.push_back({rng.uniform() * 6, rng.uniform() * 6, rng.uniform() * 6});
+    BatchedStateVector bsv(n, 8);
+    Rng r(21);
+    execute(bsv, cc, values, r);
+    for (std::size_t b=0;b<8;++b){
+      bind_parameters(cc, values[std::min<std::size_t>(b, 5)]);
+      StateVector ref(n), got(n);
+      Rng rr(21);
+      execute(ref, cc, rr);
+      bsv.extract(b, got);
+      EXPECT_TRUE(max_diff(got.amplitudes(), ref.amplitudes()) < tol);
+    }
+    const std::size_t from = std::min({parameter_window(cc, 0), parameter_window(cc, 1), parameter_window(cc, 2)});
+    EXPECT_TRUE(from >= 2);
+    StateVector prefix(n);
+    Rng rp(4);
+    execute(prefix, cc, rp, 0, from);
+    bsv.assign(prefix);
+    Rng rb = rp;
+    execute(bsv, cc, values, rb, from);
+    for (std::size_t b : {0, 5}){
+      bind_parameters(cc, values[b]);
+      StateVector ref(n), got(n);
+      Rng rr(4);
+      execute(ref, cc, rr);
+      bsv.extract(b, got);
+      EXPECT_TRUE(max_diff(got.amplitudes(), ref.amplitudes()) < tol);
+    }
+    bool threw = false;
+    try { execute(bsv, cc, {{1.0}}, r); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+  }
+
+  EXPECT_TRUE(batch_width(12, 1) == 1 && batch_width(12, 3) == 4 && batch_width(12, 100) == 8 && batch_width(16, 100) == 1);
+
+  // evaluate_batch with fused blocks, several batches and a partial last one
+  {
+    const std::size_t n = 12;
+    const auto c = random_circuit(n, 60, 3, true, true);
+    RunOptions ro; ro.fuse_qubits = 3;
+    auto cc = compile_circuit(c, ro);
+    std::vector<std::vector<double>> bindings;
+    for (int b=0;b<10;++b) bindings.push_back({rng.uniform() * 6, rng.uniform() * 6, rng.uniform() * 6});
+    std::vector<std::vector<double>> ez(bindings.size());
+    evaluate_batch(cc, bindings, 2, [&](std::size_t b, const StateVector& sv){ ez[b] = expect_z_all(sv.amplitudes(), n); });
+    for (std::size_t b : {0, 7, 9}){
+      bind_parameters(cc, bindings[b]);
+      StateVector ref(n);
+      Rng rr(2);
+      execute(ref, cc, rr);
+      const auto e = expect_z_all(ref.amplitudes(), n);
+      for (std::size_t q=0;q<n;++q) EXPECT_TRUE(std::fabs(ez[b][q] - e[q]) < tol);
+    }
+#ifdef QSX_OPENMP
+    // Bitwise identical for any thread count
+    for (int threads : {1, 4}){
+      omp_set_num_threads(threads);
+      std::vector<std::vector<double>> again(bindings.size());
+      evaluate_batch(cc, bindings, 2, [&](std::size_t b, const StateVector& sv){ again[b] = expect_z_all(sv.amplitudes(), n); });
+      EXPECT_TRUE(again == ez);
+    }
+#endif
+  }
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/c_api.h"
+#include <iostream>
+#include <string>
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+static std::string run(const char* circuit, const char* options){
+  char* out = nullptr;
+  const int rc = qsx_run_string(circuit, options, &out);
+  std::string js = rc == 0 && out ? out : "error " + std::to_string(rc);
+  qsx_free(out);
+  return js;
+}
+
+int main(){
+  // Both input formats, both backends; X on qubit 0 makes every shot "01"
+  const char* qsx = "X 0\nZ 1\nMEASURE ALL\n";
+  const char* qasm = "OPENQASM 2.0;\nqreg q[2];\nx q[0];\nmeasure q -> c;\n";
+  for (const char* circuit : {qsx, qasm})
+    for (const char* options : {"{\"shots\": 5, \"seed\": 3}", "{\"backend\": \"density\", \"shots\": 5}"}){
+      const auto js = run(circuit, options);
+      EXPECT_TRUE(js.find("\"nqubits\": 2") != std::string::npos);
+      EXPECT_TRUE(js.find("\"01\": 5") != std::string::npos);
+    }
+  // The density backend averages noise exactly: DEPOL(0.75) flips qubit 0 half the time
+  const auto js = run("DEPOL 0 0.75\nMEASURE ALL\n", "{\"backend\": \"density\", \"shots\": 2000}");
+  EXPECT_TRUE(js.find("\"probabilities\": [0.5, 0.5]") != std::string::npos);
+  EXPECT_TRUE(run("BOGUS 0\n", "{}") == "error 3");
+  EXPECT_TRUE(run(nullptr, "{}") == "error 2");
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/density_matrix.hpp"
+#include "quantum/channel_fusion.hpp"
+#include "quantum/random.hpp"
+#include <iostream>
+#include <cmath>
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-4;
+#else
+static const double tol = 1e-10;
+#endif
+
+// Every gate type, each followed by per-qubit noise with probability `noise`
+static Circuit noisy_circuit(std::size_t n, std::size_t depth, uint64_t seed, double noise){
+  Rng rng(seed);
+  Circuit c; c.nqubits = n;
+  const OpType one[] = {OpType::H, OpType::X, OpType::Y, OpType::Z, OpType::S, OpType::RX, OpType::RY, OpType::RZ, OpType::U3};
+  const OpType two[] = {OpType::CNOT, OpType::CZ, OpType::SWAP, OpType::U2Q};
+  const OpType chan[] = {OpType::DEPHASE, OpType::DEPOL, OpType::AMPDAMP};
+  auto pick = [&](std::size_t m){ return std::size_t(rng.uniform() * m) % m; };
+  for (std::size_t i=0;i<depth;++i){
+    const std::size_t q = pick(n);
+    const double u = rng.uniform();
+    Op op;
+    if (u < 0.35){
+      const std::size_t t = (q + 1 + pick(n - 1)) % n;
+      op = {two[pick(4)], {q, t}, 0.0};
+      if (op.type == OpType::U2Q){
+        // A fixed entangling unitary: CNOT followed by an RZ phase on the target
+        op.params.assign(32, 0.0);
+        op.params[0] = 1.0; op.params[2*5] = 1.0;
+        op.params[2*11] = std::cos(0.4); op.params[2*11 + 1] = std::sin(0.4);
+        op.params[2*14] = std::cos(0.4); op.params[2*14 + 1] = std::sin(0.4);
+      }
+    } else if (u < 0.4 && n > 2){
+      op = {OpType::CCX, {q, (q + 1) % n, (q + 2) % n}, 0.0};
+    } else {
+      op = {one[pick(9)], {q}, rng.uniform() * 6.0};
+      if (op.type == OpType::U3) op.params = {rng.uniform() * 3.0, rng.uniform(), rng.uniform()};
+    }
+    c.ops.push_back(op);
+    for (auto t : op.qubits)
+      if (rng.uniform() < noise) c.ops.push_back({chan[pick(3)], {t}, 0.05 + 0.2*rng.uniform()});
+  }
+  c.ops.push_back({OpType::MEASURE, {}, 0.0});
+  return c;
+}
+
+static double max_diff(const std::vector<c64>& a, const std::vector<c64>& b){
+  double d = 0.0;
+  for (std::size_t i=0;i<a.size();++i) d = std::max(d, (double)std::abs(a[i] - b[i]));
+  return d;
+}
+
+int main(){
+  // Compiled steps reproduce op-by-op evolution of the full rho
+  for (uint64_t seed : {1, 2, 3, 4}){
+    for (double noise : {0.0, 0.5, 1.0}){
+      auto c = noisy_circuit(4, 60, seed, noise);
+      DensityMatrix ref(c.nqubits), got(c.nqubits);
+      for (const auto& op : c.ops) ref.apply_op(op);
+      const auto prog = compile_density(c);
+      for (const auto& st : prog.steps) got.apply_step(st);
+      EXPECT_TRUE(max_diff(ref.data(), got.data()) < tol);
+      EXPECT_TRUE(prog.source_ops == c.ops.size() - 1);
+      std::size_t sources = 0;
+      for (const auto& st : prog.steps){
+        sources += st.sources;
+        if (st.is_fused()) EXPECT_TRUE(st.qubits.size() <= 2);
+      }
+      EXPECT_TRUE(sources == prog.source_ops);
+      EXPECT_TRUE(prog.steps.size() < prog.source_ops);
+
+      // Readout-only compilation keeps the populations
+      RunOptions plain; plain.fuse_channels = false;
+      auto a = run_density(c, 7, false, DensityMode::Matrix, plain);
+      auto b = run_density(c, 7, false);
+      for (std::size_t i=0;i<a.probabilities.size();++i) EXPECT_TRUE(std::fabs(a.probabilities[i] - b.probabilities[i]) < tol);
+      EXPECT_TRUE(b.passes < a.passes);
+    }
+  }
+
+  // Per-gate noise on a layered circuit: channels fold into the gate steps
+  {
+    Circuit c; c.nqubits = 6;
+    for (int layer=0;layer<4;++layer){
+      for (std::size_t q=0;q<6;++q){ c.ops.push_back({OpType::H, {q}, 0.0}); c.ops.push_back({OpType::DEPOL, {q}, 0.01}); }
+      for (std::size_t q=0;q+1<6;q+=2){
+        c.ops.push_back({OpType::CNOT, {q, q+1}, 0.0});
+        c.ops.push_back({OpType::DEPOL, {q}, 0.02});
+        c.ops.push_back({OpType::DEPOL, {q+1}, 0.02});
+      }
+    }
+    const auto prog = compile_density(c);
+    EXPECT_TRUE(3*prog.steps.size() <= prog.source_ops);
+  }
+
+  // Dephasing commutes through S, CZ and a CNOT control and merges with later noise;
+  // a bit flip would not pass the CNOT control.
+  {
+    Circuit c; c.nqubits = 2;
+    c.ops.push_back({OpType::H, {0}, 0.0});
+    c.ops.push_back({OpType::H, {1}, 0.0});
+    c.ops.push_back({OpType::DEPHASE, {0}, 0.1});
+    c.ops.push_back({OpType::S, {0}, 0.0});
+    c.ops.push_back({OpType::CZ, {0, 1}, 0.0});
+    c.ops.push_back({OpType::CNOT, {0, 1}, 0.0});
+    c.ops.push_back({OpType::DEPHASE, {0}, 0.2});
+    const auto prog = compile_density(c);
+    EXPECT_TRUE(prog.commuted == 3);
+    // Only Z noise remains at the end, which the populations do not see
+    const auto diag = compile_density(c, true);
+    EXPECT_TRUE(diag.dropped == 2);
+    DensityMatrix ref(2), got(2);
+    for (const auto& op : c.ops) ref.apply_op(op);
+    for (const auto& st : prog.steps) got.apply_step(st);
+    EXPECT_TRUE(max_diff(ref.data(), got.data()) < tol);
+  }
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/compiled.hpp"
+#include "quantum/optimize.hpp"
+#include "quantum/qasm.hpp"
+#include "quantum/reduce.hpp"
+#include "test_util.hpp"
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <stdexcept>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-4;
+#else
+static const double tol = 1e-10;
+#endif
+
+// The same values as a name -> value map for bind_parameters(Circuit)
+static std::map<std::string, double> named(const CompiledCircuit& cc, const std::vector<double>& v){
+  std::map<std::string, double> m;
+  for (std::size_t k=0;k<v.size();++k) m[cc.parameters[k]] = v[k];
+  return m;
+}
+
+int main(){
+  // Angle tokens
+  {
+    Op op{OpType::RZ, {0}, 0.0};
+    EXPECT_TRUE(parse_angle("1.5", op) && op.angle == 1.5 && op.param.empty());
+    EXPECT_TRUE(parse_angle("theta_1", op) && op.param == "theta_1" && op.param_scale == 1.0 && op.angle == 0.0);
+    EXPECT_TRUE(parse_angle("-beta", op) && op.param == "beta" && op.param_scale == -1.0);
+    EXPECT_TRUE(parse_angle("0.5*g+0.25", op) && op.param == "g" && op.param_scale == 0.5 && op.angle == 0.25);
+    EXPECT_TRUE(format_angle(op) == "0.5*g+0.25");
+    EXPECT_TRUE(parse_angle("-2*g-1", op) && op.param_scale == -2.0 && op.angle == -1.0 && format_angle(op) == "-2*g-1");
+    for (const char* bad : {"", "pi", "2*", "1theta", "theta*2", "a+b", "2**a"}) EXPECT_TRUE(!parse_angle(bad, op));
+  }
+
+  // .qsx and QASM files, parameter order and binding
+  {
+    std::ofstream("compiled_test.qsx") << "H 0\nRZ 0 gamma\nRX 1 -2*beta\nRZ 1 gamma+0.5\nRY 0 0.25\nMEASURE ALL\n";
+    std::string err;
+    auto c = parse_circuit_file("compiled_test.qsx", err);
+    EXPECT_TRUE(c && c->nqubits == 2);
+    if (c){
+      EXPECT_TRUE((circuit_parameters(*c) == std::vector<std::string>{"gamma", "beta"}));
+      const auto b = bind_parameters(*c, {{"gamma", 0.3}});
+      EXPECT_TRUE(b.ops[1].param.empty() && std::fabs(b.ops[1].angle - 0.3) < 1e-15);
+      EXPECT_TRUE(b.ops[2].param == "beta" && std::fabs(b.ops[3].angle - 0.8) < 1e-15);
+    }
+    std::ofstream("compiled_test_bad.qsx") << "RZ 0 2*\n";
+    EXPECT_TRUE(!parse_circuit_file("compiled_test_bad.qsx", err));
+    std::ofstream("compiled_test.qasm") << "OPENQASM 2.0;\nqreg q[2];\nrz(theta) q[0];\nrx(-2 * beta) q[1];\n";
+    auto q = parse_qasm_file("compiled_test.qasm", err);
+    EXPECT_TRUE(q && q->ops[0].param == "theta" && q->ops[1].param == "beta" && q->ops[1].param_scale == -2.0);
+  }
+
+  // optimize() merges rotations only while the angle stays affine in one parameter
+  {
+    Circuit c; c.nqubits = 1;
+    Op a{OpType::RZ, {0}, 0.5}; a.param = "t";
+    Op b{OpType::RZ, {0}, 0.25}; b.param = "t"; b.param_scale = 2.0;
+    Op u{OpType::RZ, {0}, 0.0}; u.param = "u";
+    Op neg{OpType::RZ, {0}, 0.0}; neg.param = "u"; neg.param_scale = -1.0;
+    c.ops = {{OpType::RZ, {0}, 0.1}, a, b, u, neg};
+    const auto o = optimize(c);
+    EXPECT_TRUE(o.ops.size() == 1); // u - u is a literal zero rotation and is dropped
+    EXPECT_TRUE(o.ops[0].param == "t" && o.ops[0].param_scale == 3.0 && std::fabs(o.ops[0].angle - 0.85) < 1e-15);
+    c.ops.resize(4);
+    EXPECT_TRUE(optimize(c).ops.size() == 2); // different parameters stay apart
+  }
+
+  // Compiled circuits match run() on the bound circuit, with and without fusion and reordering
+  for (std::size_t fuse : {0, 3}){
+    const auto c = random_circuit(7, 120, 5 + fuse, false, true);
+    RunOptions ro; ro.fuse_qubits = fuse; ro.block_qubits = 4;
+    auto cc = compile_circuit(c, ro);
+    EXPECT_TRUE(cc.parameters.size() == 3 && !cc.slots.empty());
+    Rng rng(17);
+    for (int trial=0;trial<4;++trial){
+      const std::vector<double> v = {rng.uniform() * 6, rng.uniform() * 6, rng.uniform() * 6};
+      const std::size_t rebuilt = bind_parameters(cc, v);
+      EXPECT_TRUE(rebuilt == cc.slots.size());
+      StateVector sv(7);
+      Rng r(3);
+      execute(sv, cc, r);
+      const auto ref = run(bind_parameters(c, named(cc, v)), 3, false, ro);
+      EXPECT_TRUE(max_diff(probabilities(sv.amplitudes()), ref.probabilities) < tol);
+    }
+    // Resuming from the state before a parameter's first window equals a full run
+    for (std::size_t k=0;k<cc.parameters.size();++k){
+      const std::size_t from = parameter_window(cc, k);
+      EXPECT_TRUE(from < cc.plan.windows.size());
+      StateVector full(7), prefix(7);
+      Rng r(9), rp(9);
+      execute(full, cc, r);
+      execute(prefix, cc, rp, 0, from);
+      execute(prefix, cc, rp, from);
+      EXPECT_TRUE(prefix.amplitudes() == full.amplitudes());
+    }
+    // Changing one parameter rebuilds only the steps that use it
+    auto v = cc.values;
+    v[1] += 0.5;
+    std::size_t using_b = 0;
+    for (const auto& slot : cc.slots) using_b += std::count(slot.index.begin(), slot.index.end(), std::size_t(1)) > 0;
+    EXPECT_TRUE(bind_parameters(cc, v) == using_b && using_b < cc.slots.size());
+    EXPECT_TRUE(bind_parameters(cc, v) == 0);
+    bool threw = false;
+    try { bind_parameters(cc, {1.0}); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+  }
+
+  // Batch evaluation: <H> per binding equals one compiled run per binding
+  {
+    const auto c = random_circuit(6, 80, 21, false, true);
+    const auto cc = compile_circuit(c, {});
+    Hamiltonian h; h.nqubits = 6;
+    h.terms = {{0.5, 0, 0b000011}, {-1.0, 0b000101, 0}, {0.25, 0b100000, 0b100000}};
+    std::vector<std::vector<double>> bindings;
+    Rng rng(8);
+    for (int b=0;b<9;++b) bindings.push_back({rng.uniform() * 6, rng.uniform() * 6, rng.uniform() * 6});
+    const auto e = expectation_batch(cc, h, bindings, 4);
+    EXPECT_TRUE(e.size() == bindings.size());
+    for (std::size_t b=0;b<bindings.size();++b){
+      StateVector sv(6);
+      Rng r(4);
+      execute(sv, bind_parameters(c, named(cc, bindings[b])), r);
+      EXPECT_TRUE(std::fabs(e[b] - expectation(sv.amplitudes(), h)) < tol);
+    }
+#ifdef QSX_OPENMP
+    // Bitwise identical for any thread count
+    for (int threads : {1, 2, 5}){
+      omp_set_num_threads(threads);
+      EXPECT_TRUE(expectation_batch(cc, h, bindings, 4) == e);
+    }
+#endif
+  }
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
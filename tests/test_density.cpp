@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/density_matrix.hpp"
+#include "quantum/gates.hpp"
+#include "quantum/channels.hpp"
+#include "quantum/qasm.hpp"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <iostream>
+#include <cmath>
+#include <vector>
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-5;
+#else
+static const double tol = 1e-12;
+#endif
+
+// A mixed 3-qubit state with non-trivial coherences on every qubit
+static DensityMatrix mixed_state(){
+  DensityMatrix dm(3);
+  using namespace qsx::gates;
+  c64 u00,u01,u10,u11;
+  for (std::size_t q=0;q<3;++q){
+    U3_coeffs(0.4 + q, 0.3*q, -0.7, u00,u01,u10,u11);
+    dm.apply_unitary_1q(q, u00,u01,u10,u11);
+  }
+  dm.apply_cx(0, 2);
+  dm.dephase(1, 0.15);
+  H_coeffs(u00,u01,u10,u11);
+  dm.apply_unitary_1q(1, u00,u01,u10,u11);
+  return dm;
+}
+
+static double max_diff(const std::vector<c64>& a, const std::vector<c64>& b){
+  double d = 0.0;
+  for (std::size_t i=0;i<a.size();++i) d = std::max(d, (double)std::abs(a[i] - b[i]));
+  return d;
+}
+
+static double trace(const DensityMatrix& dm){
+  double t = 0.0;
+  for (std::size_t i=0;i<dm.dim();++i) t += std::real(dm.data()[i*dm.dim() + i]);
+  return t;
+}
+
+static bool hermitian(const DensityMatrix& dm){
+  const std::size_t d = dm.dim();
+  for (std::size_t r=0;r<d;++r)
+    for (std::size_t c=0;c<d;++c)
+      if (std::abs(dm.data()[r*d + c] - std::conj(dm.data()[c*d + r])) > tol) return false;
+  return true;
+}
+
+int main(){
+  const double p = 0.3;
+  for (std::size_t t=0;t<3;++t){
+    const DensityMatrix rho = mixed_state();
+    // Pauli conjugations through the gate kernels
+    DensityMatrix x = rho, y = rho, z = rho;
+    x.apply_x(t);
+    c64 u00,u01,u10,u11;
+    Y_coeffs(u00,u01,u10,u11);
+    y.apply_unitary_1q(t, u00,u01,u10,u11);
+    z.apply_diag_1q(t, c64{1,0}, c64{-1,0});
+
+    // Depolarizing channel against the explicit Kraus sum
+    DensityMatrix dep = rho;
+    dep.depolarize(t, p);
+    std::vector<c64> expect(rho.data().size());
+    for (std::size_t i=0;i<expect.size();++i)
+      expect[i] = c64(1.0 - p)*rho.data()[i] + c64(p/3.0)*(x.data()[i] + y.data()[i] + z.data()[i]);
+    EXPECT_TRUE(max_diff(dep.data(), expect) < tol);
+    EXPECT_TRUE(std::fabs(trace(dep) - 1.0) < tol);
+    EXPECT_TRUE(hermitian(dep));
+
+    // Dephasing: (1-p) rho + p Z rho Z
+    DensityMatrix deph = rho;
+    deph.dephase(t, p);
+    for (std::size_t i=0;i<expect.size();++i) expect[i] = c64(1.0 - p)*rho.data()[i] + c64(p)*z.data()[i];
+    EXPECT_TRUE(max_diff(deph.data(), expect) < tol);
+  }
+
+  // Long gate sequences keep the trace without per-gate renormalisation
+  {
+    DensityMatrix dm = mixed_state();
+    using namespace qsx::gates;
+    c64 u00,u01,u10,u11;
+    for (int rep=0;rep<200;++rep){
+      RX_coeffs(0.1*rep, u00,u01,u10,u11);
+      dm.apply_unitary_1q(rep % 3, u00,u01,u10,u11);
+      dm.depolarize((rep + 1) % 3, 0.01);
+      dm.apply_cx(rep % 3, (rep + 2) % 3);
+    }
+    EXPECT_TRUE(std::fabs(trace(dm) - 1.0) < 100*tol);
+    EXPECT_TRUE(hermitian(dm));
+  }
+
+  // Generic channels agree with the dedicated kernels
+  for (std::size_t t=0;t<3;++t){
+    const DensityMatrix rho = mixed_state();
+    DensityMatrix a = rho, b = rho;
+    a.depolarize(t, p);
+    b.apply_channel(depolarizing(p), {t});
+    EXPECT_TRUE(max_diff(a.data(), b.data()) < tol);
+    a = rho; b = rho;
+    a.dephase(t, p);
+    b.apply_channel(dephasing(p), {t});
+    EXPECT_TRUE(max_diff(a.data(), b.data()) < tol);
+    // Generalized amplitude damping with a zero-temperature bath is amplitude damping
+    a = rho; b = rho;
+    a.amp_damp(t, p);
+    b.apply_channel(generalized_amplitude_damping(p, 1.0), {t});
+    EXPECT_TRUE(max_diff(a.data(), b.data()) < tol);
+    EXPECT_TRUE(std::fabs(trace(a) - 1.0) < tol);
+    EXPECT_TRUE(hermitian(a));
+  }
+
+  // Amplitude damping of |1>: population gamma moves to |0>, coherence shrinks by sqrt(1-gamma)
+  {
+    DensityMatrix dm(1);
+    c64 u00,u01,u10,u11;
+    RX_coeffs(2.0, u00,u01,u10,u11);
+    dm.apply_unitary_1q(0, u00,u01,u10,u11);
+    const std::vector<c64> before = dm.data();
+    dm.amp_damp(0, 0.25);
+    const double p1 = std::real(before[3]);
+    EXPECT_TRUE(std::fabs(std::real(dm.data()[3]) - 0.75*p1) < tol);
+    EXPECT_TRUE(std::fabs(std::real(dm.data()[0]) - (1.0 - 0.75*p1)) < tol);
+    EXPECT_TRUE(std::abs(dm.data()[1] - c64(std::sqrt(0.75))*before[1]) < tol);
+  }
+
+  // Thermal relaxation: populations relax with T1 towards pe, coherences decay with T2
+  {
+    const double t1 = 50.0, t2 = 30.0, t = 10.0, pe = 0.1;
+    DensityMatrix dm(1);
+    c64 u00,u01,u10,u11;
+    gates::H_coeffs(u00,u01,u10,u11);
+    dm.apply_unitary_1q(0, u00,u01,u10,u11);
+    dm.apply_channel(thermal_relaxation(t1, t2, t, pe), {0});
+    const double e1 = std::exp(-t/t1);
+    EXPECT_TRUE(std::fabs(std::real(dm.data()[3]) - (pe + (0.5 - pe)*e1)) < tol);
+    EXPECT_TRUE(std::fabs(std::real(dm.data()[1]) - 0.5*std::exp(-t/t2)) < tol);
+    bool threw = false;
+    try { thermal_relaxation(10.0, 30.0, 1.0); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+  }
+
+  // Kraus, superoperator and PTM forms round-trip
+  {
+    const Channel ad = amplitude_damping(0.3);
+    const Channel back = channel_from_ptm(channel_ptm(ad), 1);
+    EXPECT_TRUE(max_diff(ad.superop, back.superop) < tol);
+    const auto R = channel_ptm(depolarizing(p));
+    EXPECT_TRUE(std::fabs(R[0] - 1.0) < tol && std::fabs(R[5] - (1.0 - 4.0*p/3.0)) < tol);
+  }
+
+  // Two-qubit depolarizing against the sum over all 16 Pauli pairs
+  {
+    const DensityMatrix rho = mixed_state();
+    const std::size_t q0 = 2, q1 = 0;
+    DensityMatrix got = rho;
+    got.apply_channel(depolarizing_2q(p), {q0, q1});
+    std::vector<c64> expect(rho.data().size(), c64{0, 0});
+    for (int a=0;a<4;++a)
+      for (int b=0;b<4;++b){
+        DensityMatrix term = rho;
+        for (auto [q, pa] : {std::pair<std::size_t,int>{q0, a}, {q1, b}}){
+          c64 u00,u01,u10,u11;
+          if (pa == 1) term.apply_x(q);
+          if (pa == 2){ Y_coeffs(u00,u01,u10,u11); term.apply_unitary_1q(q, u00,u01,u10,u11); }
+          if (pa == 3) term.apply_diag_1q(q, c64{1,0}, c64{-1,0});
+        }
+        const double w = (a == 0 && b == 0) ? 1.0 - p : p/15.0;
+        for (std::size_t i=0;i<expect.size();++i) expect[i] += c64(w)*term.data()[i];
+      }
+    EXPECT_TRUE(max_diff(got.data(), expect) < tol);
+  }
+
+  // AMPDAMP in both circuit formats
+  {
+    std::string err;
+    std::ofstream("density_test.qsx") << "X 0\nAMPDAMP 0 0.3\n";
+    auto c = parse_circuit_file("density_test.qsx", err);
+    EXPECT_TRUE(c && c->ops.size() == 2 && c->ops[1].type == OpType::AMPDAMP);
+    std::ofstream("density_test_bad.qsx") << "AMPDAMP 0 1.5\n";
+    EXPECT_TRUE(!parse_circuit_file("density_test_bad.qsx", err).has_value());
+    std::ofstream("density_test.qasm") << "OPENQASM 2.0;\nqreg q[1];\nx q[0];\nampdamp(0.3) q[0];\n";
+    auto qc = parse_qasm_file("density_test.qasm", err);
+    EXPECT_TRUE(qc && qc->ops.size() == 2 && qc->ops[1].type == OpType::AMPDAMP && qc->ops[1].angle == 0.3);
+    for (const char* f : {"density_test.qsx", "density_test_bad.qsx", "density_test.qasm"}) std::remove(f);
+    if (c){
+      auto r = run_density(*c, 1, false);
+      EXPECT_TRUE(std::fabs(r.probabilities[0] - 0.3) < tol);
+    }
+  }
+
+  // Packed storage: every kernel against the full layout, including fused steps
+  {
+    Circuit c; c.nqubits = 4;
+    std::vector<double> u2q(32, 0.0);
+    for (std::size_t i=0;i<4;++i){ u2q[2*(i*4 + (i ^ 3))] = std::cos(0.3*i); u2q[2*(i*4 + (i ^ 3)) + 1] = std::sin(0.3*i); }
+    for (std::size_t q=0;q<4;++q) c.ops.push_back({OpType::U3, {q}, 0.0, {0.5 + q, 0.2*q, -0.4}});
+    c.ops.push_back({OpType::CNOT, {3, 1}, 0.0});
+    c.ops.push_back({OpType::DEPOL, {2}, 0.1});
+    c.ops.push_back({OpType::CCX, {0, 3, 2}, 0.0});
+    c.ops.push_back({OpType::RZ, {1}, 0.7});
+    c.ops.push_back({OpType::CZ, {2, 0}, 0.0});
+    c.ops.push_back({OpType::AMPDAMP, {3}, 0.2});
+    c.ops.push_back({OpType::SWAP, {1, 3}, 0.0});
+    c.ops.push_back({OpType::U2Q, {2, 1}, 0.0, u2q});
+    c.ops.push_back({OpType::DEPHASE, {0}, 0.3});
+    c.ops.push_back({OpType::H, {3}, 0.0});
+    c.ops.push_back({OpType::X, {2}, 0.0});
+    c.ops.push_back({OpType::S, {1}, 0.0});
+
+    DensityMatrix full(4), packed(4, DensityStorage::Packed);
+    EXPECT_TRUE(packed.data().size() == 16*17/2);
+    for (const auto& op : c.ops){ full.apply_op(op); packed.apply_op(op); }
+    double d = 0.0;
+    for (std::size_t r=0;r<16;++r) for (std::size_t col=0;col<16;++col) d = std::max(d, (double)std::abs(full.at(r, col) - packed.at(r, col)));
+    EXPECT_TRUE(d < tol);
+
+    DensityMatrix fused(4, DensityStorage::Packed);
+    for (const auto& st : compile_density(c).steps) fused.apply_step(st);
+    d = 0.0;
+    for (std::size_t r=0;r<16;++r) for (std::size_t col=0;col<16;++col) d = std::max(d, (double)std::abs(full.at(r, col) - fused.at(r, col)));
+    EXPECT_TRUE(d < tol);
+
+    auto a = run_density(c, 3, false);
+    auto b = run_density(c, 3, false, DensityMode::Packed);
+    for (std::size_t i=0;i<a.probabilities.size();++i) EXPECT_TRUE(std::fabs(a.probabilities[i] - b.probabilities[i]) < tol);
+    EXPECT_TRUE(a.outcome == b.outcome);
+  }
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
@@ -10,6 +10,12 @@ using namespace qsx;
 static int fails=0;
 #define CHECK_NEAR(a,b,e) do{ if (std::fabs((a)-(b))>(e)) { std::cerr << "Mismatch: " << (a) << " vs " << (b) << "\n"; ++fails; } }while(0)
 
+#ifdef QSX_FP32
+static const double tol = 1e-5;
+#else
+static const double tol = 1e-12;
+#endif
+
 int main(){
   Circuit c; c.nqubits=2;
   c.ops.push_back({OpType::H,{0},0.0});
@@ -18,7 +24,84 @@ int main(){
   auto r1 = run(c, 123, false);
   // Density matrix (unitary only)
   auto r2 = run_density(c, 123, false);
-  for (size_t i=0;i<r1.probabilities.size();++i) CHECK_NEAR(r1.probabilities[i], r2.probabilities[i], 1e-12);
+  for (size_t i=0;i<r1.probabilities.size();++i) CHECK_NEAR(r1.probabilities[i], r2.probabilities[i], tol);
+
+  // Diagonal (Z, S, RZ) and permutation (X, CNOT) kernels interleaved with mixing gates,
+  // so wrong off-diagonal phases show up in the final probabilities
+  Circuit q; q.nqubits=3;
+  for (std::size_t k=0;k<3;++k) q.ops.push_back({OpType::H,{k},0.0});
+  q.ops.push_back({OpType::RY,{1},0.7});
+  q.ops.push_back({OpType::RZ,{0},0.9});
+  q.ops.push_back({OpType::S,{1},0.0});
+  q.ops.push_back({OpType::CNOT,{2,0},0.0});
+  q.ops.push_back({OpType::Z,{2},0.0});
+  q.ops.push_back({OpType::X,{1},0.0});
+  q.ops.push_back({OpType::RZ,{2},-1.3});
+  q.ops.push_back({OpType::Y,{0},0.0});
+  q.ops.push_back({OpType::RX,{2},0.4});
+  for (std::size_t k=0;k<3;++k) q.ops.push_back({OpType::H,{k},0.0});
+  auto q1 = run(q, 7, false);
+  auto q2 = run_density(q, 7, false);
+  for (size_t i=0;i<q1.probabilities.size();++i) CHECK_NEAR(q1.probabilities[i], q2.probabilities[i], tol);
+
+  // Multi-qubit gates (Toffoli, CZ, SWAP, U3 and a dense two-qubit block with reversed qubit order)
+  Circuit g; g.nqubits=4;
+  for (std::size_t k=0;k<4;++k) g.ops.push_back({OpType::H,{k},0.0});
+  g.ops.push_back({OpType::RY,{3},0.5});
+  g.ops.push_back({OpType::CCX,{3,0,2},0.0});
+  g.ops.push_back({OpType::U3,{1},0.0,{0.3,-0.8,1.2}});
+  g.ops.push_back({OpType::CZ,{2,1},0.0});
+  g.ops.push_back({OpType::SWAP,{0,3},0.0});
+  std::vector<double> u2q(32);
+  // kron(RY(0.9) on qubits[1], RX(0.4) on qubits[0]) written out as a 4x4 block
+  double cy = std::cos(0.45), sy = std::sin(0.45), cx = std::cos(0.2), sx = std::sin(0.2);
+  c64 ry[2][2] = {{c64(cy), c64(sy)}, {c64(-sy), c64(cy)}}, rx[2][2] = {{c64(cx), c64(0,-sx)}, {c64(0,-sx), c64(cx)}};
+  for (int r=0;r<4;++r) for (int cc=0;cc<4;++cc){
+    c64 v = ry[r>>1][cc>>1] * rx[r&1][cc&1];
+    u2q[2*(r*4+cc)] = v.real(); u2q[2*(r*4+cc)+1] = v.imag();
+  }
+  g.ops.push_back({OpType::U2Q,{2,0},0.0,u2q});
+  g.ops.push_back({OpType::CCX,{1,2,3},0.0});
+  for (std::size_t k=0;k<4;++k) g.ops.push_back({OpType::RX,{k},0.3*(k+1)});
+  auto g1 = run(g, 11, false);
+  auto g2 = run_density(g, 11, false);
+  for (size_t i=0;i<g1.probabilities.size();++i) CHECK_NEAR(g1.probabilities[i], g2.probabilities[i], tol);
+
+  // The same block equals RX on qubit 2 followed by RY on qubit 0
+  Circuit h = g; h.ops.clear();
+  h.ops.push_back({OpType::H,{0},0.0});
+  h.ops.push_back({OpType::U2Q,{2,0},0.0,u2q});
+  Circuit h2 = h; h2.ops.pop_back();
+  h2.ops.push_back({OpType::RX,{2},0.4});
+  h2.ops.push_back({OpType::RY,{0},0.9});
+  auto h1 = run(h, 1, false), hh = run(h2, 1, false);
+  for (size_t i=0;i<h1.probabilities.size();++i) CHECK_NEAR(h1.probabilities[i], hh.probabilities[i], tol);
+
+  // Vectorised density (2n-qubit state through the state-vector engine) against DensityMatrix,
+  // with noise channels, plain and with fusion / small cache blocks
+  Circuit nz = g;
+  nz.ops.insert(nz.ops.begin() + 5, {OpType::DEPOL,{1},0.1});
+  nz.ops.insert(nz.ops.begin() + 8, {OpType::DEPHASE,{2},0.2});
+  nz.ops.push_back({OpType::S,{3},0.0});
+  nz.ops.push_back({OpType::Y,{0},0.0});
+  nz.ops.push_back({OpType::DEPOL,{0},0.05});
+  for (std::size_t k=0;k<4;++k) nz.ops.push_back({OpType::H,{k},0.0});
+  auto m1 = run_density(nz, 3, false);
+  for (std::size_t fuse : {0, 3}){
+    RunOptions o; o.fuse_qubits = fuse; o.block_qubits = 4;
+    auto m2 = run_density(nz, 3, false, DensityMode::Vectorized, o);
+    for (size_t i=0;i<m1.probabilities.size();++i) CHECK_NEAR(m1.probabilities[i], m2.probabilities[i], tol);
+    if (m1.outcome != m2.outcome) ++fails;
+  }
+
+  // Amplitude damping from |1>: P(1) = 1 - gamma
+  Circuit ad; ad.nqubits=1;
+  ad.ops.push_back({OpType::X,{0},0.0});
+  ad.ops.push_back({OpType::AMPDAMP,{0},0.3});
+  auto a1 = run_density(ad, 1, false, DensityMode::Vectorized);
+  CHECK_NEAR(a1.probabilities[1], 0.7, tol);
+  auto a0 = run_density(ad, 1, false);
+  CHECK_NEAR(a0.probabilities[1], 0.7, tol);
   if (fails==0) std::cout << "OK\n";
   return fails==0?0:1;
 }
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/equiv.hpp"
+#include "quantum/optimize.hpp"
+#include "quantum/map.hpp"
+#include "quantum/map_topo.hpp"
+#include "test_util.hpp"
+#include <iostream>
+#include <cmath>
+#include <stdexcept>
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-4;
+#else
+static const double tol = 1e-10;
+#endif
+
+int main(){
+  // optimize() and the routers preserve the unitary (the routers up to their final layout)
+  for (uint64_t seed : {1, 2, 3}){
+    const auto c = random_circuit(6, 80, seed);
+    const auto opt = check_equivalence(c, optimize(c), seed);
+    EXPECT_TRUE(opt.equivalent && opt.trials == 20);
+    EXPECT_TRUE(opt.max_deviation < tol);
+
+    std::vector<std::size_t> layout;
+    const auto line = map_to_line(c, &layout);
+    EquivOptions eo; eo.output_layout = layout;
+    EXPECT_TRUE(check_equivalence(c, line, seed, eo).equivalent);
+    bool moved = false;
+    for (std::size_t q=0;q<layout.size();++q) moved |= layout[q] != q;
+    if (moved) EXPECT_TRUE(!check_equivalence(c, line, seed).equivalent);
+
+    std::vector<std::vector<std::size_t>> ring(6);
+    for (std::size_t q=0;q<6;++q){ ring[q].push_back((q + 1) % 6); ring[(q + 1) % 6].push_back(q); }
+    std::vector<std::size_t> ring_layout;
+    const auto mapped = map_to_topology(c, ring, &ring_layout);
+    eo.output_layout = ring_layout;
+    EXPECT_TRUE(check_equivalence(c, mapped, seed, eo).equivalent);
+  }
+
+  // Global phases are accepted and reported; small changes are not
+  {
+    const auto c = random_circuit(5, 60, 9);
+    Circuit neg = c;
+    for (OpType t : {OpType::X, OpType::Z, OpType::X, OpType::Z}) neg.ops.push_back({t, {2}, 0.0}); // (XZ)^2 = -I
+    const auto r = check_equivalence(c, neg, 4);
+    EXPECT_TRUE(r.equivalent);
+    EXPECT_TRUE(std::abs(r.phase + 1.0) < tol);
+
+    Circuit rz = c;
+    rz.ops.push_back({OpType::RZ, {3}, 1e-2});
+    const auto bad = check_equivalence(c, rz, 4);
+    EXPECT_TRUE(!bad.equivalent && bad.trials == bad.first_mismatch + 1);
+
+    // A Clifford difference that random stabilizer inputs see
+    Circuit cz = c;
+    cz.ops.push_back({OpType::CZ, {0, 4}, 0.0});
+    EquivOptions few; few.trials = 4;
+    EXPECT_TRUE(!check_equivalence(c, cz, 4, few).equivalent);
+  }
+
+  // Above the parallel-inputs size: inputs run one at a time on threaded kernels
+  {
+    const auto c = random_circuit(16, 200, 11);
+    EquivOptions eo; eo.confidence = 0.999;
+    const auto r = check_equivalence(c, optimize(c), 11, eo);
+    EXPECT_TRUE(r.equivalent && r.trials == 10);
+    Circuit swapped = c;
+    swapped.ops.push_back({OpType::SWAP, {0, 15}, 0.0});
+    EXPECT_TRUE(!check_equivalence(c, swapped, 11, eo).equivalent);
+  }
+
+  // Noise ops and mismatched circuits are rejected
+  {
+    Circuit a; a.nqubits = 2; a.ops.push_back({OpType::H, {0}, 0.0});
+    Circuit b = a; b.ops.push_back({OpType::DEPOL, {1}, 0.1});
+    bool threw = false;
+    try { check_equivalence(a, b, 1); } catch (const std::runtime_error&) { threw = true; }
+    EXPECT_TRUE(threw);
+    Circuit wide = a; wide.nqubits = 3;
+    threw = false;
+    try { check_equivalence(a, wide, 1); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+  }
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/circuit.hpp"
+#include "quantum/fusion.hpp"
+#include "test_util.hpp"
+#include <iostream>
+#include <cmath>
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+#define EXPECT_NEAR(a,b,eps) do{ if (std::fabs((a)-(b))>(eps)) { std::cerr << "EXPECT_NEAR failed at " << __LINE__ << ": " << (a) << " vs " << (b) << "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-4;
+#else
+static const double tol = 1e-10;
+#endif
+
+int main(){
+  // Fused execution matches gate-by-gate execution for every block size
+  for (bool noisy : {false, true}){
+    for (std::size_t k=2;k<=5;++k){
+      auto c = random_circuit(7, 200, 17 + k, noisy);
+      auto ref = run(c, 5, false);
+      RunOptions opts; opts.fuse_qubits = k;
+      auto got = run(c, 5, false, opts);
+      for (std::size_t i=0;i<ref.probabilities.size();++i) EXPECT_NEAR(got.probabilities[i], ref.probabilities[i], tol);
+      EXPECT_TRUE(got.outcome == ref.outcome);
+    }
+  }
+
+  // Block structure: every block spans at most k qubits and the gate count is preserved
+  auto c = random_circuit(10, 400, 3, false);
+  for (std::size_t k=2;k<=5;++k){
+    auto fc = fuse_gates(c, k);
+    std::size_t gates = 0;
+    for (const auto& f : fc.ops){
+      if (f.is_block()){
+        EXPECT_TRUE(f.qubits.size() <= k);
+        EXPECT_TRUE(f.matrix.size() == (std::size_t(1) << (2*f.qubits.size())));
+      }
+      if (f.is_block() || f.op.type != OpType::MEASURE) gates += f.gates;
+    }
+    EXPECT_TRUE(gates == fc.source_gates);
+    EXPECT_TRUE(fc.fused_gates < fc.source_gates);
+  }
+
+  // Two H gates on the same qubit fuse to the identity
+  Circuit hh; hh.nqubits = 2;
+  hh.ops.push_back({OpType::H, {1}, 0.0});
+  hh.ops.push_back({OpType::CNOT, {0, 1}, 0.0});
+  hh.ops.push_back({OpType::CNOT, {0, 1}, 0.0});
+  hh.ops.push_back({OpType::H, {1}, 0.0});
+  auto fh = fuse_gates(hh, 2);
+  EXPECT_TRUE(fh.ops.size() == 1 && fh.fused_gates == 1);
+  for (std::size_t r=0;r<4;++r) for (std::size_t j=0;j<4;++j)
+    EXPECT_NEAR(std::abs(fh.ops[0].matrix[r*4 + j]), r==j ? 1.0 : 0.0, tol);
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
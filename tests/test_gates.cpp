@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/circuit.hpp"
+#include "quantum/qasm.hpp"
+#include "quantum/unitary.hpp"
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-5;
+#else
+static const double tol = 1e-12;
+#endif
+
+static StateVector random_state(std::size_t n, uint64_t seed){
+  StateVector sv(n);
+  Rng rng(seed);
+  for (auto& a : sv.amplitudes_mut()) a = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+  return sv;
+}
+
+static double max_diff(const vec_c64& a, const vec_c64& b){
+  double d = 0.0;
+  for (std::size_t i=0;i<a.size();++i) d = std::max(d, (double)std::abs(a[i] - b[i]));
+  return d;
+}
+
+static bool bit(std::size_t i, std::size_t q){ return (i >> q) & 1; }
+
+int main(){
+  const std::size_t n = 4;
+  // Multi-qubit gates against direct index manipulation, for every qubit assignment
+  for (std::size_t a=0;a<n;++a) for (std::size_t b=0;b<n;++b){
+    if (a == b) continue;
+    for (std::size_t t=0;t<n;++t){
+      if (t == a || t == b) continue;
+      auto sv = random_state(n, a*16 + b*4 + t);
+      auto ref = sv.amplitudes();
+      apply_unitary(sv, {OpType::CCX, {a, b, t}, 0.0});
+      for (std::size_t i=0;i<ref.size();++i) if (bit(i, a) && bit(i, b) && !bit(i, t)) std::swap(ref[i], ref[i | (std::size_t(1) << t)]);
+      EXPECT_TRUE(max_diff(sv.amplitudes(), ref) < tol);
+    }
+    auto sv = random_state(n, a*4 + b);
+    auto ref = sv.amplitudes();
+    apply_unitary(sv, {OpType::CZ, {a, b}, 0.0});
+    for (std::size_t i=0;i<ref.size();++i) if (bit(i, a) && bit(i, b)) ref[i] = -ref[i];
+    EXPECT_TRUE(max_diff(sv.amplitudes(), ref) < tol);
+
+    sv = random_state(n, a*4 + b + 100);
+    ref = sv.amplitudes();
+    apply_unitary(sv, {OpType::SWAP, {a, b}, 0.0});
+    auto moved = ref;
+    for (std::size_t i=0;i<ref.size();++i){
+      std::size_t j = i & ~((std::size_t(1) << a) | (std::size_t(1) << b));
+      j |= std::size_t(bit(i, a)) << b | std::size_t(bit(i, b)) << a;
+      moved[j] = ref[i];
+    }
+    EXPECT_TRUE(max_diff(sv.amplitudes(), moved) < tol);
+
+    // U2Q with the CNOT matrix (control = local bit 0) equals CNOT a b in either qubit order
+    std::vector<double> cx(32, 0.0);
+    for (auto [r, c] : {std::pair{0, 0}, {3, 1}, {2, 2}, {1, 3}}) cx[2*(r*4 + c)] = 1.0;
+    auto s1 = random_state(n, a + 7*b), s2 = s1;
+    apply_unitary(s1, {OpType::U2Q, {a, b}, 0.0, cx});
+    apply_unitary(s2, {OpType::CNOT, {a, b}, 0.0});
+    EXPECT_TRUE(max_diff(s1.amplitudes(), s2.amplitudes()) < tol);
+  }
+
+  // U3 special cases: U3(π, 0, π) = X, U3(θ, -π/2, π/2) = RX(θ)
+  {
+    const double pi = std::numbers::pi;
+    auto s1 = random_state(3, 5), s2 = s1;
+    apply_unitary(s1, {OpType::U3, {1}, 0.0, {pi, 0.0, pi}});
+    apply_unitary(s2, {OpType::X, {1}, 0.0});
+    EXPECT_TRUE(max_diff(s1.amplitudes(), s2.amplitudes()) < tol);
+    apply_unitary(s1, {OpType::U3, {2}, 0.0, {-1.1, -pi/2, pi/2}});
+    apply_unitary(s2, {OpType::RX, {2}, -1.1});
+    EXPECT_TRUE(max_diff(s1.amplitudes(), s2.amplitudes()) < tol);
+  }
+
+  // build_unitary agrees with state-vector execution (columns are images of basis states)
+  {
+    Circuit c; c.nqubits = 3;
+    c.ops.push_back({OpType::H, {0}, 0.0});
+    c.ops.push_back({OpType::RY, {2}, 0.3});
+    c.ops.push_back({OpType::CCX, {0, 2, 1}, 0.0});
+    c.ops.push_back({OpType::U3, {1}, 0.0, {0.4, 0.5, 0.6}});
+    c.ops.push_back({OpType::CZ, {1, 2}, 0.0});
+    c.ops.push_back({OpType::SWAP, {0, 2}, 0.0});
+    c.ops.push_back({OpType::CNOT, {2, 0}, 0.0});
+    auto U = build_unitary(c);
+    const std::size_t d = 8;
+    for (std::size_t j=0;j<d;++j){
+      StateVector sv(3);
+      sv.amplitudes_mut()[0] = 0.0; sv.amplitudes_mut()[j] = 1.0;
+      for (const auto& op : c.ops) apply_unitary(sv, op);
+      for (std::size_t i=0;i<d;++i) EXPECT_TRUE(std::abs(U[i*d + j] - sv.amplitudes()[i]) < tol);
+    }
+  }
+
+  // Same on 7 qubits with fusion and cache blocking of the 14-qubit column-stacked vector
+  {
+    Circuit c; c.nqubits = 7;
+    for (std::size_t q=0;q<7;++q){
+      c.ops.push_back({OpType::RX, {q}, 0.2 + 0.1*double(q)});
+      c.ops.push_back({OpType::S, {q}, 0.0});
+      c.ops.push_back({OpType::CNOT, {q, (q + 3) % 7}, 0.0});
+    }
+    c.ops.push_back({OpType::CCX, {6, 0, 3}, 0.0});
+    RunOptions opts; opts.fuse_qubits = 3; opts.block_qubits = 8;
+    auto U = build_unitary(c, opts);
+    const std::size_t d = 128;
+    for (std::size_t j : {std::size_t(0), std::size_t(5), std::size_t(77), std::size_t(127)}){
+      StateVector sv(7);
+      sv.amplitudes_mut()[0] = 0.0; sv.amplitudes_mut()[j] = 1.0;
+      for (const auto& op : c.ops) apply_unitary(sv, op);
+      for (std::size_t i=0;i<d;++i) EXPECT_TRUE(std::abs(U[i*d + j] - sv.amplitudes()[i]) < 10*tol);
+    }
+  }
+
+  // Parsing: .qsx and QASM spellings of the new gates
+  {
+    std::ofstream("gates_test.qsx") << "CCX 0 1 2\nCZ 2 3\nSWAP 0 3\nU3 1 0.1 0.2 0.3\n"
+                                       "U2Q 3 1 1 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0 1 0 0 0 0 0 0 0 0 0 1 0\n"
+                                       "MEASURE ALL\n";
+    std::string err;
+    auto c = parse_circuit_file("gates_test.qsx", err);
+    EXPECT_TRUE(c.has_value());
+    if (c){
+      EXPECT_TRUE(c->nqubits == 4 && c->ops.size() == 6);
+      EXPECT_TRUE(c->ops[0].type == OpType::CCX && c->ops[0].qubits == (std::vector<std::size_t>{0, 1, 2}));
+      EXPECT_TRUE(c->ops[3].type == OpType::U3 && c->ops[3].params.size() == 3);
+      EXPECT_TRUE(c->ops[4].type == OpType::U2Q && c->ops[4].params.size() == 32 && c->ops[4].qubits[0] == 3);
+    }
+    std::ofstream("gates_test_bad.qsx") << "CCX 0 0 2\n";
+    EXPECT_TRUE(!parse_circuit_file("gates_test_bad.qsx", err).has_value());
+
+    std::ofstream("gates_test.qasm") << "OPENQASM 2.0;\nqreg q[4];\nccx q[0], q[1], q[3];\ncz q[1], q[2];\n"
+                                        "swap q[0], q[2];\nu3(0.1, 0.2, 0.3) q[2];\nmeasure q -> c;\n";
+    auto qc = parse_qasm_file("gates_test.qasm", err);
+    EXPECT_TRUE(qc.has_value());
+    if (qc){
+      EXPECT_TRUE(qc->ops.size() == 5);
+      EXPECT_TRUE(qc->ops[0].type == OpType::CCX && qc->ops[0].qubits == (std::vector<std::size_t>{0, 1, 3}));
+      EXPECT_TRUE(qc->ops[3].type == OpType::U3 && qc->ops[3].qubits[0] == 2 && std::fabs(qc->ops[3].params[2] - 0.3) < 1e-12);
+    }
+    // pi expressions in every parameter slot; malformed values are errors, not exceptions
+    std::ofstream("gates_test_pi.qasm") << "OPENQASM 2.0;\nqreg q[2];\nu3(pi/2, 0, -3*pi/4) q[0];\nrx(0.5*pi) q[1];\n"
+                                           "depol(1/4) q[0];\n";
+    auto pc = parse_qasm_file("gates_test_pi.qasm", err);
+    EXPECT_TRUE(pc.has_value());
+    if (pc){
+      const double pi = std::numbers::pi;
+      EXPECT_TRUE(std::fabs(pc->ops[0].params[0] - pi / 2) < 1e-15 && std::fabs(pc->ops[0].params[2] + 3 * pi / 4) < 1e-15);
+      EXPECT_TRUE(std::fabs(pc->ops[1].angle - pi / 2) < 1e-15 && pc->ops[1].param.empty());
+      EXPECT_TRUE(pc->ops[2].angle == 0.25);
+    }
+    for (const char* bad : {"u3(pi/2, x, 0) q[0];", "u3(1, 2) q[0];", "u3(pi/0, 0, 0) q[0];", "depol(nan) q[0];", "rx(2**pi) q[0];"}){
+      std::ofstream("gates_test_bad.qasm") << "OPENQASM 2.0;\nqreg q[1];\n" << bad << "\n";
+      EXPECT_TRUE(!parse_qasm_file("gates_test_bad.qasm", err).has_value());
+    }
+    for (const char* f : {"gates_test.qsx", "gates_test_bad.qsx", "gates_test.qasm", "gates_test_pi.qasm", "gates_test_bad.qasm"}) std::remove(f);
+  }
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
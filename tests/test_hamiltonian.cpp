@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/hamiltonian.hpp"
+#include "quantum/grad.hpp"
+#include "quantum/state_vector.hpp"
+#include "quantum/reduce.hpp"
+#include "quantum/random.hpp"
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-4;
+#else
+static const double tol = 1e-10;
+#endif
+
+// P|a> with the state-vector gates, one qubit at a time
+static StateVector apply_term(const StateVector& sv, const PauliTerm& t){
+  StateVector out = sv;
+  for (std::size_t q=0;q<sv.num_qubits();++q){
+    const bool x = (t.x_mask >> q) & 1, z = (t.z_mask >> q) & 1;
+    if (x && z) out.apply_gate_1q(q, c64{0, 0}, c64{0, -1}, c64{0, 1}, c64{0, 0});
+    else if (x) out.apply_x(q);
+    else if (z) out.apply_diag_1q(q, c64{1, 0}, c64{-1, 0});
+  }
+  return out;
+}
+
+int main(){
+  // Pauli strings
+  {
+    std::string err;
+    auto t = parse_pauli_string("X0z1Y3", 4, err);
+    EXPECT_TRUE(t && t->x_mask == 0b1001 && t->z_mask == 0b1010 && t->coeff == 1.0);
+    auto id = parse_pauli_string(" I ", 2, err);
+    EXPECT_TRUE(id && id->x_mask == 0 && id->z_mask == 0);
+    EXPECT_TRUE(!parse_pauli_string("X4", 4, err));
+    EXPECT_TRUE(!parse_pauli_string("X0X0", 4, err));
+    EXPECT_TRUE(!parse_pauli_string("Q0", 4, err));
+    EXPECT_TRUE(!parse_pauli_string("Z", 4, err));
+    EXPECT_TRUE(!parse_pauli_string("", 4, err));
+  }
+
+  // Hamiltonian files: comments, spaces inside strings, merged duplicates
+  {
+    std::ofstream("hamiltonian_test.txt") << "# H2-like\n0.5 Z0Z1\n\n-1.25 X0 Y2  # inline\n0.25 I\n0.5 z0 z1\n";
+    std::string err;
+    auto h = parse_hamiltonian_file("hamiltonian_test.txt", 3, err);
+    EXPECT_TRUE(h && h->terms.size() == 3);
+    if (h){
+      EXPECT_TRUE(h->terms[0].coeff == 1.0 && h->terms[0].z_mask == 0b011);
+      EXPECT_TRUE(h->terms[1].coeff == -1.25 && h->terms[1].x_mask == 0b101 && h->terms[1].z_mask == 0b100);
+      EXPECT_TRUE(h->terms[2].x_mask == 0 && h->terms[2].z_mask == 0);
+    }
+    std::ofstream("hamiltonian_test_bad.txt") << "0.5 Z0\nZ1 0.5\n";
+    EXPECT_TRUE(!parse_hamiltonian_file("hamiltonian_test_bad.txt", 3, err));
+    EXPECT_TRUE(err.find("line 2") != std::string::npos);
+    std::remove("hamiltonian_test.txt");
+    std::remove("hamiltonian_test_bad.txt");
+  }
+
+  // <H> and H|a> against term-by-term application
+  Rng rng(3);
+  for (std::size_t n : {1, 5, 15}){
+    StateVector sv(n);
+    auto& a = sv.amplitudes_mut();
+    for (auto& x : a) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+    scale_amplitudes(a.data(), a.size(), 1.0 / std::sqrt(norm_squared(a.data(), a.size())));
+    Hamiltonian h; h.nqubits = n;
+    const std::uint64_t full = (std::uint64_t(1) << n) - 1;
+    // Half the terms diagonal and a quarter on one X mask: both groups take the Walsh path
+    for (std::size_t t=0;t<80;++t){
+      const std::uint64_t random_x = std::uint64_t(rng.uniform() * double(full + 1)) & full;
+      const std::uint64_t xm = t % 2 == 0 ? 0 : t % 4 == 1 ? (0x5555 & full) : random_x;
+      const std::uint64_t zm = std::uint64_t(rng.uniform() * double(full + 1)) & full;
+      h.terms.push_back({rng.uniform() - 0.5, xm, zm});
+    }
+    double ref = 0.0;
+    vec_c64 ref_h(a.size(), c64{0, 0});
+    for (const auto& t : h.terms){
+      const auto p = apply_term(sv, t);
+      ref += t.coeff * inner_product(a.data(), p.amplitudes().data(), a.size()).real();
+      for (std::size_t i=0;i<a.size();++i) ref_h[i] += c64(t.coeff) * p.amplitudes()[i];
+    }
+    EXPECT_TRUE(std::fabs(expectation(a, h) - ref) < tol * 10);
+    vec_c64 got;
+    apply_hamiltonian(a, h, got);
+    double diff = 0.0;
+    for (std::size_t i=0;i<a.size();++i) diff = std::max(diff, (double)std::abs(got[i] - ref_h[i]));
+    EXPECT_TRUE(diff < tol * 10);
+    EXPECT_TRUE(std::fabs(inner_product(a.data(), got.data(), a.size()).real() - expectation(a, h)) < tol * 10);
+  }
+
+  // d<H>/d theta: both gradient methods against the shift rule applied by hand to expectation()
+  {
+    Circuit c; c.nqubits = 3;
+    for (std::size_t l=0;l<2;++l){
+      for (std::size_t q=0;q<3;++q){
+        c.ops.push_back({OpType::RY,{q}, 0.7 * double(q + l) - 0.4});
+        c.ops.push_back({OpType::RZ,{q}, 0.3 - 0.5 * double(q)});
+      }
+      c.ops.push_back({OpType::CNOT,{0,1},0.0});
+      c.ops.push_back({OpType::CNOT,{1,2},0.0});
+      c.ops.push_back({OpType::RX,{2}, 1.1 * double(l) + 0.2});
+    }
+    Hamiltonian h; h.nqubits = 3;
+    std::string err;
+    for (const char* term : {"Z0Z1", "X1Y2", "Y0X2", "Z2"}) h.terms.push_back(*parse_pauli_string(term, 3, err));
+    for (std::size_t t=0;t<h.terms.size();++t) h.terms[t].coeff = 0.5 - 0.4 * double(t);
+    auto energy = [&](const Circuit& g){
+      StateVector sv(3);
+      Rng r(1);
+      execute(sv, g, r);
+      return expectation(sv.amplitudes(), h);
+    };
+    const auto ad = grad_expectation_adjoint(c, h, {});
+    const auto ps = grad_expectation_parameter_shift(c, h, {}, 1);
+    EXPECT_TRUE(ad && ps && ad->grads.size() == 14 && ps->grads.size() == 14);
+    if (ad && ps){
+      EXPECT_TRUE(std::fabs(ad->expectation - energy(c)) < tol * 10 && std::fabs(ps->expectation - energy(c)) < tol * 10);
+      for (std::size_t k=0;k<ad->param_op_indices.size();++k){
+        Circuit plus = c, minus = c;
+        plus.ops[ad->param_op_indices[k]].angle += M_PI / 2;
+        minus.ops[ad->param_op_indices[k]].angle -= M_PI / 2;
+        const double ref = 0.5 * (energy(plus) - energy(minus));
+        EXPECT_TRUE(std::fabs(ad->grads[k][0] - ref) < tol * 10);
+        EXPECT_TRUE(std::fabs(ps->grads[k][0] - ref) < tol * 10);
+      }
+    }
+  }
+
+#ifdef QSX_OPENMP
+  // Bitwise identical for any thread count
+  {
+    const std::size_t n = 17;
+    vec_c64 a(std::size_t(1) << n);
+    for (auto& x : a) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+    Hamiltonian h; h.nqubits = n;
+    for (std::uint64_t t=1;t<20;++t) h.terms.push_back({0.1 * double(t), (t * 2654435761u) & 0x1ffff, (t * 40503u) & 0x1ffff});
+    omp_set_num_threads(1);
+    const double e1 = expectation(a, h);
+    for (int threads : {2, 3, 7}){
+      omp_set_num_threads(threads);
+      EXPECT_TRUE(expectation(a, h) == e1);
+    }
+  }
+#endif
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/reduce.hpp"
+#include "quantum/random.hpp"
+#include <iostream>
+#include <cmath>
+#include <vector>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+int main(){
+  Rng rng(5);
+  // Marginals against the per-qubit loop, for states below, at and above one reduction chunk
+  for (std::size_t n : {0, 1, 3, 13, 14, 15, 17}){
+    vec_c64 a(std::size_t(1) << n);
+    for (auto& x : a) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+    auto p = probabilities(a);
+    double naive_total = 0.0;
+    for (std::size_t i=0;i<a.size();++i){ EXPECT_TRUE(std::fabs(p[i] - std::norm(a[i])) < 1e-6); naive_total += p[i]; }
+    EXPECT_TRUE(std::fabs(norm_squared(a.data(), a.size()) - naive_total) < 1e-9 * naive_total);
+
+    std::vector<double> p1(n), p1a(n);
+    const double total = marginals_one(p.data(), n, p1.data());
+    const double total_a = marginals_one(a.data(), n, p1a.data());
+    EXPECT_TRUE(std::fabs(total - naive_total) < 1e-9 * naive_total);
+    EXPECT_TRUE(std::fabs(total_a - naive_total) < 1e-9 * naive_total);
+    auto ez = expect_z_all(p, n);
+    auto eza = expect_z_all(a, n);
+    for (std::size_t q=0;q<n;++q){
+      double ones = 0.0;
+      for (std::size_t i=0;i<p.size();++i) if ((i >> q) & 1) ones += p[i];
+      EXPECT_TRUE(std::fabs(p1[q] - ones) < 1e-9 * naive_total);
+      EXPECT_TRUE(std::fabs(p1a[q] - ones) < 1e-9 * naive_total);
+      EXPECT_TRUE(std::fabs(ez[q] - (naive_total - 2.0 * ones)) < 1e-9 * naive_total);
+      EXPECT_TRUE(std::fabs(eza[q] - ez[q]) < 1e-9 * naive_total);
+    }
+  }
+
+  // Normalisation of a state
+  {
+    vec_c64 a(std::size_t(1) << 16);
+    for (auto& x : a) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+    scale_amplitudes(a.data(), a.size(), 1.0 / std::sqrt(norm_squared(a.data(), a.size())));
+    EXPECT_TRUE(std::fabs(norm_squared(a.data(), a.size()) - 1.0) < 1e-6);
+  }
+
+  // Inner product against the direct sum
+  for (std::size_t n : {0, 3, 15}){
+    vec_c64 a(std::size_t(1) << n), b(a.size());
+    for (auto& x : a) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+    for (auto& x : b) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+    std::complex<double> naive{0.0, 0.0};
+    for (std::size_t i=0;i<a.size();++i) naive += std::conj(std::complex<double>(a[i])) * std::complex<double>(b[i]);
+    EXPECT_TRUE(std::abs(inner_product(a.data(), b.data(), a.size()) - naive) < 1e-9 * double(a.size()));
+    EXPECT_TRUE(std::abs(inner_product(a.data(), a.data(), a.size()) - norm_squared(a.data(), a.size())) < 1e-9 * double(a.size()));
+  }
+
+  // Reduced density of one and two qubits (either order) against the explicit partial trace
+  for (std::size_t n : {2, 5, 17}){
+    vec_c64 a(std::size_t(1) << n);
+    for (auto& x : a) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+    const std::vector<std::vector<std::size_t>> sets = {{0}, {n - 1}, {1, 0}, {0, n - 1}, {n - 1, 1}};
+    for (const auto& qs : sets){
+      if (qs.size() == 2 && qs[0] == qs[1]) continue;
+      const std::size_t k = qs.size(), d = std::size_t(1) << k;
+      c64 rho[16];
+      reduced_density(a.data(), n, qs.data(), k, rho);
+      std::vector<std::complex<double>> ref(d*d);
+      std::size_t mask = 0;
+      for (auto q : qs) mask |= std::size_t(1) << q;
+      for (std::size_t i=0;i<a.size();++i)
+        for (std::size_t c=0;c<d;++c){
+          // j: i with the reduced qubits set to c
+          std::size_t r = 0, j = i & ~mask;
+          for (std::size_t b=0;b<k;++b){ r |= ((i >> qs[b]) & 1) << b; j |= ((c >> b) & 1) << qs[b]; }
+          ref[r*d + c] += std::complex<double>(a[i]) * std::conj(std::complex<double>(a[j]));
+        }
+      for (std::size_t e=0;e<d*d;++e) EXPECT_TRUE(std::abs(std::complex<double>(rho[e]) - ref[e]) < 1e-6 * std::abs(ref[0]));
+    }
+  }
+
+#ifdef QSX_OPENMP
+  // Bitwise identical results for any thread count
+  {
+    const std::size_t n = 18;
+    vec_c64 a(std::size_t(1) << n);
+    for (auto& x : a) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+    auto p = probabilities(a);
+    omp_set_num_threads(1);
+    const double s1 = norm_squared(a.data(), a.size());
+    auto z1 = expect_z_all(p, n);
+    const auto ip1 = inner_product(a.data(), a.data() + 1, a.size() - 1);
+    for (int threads : {2, 3, 7}){
+      omp_set_num_threads(threads);
+      EXPECT_TRUE(norm_squared(a.data(), a.size()) == s1);
+      EXPECT_TRUE(inner_product(a.data(), a.data() + 1, a.size() - 1) == ip1);
+      EXPECT_TRUE(expect_z_all(p, n) == z1);
+    }
+  }
+#endif
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
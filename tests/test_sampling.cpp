@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/sampling.hpp"
+#include <iostream>
+#include <cmath>
+#include <vector>
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+#define EXPECT_NEAR(a,b,eps) do{ if (std::fabs((a)-(b))>(eps)) { std::cerr << "EXPECT_NEAR failed at " << __LINE__ << ": " << (a) << " vs " << (b) << "\n"; ++tests_failed; } }while(0)
+
+int main(){
+  // Skewed distribution over 3 qubits with zero-probability entries
+  std::vector<double> p = {0.0, 0.4, 0.1, 0.0, 0.25, 0.05, 0.2, 0.0};
+  auto cdf = build_cdf(p);
+  EXPECT_NEAR(cdf.back(), 1.0, 1e-12);
+
+  // Sorted sweep reproduces binary search draw-for-draw
+  const std::size_t shots = 50000;
+  Rng r1(7), r2(7);
+  auto a = sample_cdf(p, shots, r1);
+  auto b = sample_sorted(p, shots, r2);
+  EXPECT_TRUE(a == b);
+
+  // Every sampler matches the distribution and never returns zero-probability outcomes
+  for (auto kind : {SamplerKind::Cdf, SamplerKind::Sorted, SamplerKind::Alias}){
+    Rng rng(11);
+    auto s = sample_indices(p, shots, rng, kind);
+    std::vector<double> h(p.size(), 0.0);
+    for (auto i : s) h[i] += 1.0 / shots;
+    for (std::size_t i=0;i<p.size();++i){
+      EXPECT_NEAR(h[i], p[i], 0.01);
+      if (p[i] == 0.0) EXPECT_TRUE(h[i] == 0.0);
+    }
+  }
+
+  // Heuristic: many shots -> alias, large state with fewer shots -> sorted
+  EXPECT_TRUE(choose_sampler(16, 1000) == SamplerKind::Alias);
+  EXPECT_TRUE(choose_sampler(std::size_t(1) << 20, 10000) == SamplerKind::Sorted);
+  EXPECT_TRUE(choose_sampler(64, 8) == SamplerKind::Cdf);
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/circuit.hpp"
+#include "quantum/schedule.hpp"
+#include "test_util.hpp"
+#include <iostream>
+#include <cmath>
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+#define EXPECT_NEAR(a,b,eps) do{ if (std::fabs((a)-(b))>(eps)) { std::cerr << "EXPECT_NEAR failed at " << __LINE__ << ": " << (a) << " vs " << (b) << "\n"; ++tests_failed; } }while(0)
+
+int main(){
+#ifdef QSX_FP32
+  const double tol = 1e-5;
+#else
+  const double tol = 1e-10;
+#endif
+  // Chunked execution matches plain execution, with and without fusion, for several chunk sizes
+  for (bool noisy : {false, true}){
+    for (std::size_t fuse : {0, 3}){
+      for (std::size_t b : {2, 3, 5}){
+        auto c = random_circuit(8, 300, 7 + b + fuse, noisy, false, 4);
+        RunOptions plain; plain.fuse_qubits = fuse; plain.cache_blocking = false;
+        RunOptions blocked = plain; blocked.cache_blocking = true; blocked.block_qubits = b;
+        auto ref = run(c, 9, false, plain);
+        auto got = run(c, 9, false, blocked);
+        for (std::size_t i=0;i<ref.probabilities.size();++i) EXPECT_NEAR(got.probabilities[i], ref.probabilities[i], tol);
+        EXPECT_TRUE(got.outcome == ref.outcome);
+        EXPECT_TRUE(ref.profile.passes_saved == 0 && ref.profile.block_qubits == 0);
+        EXPECT_TRUE(got.profile.steps == ref.profile.steps + got.profile.layout_swaps);
+        EXPECT_TRUE(got.profile.passes + got.profile.passes_saved == got.profile.steps);
+      }
+    }
+  }
+
+  // Plan structure: windows partition the steps and blocked windows only touch low qubits
+  auto c = random_circuit(8, 300, 1, false, false, 4);
+  RunOptions opts; opts.block_qubits = 4;
+  auto plan = plan_execution(c, opts);
+  EXPECT_TRUE(plan.profile.block_qubits == 4);
+  EXPECT_TRUE(plan.profile.blocked_windows > 0 && plan.profile.passes_saved > 0);
+  std::size_t next = 0;
+  for (const auto& w : plan.windows){
+    EXPECT_TRUE(w.begin == next && w.end > w.begin);
+    next = w.end;
+    if (!w.blocked) continue;
+    EXPECT_TRUE(w.end - w.begin >= 2);
+    for (std::size_t i=w.begin;i<w.end;++i)
+      for (auto q : plan.steps[i].op.qubits) EXPECT_TRUE(q < 4);
+  }
+  EXPECT_TRUE(next == plan.steps.size());
+
+  // Reordering: gates concentrated on high qubits are moved low, results keep circuit qubit order
+  for (std::size_t fuse : {0, 3}){
+    Circuit hc = random_circuit(8, 300, 11 + fuse, false, false, 4);
+    for (auto& op : hc.ops) for (auto& q : op.qubits) q = 7 - q; // busy qubits are now the high ones
+    RunOptions plain; plain.fuse_qubits = fuse; plain.cache_blocking = false;
+    RunOptions fixed = plain; fixed.cache_blocking = true; fixed.block_qubits = 4; fixed.reorder_qubits = false;
+    RunOptions moved = fixed; moved.reorder_qubits = true;
+    auto ref = run(hc, 4, false, plain);
+    auto a = run(hc, 4, false, fixed);
+    auto r = run(hc, 4, false, moved);
+    for (std::size_t i=0;i<ref.probabilities.size();++i) EXPECT_NEAR(r.probabilities[i], ref.probabilities[i], tol);
+    EXPECT_TRUE(r.outcome == ref.outcome);
+    EXPECT_TRUE(a.profile.layout_swaps == 0);
+    // Layout changes are only made when they pay for themselves
+    EXPECT_TRUE(r.profile.passes <= a.profile.passes);
+    if (fuse == 0) EXPECT_TRUE(r.profile.layout_swaps > 0 && r.profile.passes < a.profile.passes);
+  }
+
+  // In-place bit swap matches three CNOTs
+  {
+    StateVector s1(5), s2(5);
+    Rng rng(2);
+    for (std::size_t i=0;i<s1.dimension();++i) s1.amplitudes_mut()[i] = s2.amplitudes_mut()[i] = c64(rng.uniform(), rng.uniform());
+    s1.apply_swap(1, 4);
+    s2.apply_cx(1, 4); s2.apply_cx(4, 1); s2.apply_cx(1, 4);
+    for (std::size_t i=0;i<s1.dimension();++i) EXPECT_TRUE(s1.amplitudes()[i] == s2.amplitudes()[i]);
+  }
+
+  // Circuits that fit in one chunk are not blocked
+  opts.block_qubits = 8;
+  EXPECT_TRUE(plan_execution(c, opts).profile.blocked_windows == 0);
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/circuit.hpp"
+#include <iostream>
+#include <cmath>
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+#define EXPECT_NEAR(a,b,eps) do{ if (std::fabs((a)-(b))>(eps)) { std::cerr << "EXPECT_NEAR failed at " << __LINE__ << ": " << (a) << " vs " << (b) << "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-5;
+#else
+static const double tol = 1e-9;
+#endif
+
+int main(){
+  // Bell state sampled many times from a single simulation
+  Circuit c; c.nqubits=2;
+  c.ops.push_back({OpType::H,{0},0.0});
+  c.ops.push_back({OpType::CNOT,{0,1},0.0});
+  c.ops.push_back({OpType::MEASURE,{},0.0});
+  EXPECT_TRUE(is_sampling_deterministic(c));
+  const std::size_t shots = 20000;
+  auto sr = run_shots(c, shots, 99, true);
+  EXPECT_TRUE(sr.outcomes.size() == shots);
+  EXPECT_TRUE(sr.histogram.count(1) == 0 && sr.histogram.count(2) == 0);
+  std::size_t total = 0; for (auto& kv : sr.histogram) total += kv.second;
+  EXPECT_TRUE(total == shots);
+  EXPECT_NEAR(double(sr.histogram[0]) / shots, 0.5, 0.02);
+  EXPECT_NEAR(sr.probabilities[3], 0.5, tol);
+  auto bits = basis_to_bits(sr.outcomes[0], 2);
+  EXPECT_TRUE(bits[0] == bits[1]);
+
+  // Noisy circuits keep per-shot semantics
+  c.ops.insert(c.ops.begin()+1, {OpType::DEPOL,{0},0.2});
+  EXPECT_TRUE(!is_sampling_deterministic(c));
+  auto sn = run_shots(c, 50, 5, false);
+  EXPECT_TRUE(sn.outcomes.empty());
+  total = 0; for (auto& kv : sn.histogram) total += kv.second;
+  EXPECT_TRUE(total == 50);
+
+  // Shared prefix and branch tree: outcomes match one run() per shot, for any branch budget
+  {
+    Circuit nc; nc.nqubits = 6;
+    for (int layer=0;layer<4;++layer){
+      for (std::size_t q=0;q<6;++q) nc.ops.push_back({OpType::RY, {q}, 0.3 + 0.1*double(q) + layer});
+      for (std::size_t q=0;q+1<6;++q){
+        nc.ops.push_back({OpType::CNOT, {q, q+1}, 0.0});
+        nc.ops.push_back({q % 2 ? OpType::DEPOL : OpType::DEPHASE, {q+1}, 0.02});
+      }
+    }
+    nc.ops.push_back({OpType::MEASURE, {}, 0.0});
+    const std::size_t ns = 300;
+    std::vector<std::uint64_t> ref;
+    for (std::size_t s=0;s<ns;++s){
+      auto r = run(nc, 17 + s, false);
+      std::uint64_t idx = 0;
+      for (std::size_t q=0;q<r.outcome.size();++q) if (r.outcome[q]) idx |= std::uint64_t(1) << q;
+      ref.push_back(idx);
+    }
+    const auto first = run(nc, 17, false);
+    const std::size_t state = (std::size_t(1) << 6) * sizeof(c64);
+    for (std::size_t budget : {std::size_t(1) << 30, 3*state, 4*state, std::size_t(0)}){
+      RunOptions opts; opts.branch_cache_bytes = budget;
+      auto st = run_shots(nc, ns, 17, true, opts);
+      EXPECT_TRUE(st.outcomes == ref);
+      EXPECT_TRUE(st.probabilities == first.probabilities);
+      if (budget) EXPECT_TRUE(st.trajectories < ns / 2); // low noise: most shots share branches
+      else EXPECT_TRUE(st.trajectories == ns);
+    }
+  }
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/kernels.hpp"
+#include "quantum/random.hpp"
+#include <iostream>
+#include <cmath>
+#include <vector>
+
+using namespace qsx;
+using namespace qsx::kernels;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+static vec_c64 random_state(std::size_t n, Rng& rng){
+  vec_c64 a(std::size_t(1) << n);
+  for (auto& x : a) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+  return a;
+}
+
+static double max_diff(const vec_c64& a, const vec_c64& b){
+  double d = 0.0;
+  for (std::size_t i=0;i<a.size();++i) d = std::max(d, (double)std::abs(a[i] - b[i]));
+  return d;
+}
+
+int main(){
+#ifdef QSX_FP32
+  const double tol = 1e-5;
+#else
+  const double tol = 1e-12;
+#endif
+  Rng rng(3);
+  const c64 u[4] = {c64(0.6, 0.1), c64(-0.3, 0.7), c64(0.2, -0.5), c64(0.8, 0.4)};
+  std::cout << "detected ISA: " << isa_name(detect_isa()) << "\n";
+  // Every supported ISA must agree with the scalar kernels for every target and control/target pair,
+  // including states smaller than one register.
+  for (Isa isa : {Isa::AVX2, Isa::AVX512}){
+    if (static_cast<int>(isa) > static_cast<int>(detect_isa())) continue;
+    for (std::size_t n=1;n<=7;++n){
+      for (std::size_t t=0;t<n;++t){
+        auto ref = random_state(n, rng);
+        auto got = ref;
+        apply_1q(Isa::Scalar, ref.data(), n, t, u);
+        apply_1q(isa, got.data(), n, t, u);
+        EXPECT_TRUE(max_diff(ref, got) < tol);
+
+        apply_diag_1q(Isa::Scalar, ref.data(), n, t, c64(1, 0), c64(0.6, 0.8));
+        apply_diag_1q(isa, got.data(), n, t, c64(1, 0), c64(0.6, 0.8));
+        apply_diag_1q(Isa::Scalar, ref.data(), n, t, c64(0, -1), c64(0, 1));
+        apply_diag_1q(isa, got.data(), n, t, c64(0, -1), c64(0, 1));
+        EXPECT_TRUE(max_diff(ref, got) < tol);
+
+        for (std::size_t c=0;c<n;++c){
+          if (c == t) continue;
+          apply_controlled_1q(Isa::Scalar, ref.data(), n, c, t, u);
+          apply_controlled_1q(isa, got.data(), n, c, t, u);
+          EXPECT_TRUE(max_diff(ref, got) < tol);
+        }
+      }
+    }
+  }
+
+  // Dense k-qubit blocks, including blocks whose lowest qubit lies inside one register
+  for (Isa isa : {Isa::AVX2, Isa::AVX512}){
+    if (static_cast<int>(isa) > static_cast<int>(detect_isa())) continue;
+    const std::size_t n = 8;
+    for (std::size_t k=1;k<=kMaxDenseQubits;++k){
+      vec_c64 m(std::size_t(1) << (2*k));
+      for (auto& x : m) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+      for (std::size_t lo=0;lo+k<=n;++lo){
+        std::vector<std::size_t> qs;
+        for (std::size_t b=0;b<k;++b) qs.push_back(lo + (b*(n-lo)) / k);
+        auto ref = random_state(n, rng);
+        auto got = ref;
+        apply_kq(Isa::Scalar, ref.data(), n, qs.data(), k, m.data());
+        apply_kq(isa, got.data(), n, qs.data(), k, m.data());
+        EXPECT_TRUE(max_diff(ref, got) < tol);
+      }
+    }
+  }
+
+  // Controlled dense blocks: every ISA agrees with scalar for up to three controls above, below
+  // and between the target qubits
+  for (Isa isa : {Isa::AVX2, Isa::AVX512}){
+    if (static_cast<int>(isa) > static_cast<int>(detect_isa())) continue;
+    const std::size_t n = 8;
+    for (std::size_t k=1;k<=kMaxDenseQubits;++k){
+      vec_c64 m(std::size_t(1) << (2*k));
+      for (auto& x : m) x = c64(rng.uniform() - 0.5, rng.uniform() - 0.5);
+      for (std::size_t lo=0;lo+k<=n;++lo){
+        std::vector<std::size_t> qs;
+        std::size_t used = 0;
+        for (std::size_t b=0;b<k;++b){ qs.push_back(lo + (b*(n-lo)) / k); used |= std::size_t(1) << qs.back(); }
+        // up to three controls: the first free qubits walking up from lo + 3 (wrapping around)
+        std::size_t mask = 0, controls = 0;
+        for (std::size_t j=0;j<n && controls<3;++j){
+          const std::size_t q = (lo + 3 + j) % n;
+          if (!((used >> q) & 1)){ mask |= std::size_t(1) << q; ++controls; }
+        }
+        auto ref = random_state(n, rng);
+        auto got = ref;
+        apply_controlled_kq(Isa::Scalar, ref.data(), n, qs.data(), k, mask, m.data());
+        apply_controlled_kq(isa, got.data(), n, qs.data(), k, mask, m.data());
+        EXPECT_TRUE(max_diff(ref, got) < tol);
+      }
+    }
+  }
+
+  // Scalar controlled block with one control equals the 1q controlled kernel
+  {
+    const std::size_t n = 5;
+    for (std::size_t c=0;c<n;++c) for (std::size_t t=0;t<n;++t){
+      if (c == t) continue;
+      auto ref = random_state(n, rng);
+      auto got = ref;
+      const std::size_t q = t;
+      apply_controlled_1q(Isa::Scalar, ref.data(), n, c, t, u);
+      apply_controlled_kq(Isa::Scalar, got.data(), n, &q, 1, std::size_t(1) << c, u);
+      EXPECT_TRUE(max_diff(ref, got) < tol);
+    }
+  }
+
+  // set_isa never selects an ISA the CPU lacks
+  set_isa(Isa::AVX512);
+  EXPECT_TRUE(static_cast<int>(active_isa()) <= static_cast<int>(detect_isa()));
+  set_isa(Isa::Scalar);
+  EXPECT_TRUE(active_isa() == Isa::Scalar);
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
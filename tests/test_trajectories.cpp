@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: MIT
+
+#include "quantum/trajectories.hpp"
+#include "quantum/density_matrix.hpp"
+#include "quantum/reduce.hpp"
+#include <iostream>
+#include <cmath>
+#ifdef QSX_OPENMP
+#include <omp.h>
+#endif
+
+using namespace qsx;
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+// Entangling layers with dephasing, depolarizing and amplitude damping after every layer
+static Circuit noisy_circuit(std::size_t n){
+  Circuit c; c.nqubits = n;
+  for (int layer=0;layer<3;++layer){
+    for (std::size_t q=0;q<n;++q) c.ops.push_back({OpType::RY, {q}, 0.4 + 0.3*double(q) + 0.2*layer});
+    for (std::size_t q=0;q+1<n;++q) c.ops.push_back({OpType::CNOT, {q, q+1}, 0.0});
+    for (std::size_t q=0;q<n;++q){
+      c.ops.push_back({OpType::AMPDAMP, {q}, 0.15});
+      c.ops.push_back({q % 2 ? OpType::DEPOL : OpType::DEPHASE, {q}, 0.08});
+    }
+  }
+  c.ops.push_back({OpType::MEASURE, {}, 0.0});
+  return c;
+}
+
+int main(){
+  // Independent, reproducible streams
+  {
+    Pcg32 a(7, 0), b(7, 0), c(7, 1);
+    bool same = true, differ = false;
+    double sum = 0.0;
+    for (int i=0;i<4000;++i){
+      const double x = a.uniform01(), y = b.uniform01(), z = c.uniform01();
+      same &= x == y;
+      differ |= x != z;
+      EXPECT_TRUE(x >= 0.0 && x < 1.0);
+      sum += x;
+    }
+    EXPECT_TRUE(same && differ);
+    EXPECT_TRUE(std::fabs(sum / 4000.0 - 0.5) < 0.02);
+  }
+
+  // Branch selection: |1> under full damping always decays; Pauli noise is mixed unitary
+  {
+    KrausSampler damp(amplitude_damping(1.0));
+    EXPECT_TRUE(!damp.mixed_unitary());
+    EXPECT_TRUE(KrausSampler(depolarizing(0.3)).mixed_unitary());
+    EXPECT_TRUE(KrausSampler(depolarizing_2q(0.3)).mixed_unitary());
+    Pcg32 rng(3, 0);
+    for (int i=0;i<20;++i){
+      StateVector sv(2);
+      sv.apply_x(1);
+      EXPECT_TRUE(damp.apply(sv, {1}, rng) == 1);
+      EXPECT_TRUE(std::abs(sv.amplitudes()[0] - c64(1.0)) < 1e-6);
+    }
+    bool threw = false;
+    try { KrausSampler s(channel_from_superop(amplitude_damping(0.2).superop, 1)); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+  }
+
+  // Averages match the density matrix within the statistical error
+  {
+    const auto c = noisy_circuit(4);
+    const auto exact = run_density(c, 1, false);
+    const auto ez = expect_z_all(exact.probabilities, 4);
+    TrajectoryOptions opts;
+    opts.max_trajectories = 3000;
+    const auto tr = run_trajectories(c, 11, opts);
+    EXPECT_TRUE(tr.trajectories == 3000 && !tr.converged);
+    for (std::size_t q=0;q<4;++q){
+      EXPECT_TRUE(tr.stderr_z[q] > 0.0);
+      EXPECT_TRUE(std::fabs(tr.expect_z[q] - ez[q]) < 5.0*tr.stderr_z[q] + 1e-3);
+    }
+    double total = 0.0;
+    for (std::size_t i=0;i<tr.probabilities.size();++i){
+      total += tr.probabilities[i];
+      EXPECT_TRUE(std::fabs(tr.probabilities[i] - exact.probabilities[i]) < 0.03);
+    }
+    EXPECT_TRUE(std::fabs(total - 1.0) < 1e-5);
+    // Same seed, same result
+    const auto again = run_trajectories(c, 11, opts);
+    EXPECT_TRUE(again.expect_z == tr.expect_z && again.probabilities == tr.probabilities);
+  }
+
+  // Early stop on the target standard error, at a batch boundary
+  {
+    const auto c = noisy_circuit(3);
+    TrajectoryOptions opts;
+    opts.max_trajectories = 100000;
+    opts.target_stderr = 0.02;
+    opts.probabilities = false;
+    const auto tr = run_trajectories(c, 5, opts);
+    EXPECT_TRUE(tr.converged);
+    EXPECT_TRUE(tr.trajectories < 100000 && tr.trajectories % 64 == 0);
+    for (double s : tr.stderr_z) EXPECT_TRUE(s <= 0.02);
+    EXPECT_TRUE(tr.probabilities.empty());
+  }
+
+  // Without noise every trajectory is the plain state-vector run
+  {
+    Circuit c; c.nqubits = 3;
+    c.ops = {{OpType::H, {0}, 0.0}, {OpType::CNOT, {0, 1}, 0.0}, {OpType::RX, {2}, 0.7}};
+    TrajectoryOptions opts;
+    opts.max_trajectories = 5;
+    const auto tr = run_trajectories(c, 1, opts);
+    const auto r = run(c, 1, false);
+    for (std::size_t i=0;i<r.probabilities.size();++i) EXPECT_TRUE(std::fabs(tr.probabilities[i] - r.probabilities[i]) < 1e-6);
+    for (double s : tr.stderr_z) EXPECT_TRUE(s < 1e-6);
+    // Zero trajectories would average nothing
+    opts.max_trajectories = 0;
+    bool threw = false;
+    try { run_trajectories(c, 1, opts); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+  }
+
+#ifdef QSX_OPENMP
+  // Bitwise identical results for any thread count
+  {
+    const auto c = noisy_circuit(5);
+    TrajectoryOptions opts;
+    opts.max_trajectories = 200;
+    omp_set_num_threads(1);
+    const auto one = run_trajectories(c, 9, opts);
+    for (int threads : {2, 3}){
+      omp_set_num_threads(threads);
+      const auto tr = run_trajectories(c, 9, opts);
+      EXPECT_TRUE(tr.expect_z == one.expect_z && tr.probabilities == one.probabilities);
+    }
+  }
+#endif
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
+}
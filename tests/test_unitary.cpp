@@ -2,16 +2,67 @@
 
 #include "quantum/unitary.hpp"
 #include "quantum/circuit.hpp"
-#include <cassert>
+#include <iostream>
+#include <algorithm>
 #include <cmath>
+#include <filesystem>
+
+static int tests_failed = 0;
+#define EXPECT_TRUE(x) do{ if (!(x)) { std::cerr << "EXPECT_TRUE failed at " << __LINE__ << ": " #x "\n"; ++tests_failed; } }while(0)
+
+#ifdef QSX_FP32
+static const double tol = 1e-5;
+#else
+static const double tol = 1e-12;
+#endif
+
 int main(){
   qsx::Circuit c; c.nqubits=1;
   c.ops.push_back({qsx::OpType::H,{0},0.0});
   auto U = qsx::build_unitary(c);
   // Check unitarity: U^† U = I
-  std::complex<double> a=U[0], b=U[1], c1=U[2], d=U[3];
+  std::complex<double> a=U[0], c1=U[2];
   // For H, entries are 1/sqrt(2)
   double s = std::norm(a)+std::norm(c1);
-  assert(std::fabs(s - 1.0) < 1e-12);
-  return 0;
+  EXPECT_TRUE(std::fabs(s - 1.0) < tol);
+
+  // Streaming binary export matches build_unitary, in both precisions
+  {
+    qsx::Circuit g; g.nqubits=5;
+    for (std::size_t q=0;q<5;++q){ g.ops.push_back({qsx::OpType::H,{q},0.0}); g.ops.push_back({qsx::OpType::RZ,{q},0.3+q}); }
+    for (std::size_t q=0;q+1<5;++q) g.ops.push_back({qsx::OpType::CNOT,{q,q+1},0.0});
+    g.ops.push_back({qsx::OpType::U3,{4},0.0,{0.7,0.2,-0.4}});
+    g.ops.push_back({qsx::OpType::CCX,{4,0,2},0.0});
+    const auto ref = qsx::build_unitary(g);
+    const std::size_t d = 32;
+    for (bool single : {false, true}){
+      qsx::RunOptions opts; opts.fuse_qubits = 3;
+      EXPECT_TRUE(qsx::export_unitary_binary(g, "unitary_test.bin", single, opts));
+      const std::size_t bytes = single ? 8 : sizeof(qsx::c64);
+      EXPECT_TRUE(std::filesystem::file_size("unitary_test.bin") == 32 + d*d*bytes);
+      std::size_t n = 0;
+      auto got = qsx::load_unitary_binary("unitary_test.bin", n);
+      EXPECT_TRUE(got && n == 5 && got->size() == d*d);
+      if (!got || got->size() != d*d) continue;
+      double diff = 0.0;
+      for (std::size_t i=0;i<d*d;++i) diff = std::max(diff, (double)std::abs((*got)[i] - ref[i]));
+#ifdef QSX_FP32
+      EXPECT_TRUE(diff < 1e-5);
+#else
+      EXPECT_TRUE(diff < (single ? 1e-6 : 1e-10));
+#endif
+    }
+    std::size_t n = 0;
+    EXPECT_TRUE(!qsx::load_unitary_binary("unitary_test_missing.bin", n));
+    // Truncated and padded files are rejected
+    const auto full = std::filesystem::file_size("unitary_test.bin");
+    std::filesystem::resize_file("unitary_test.bin", full - 1);
+    EXPECT_TRUE(!qsx::load_unitary_binary("unitary_test.bin", n));
+    std::filesystem::resize_file("unitary_test.bin", full + 16);
+    EXPECT_TRUE(!qsx::load_unitary_binary("unitary_test.bin", n));
+    std::filesystem::remove("unitary_test.bin");
+  }
+
+  if (tests_failed==0){ std::cout << "OK\n"; }
+  return tests_failed == 0 ? 0 : 1;
 }
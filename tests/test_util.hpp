@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include "quantum/circuit.hpp"
+#include "quantum/random.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Helpers shared by the test programs
+
+// Random circuit of Cliffords, rotations, CNOT/CZ and redundant H pairs (for optimize()), ending
+// in MEASURE. noisy adds DEPOL/DEPHASE channels; named puts the rotations on the parameters
+// a, b, c (some scaled, some literal); busy > 0 puts 70% of the gates on qubits below busy, with
+// short-range CNOTs, so that long blockable windows occur.
+inline qsx::Circuit random_circuit(std::size_t n, std::size_t depth, uint64_t seed,
+                                   bool noisy = false, bool named = false, std::size_t busy = 0){
+  using namespace qsx;
+  Rng rng(seed);
+  Circuit c; c.nqubits = n;
+  auto pick = [&](std::size_t m){ return std::size_t(rng.uniform() * m) % m; };
+  const OpType one[] = {OpType::H, OpType::X, OpType::Y, OpType::Z, OpType::S, OpType::RX, OpType::RY, OpType::RZ};
+  const char* names[] = {"a", "b", "c", ""};
+  for (std::size_t i=0;i<depth;++i){
+    std::size_t q = pick(n);
+    if (busy && rng.uniform() < 0.7) q %= busy;
+    const double u = rng.uniform();
+    if (u < 0.25 && n > 1){
+      const std::size_t t = (q + 1 + pick(busy ? std::min<std::size_t>(3, n - 1) : n - 1)) % n;
+      c.ops.push_back({OpType::CNOT, {q, t}, 0.0});
+    } else if (u < 0.28){
+      c.ops.push_back({OpType::H, {q}, 0.0});
+      c.ops.push_back({OpType::H, {q}, 0.0});
+    } else if (u < 0.32 && n > 1){
+      c.ops.push_back({OpType::CZ, {q, (q + 1) % n}, 0.0});
+    } else if (noisy && u < 0.36){
+      c.ops.push_back({u < 0.34 ? OpType::DEPOL : OpType::DEPHASE, {q}, 0.3});
+    } else {
+      Op op{one[pick(8)], {q}, rng.uniform() * 6.0};
+      if (named && (op.type == OpType::RX || op.type == OpType::RY || op.type == OpType::RZ)){
+        op.param = names[pick(4)];
+        if (!op.param.empty()) op.param_scale = pick(2) ? 1.0 : -2.0;
+      }
+      c.ops.push_back(op);
+    }
+  }
+  c.ops.push_back({OpType::MEASURE, {}, 0.0});
+  return c;
+}
+
+// Largest elementwise |x - y| (probabilities or amplitudes)
+template <class V>
+double max_diff(const V& x, const V& y){
+  double d = 0.0;
+  for (std::size_t i=0;i<x.size();++i) d = std::max(d, (double)std::abs(x[i] - y[i]));
+  return d;
+}